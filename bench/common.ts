@@ -0,0 +1,148 @@
+// Shared helpers for the benchmarks in this directory
+//
+// Every benchmark generates its own input, runs the core transpiler and
+// prints a table of best-of-N timings. They time build/zeno by default; the
+// Makefile builds it without optimization, so for representative numbers
+// point ZENO at an optimized build:
+//
+//   cd src/transpiler && make CFLAGS="-O2 -std=c99 -D_POSIX_C_SOURCE=200809L -pthread"
+//   bun bench/parallel.ts
+
+import { dirname, join } from "path";
+import { mkdtempSync, readFileSync, rmSync, writeFileSync } from "fs";
+import { tmpdir } from "os";
+
+export const ZENO_BINARY = process.env.ZENO ?? join(import.meta.dir, "..", "build", "zeno");
+
+export const RUNS = Number(process.env.RUNS ?? 5);
+
+export interface ZenoRun {
+  ms: number;
+  stdout: string;
+  stderr: string;
+}
+
+// Run build/zeno in cwd; a failing run ends the benchmark
+export function runZeno(args: string[], cwd: string): ZenoRun {
+  const start = performance.now();
+  const result = Bun.spawnSync({
+    cmd: [ZENO_BINARY, ...args],
+    cwd,
+    stdout: "pipe",
+    stderr: "pipe",
+  });
+  const ms = performance.now() - start;
+
+  const stdout = result.stdout.toString();
+  const stderr = result.stderr.toString();
+  if (result.exitCode !== 0) {
+    throw new Error(`zeno ${args.join(" ")} failed:\n${stderr}`);
+  }
+  return { ms, stdout, stderr };
+}
+
+// Smallest of RUNS measurements
+export function best(measure: () => number): number {
+  let fastest = Infinity;
+  for (let i = 0; i < RUNS; i++) {
+    fastest = Math.min(fastest, measure());
+  }
+  return fastest;
+}
+
+// Wall time of the phases of one `zeno --trace` run, in milliseconds. Parsing
+// spans worker threads, so it is measured on the main thread from the end of
+// reading the source to the first pass over the parsed program; load runs
+// from the start of reading the input, source or .zast, to that pass.
+export interface PhaseTimes {
+  load: number;
+  parse: number;
+  codegen: number;
+  total: number;
+}
+
+export function tracePhases(traceFile: string): PhaseTimes {
+  const events = JSON.parse(readFileSync(traceFile, "utf8")).traceEvents;
+  const span = (name: string) => events.find((event: any) => event.ph === "X" && event.name === name && event.tid === 1);
+
+  const input = span("read") ?? span("load ast");
+  const firstPass = span("exhaustiveness");
+  return {
+    load: (firstPass.ts - input.ts) / 1000,
+    parse: (firstPass.ts - (input.ts + input.dur)) / 1000,
+    codegen: span("codegen").dur / 1000,
+    total: span("transpile").dur / 1000,
+  };
+}
+
+// Milliseconds a fresh runtime takes to import entry, an absolute path; the
+// timer starts inside the new process, so runtime startup is not counted
+export function coldImport(entry: string): number {
+  const runner = join(dirname(entry), "cold-import.mjs");
+  writeFileSync(runner, `const start = performance.now();
+await import(${JSON.stringify(entry)});
+console.log(performance.now() - start);
+`);
+
+  const result = Bun.spawnSync({
+    cmd: [process.execPath, runner],
+    stdout: "pipe",
+    stderr: "pipe",
+  });
+  if (result.exitCode !== 0) {
+    throw new Error(`importing ${entry} failed:\n${result.stderr.toString()}`);
+  }
+  return Number(result.stdout.toString().trim());
+}
+
+// A scratch directory, removed when the process exits
+export function workDir(name: string): string {
+  const dir = mkdtempSync(join(tmpdir(), `zeno-bench-${name}-`));
+  process.on("exit", () => rmSync(dir, { recursive: true, force: true }));
+  return dir;
+}
+
+// A module of `count` independent groups of declarations: structs, traits
+// and impls, matches on atoms, pipes, and collection literals
+export function generateModule(count: number): string {
+  const parts: string[] = [];
+  for (let i = 0; i < count; i++) {
+    parts.push(`struct User${i} {
+  name: string;
+  age: number;
+}
+trait Show${i} {
+  show(): string;
+}
+impl Show${i} for User${i} {
+  show() {
+    "user ${i}"
+  }
+}
+let status${i} = :ok
+let message${i} = match status${i} {
+  :ok => "Success ${i}"
+  :error => "Failed"
+  _ => "Unknown"
+}
+let greeting${i} = "  Hello ${i}  " |> trim |> toUpperCase
+let record${i} = { id: ${i}, name: "user ${i}", tags: ["a", "b", :c], nested: { ok: true } }
+`);
+  }
+  return parts.join("\n");
+}
+
+export function formatMs(ms: number): string {
+  return `${ms.toFixed(1)} ms`;
+}
+
+export function printTable(headers: string[], rows: string[][]) {
+  const widths = headers.map((header, i) => Math.max(header.length, ...rows.map((row) => row[i].length)));
+  const line = (cells: string[]) => cells.map((cell, i) => cell.padStart(widths[i])).join("  ");
+
+  console.log(line(headers));
+  console.log(widths.map((width) => "-".repeat(width)).join("  "));
+  for (const row of rows) {
+    console.log(line(row));
+  }
+}
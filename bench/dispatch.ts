@@ -0,0 +1,73 @@
+// Trait method calls with and without --static-dispatch
+//
+//   bun bench/dispatch.ts [impls] [calls]
+//
+// One program with many trait impls is compiled both ways and imported;
+// every impl is then called through TypeTrait.method, which static dispatch
+// turns into a direct call of a top-level function.
+
+import { join } from "path";
+import { writeFileSync } from "fs";
+import { RUNS, best, formatMs, printTable, runZeno, workDir } from "./common.ts";
+
+const impls = Number(process.argv[2] ?? 64);
+const calls = Number(process.argv[3] ?? 1_000_000);
+
+function generateTraits(count: number): string {
+  const parts: string[] = [`trait Visit {
+  visit(step: number): void;
+}
+`];
+  for (let i = 0; i < count; i++) {
+    parts.push(`struct Counter${i} {
+  seen: Set<number>;
+}
+impl Visit for Counter${i} {
+  visit(step: number) {
+    obj.seen.add(step)
+  }
+}
+export let visit${i} = (counter, step) => Counter${i}Visit.visit(counter, step)
+`);
+  }
+  return parts.join("\n");
+}
+
+const dir = workDir("dispatch");
+writeFileSync(join(dir, "traits.zs"), generateTraits(impls));
+
+const variants: [string, string[]][] = [
+  ["dynamic", []],
+  ["static", ["--static-dispatch"]],
+];
+
+const rows: string[][] = [];
+let dynamic = 0;
+for (const [name, flags] of variants) {
+  runZeno([...flags, "--emit", "js", "traits.zs", `${name}.js`], dir);
+  const module = await import(join(dir, `${name}.js`));
+  const visits: ((counter: { seen: Set<number> }, step: number) => void)[] = [];
+  for (let i = 0; i < impls; i++) {
+    visits.push(module[`visit${i}`]);
+  }
+
+  const counter = { seen: new Set<number>() };
+  const run = () => {
+    const start = performance.now();
+    for (let call = 0; call < calls; call++) {
+      visits[call % impls](counter, call & 1023);
+    }
+    return performance.now() - start;
+  };
+
+  // Warm up so both variants are timed after the JIT has compiled them
+  run();
+  const ms = best(run);
+  if (name === "dynamic") {
+    dynamic = ms;
+  }
+  rows.push([name, formatMs(ms), `${(dynamic / ms).toFixed(2)}x`, `${((ms * 1e6) / calls).toFixed(1)} ns`]);
+}
+
+console.log(`${impls} impls, ${calls} calls, best of ${RUNS}\n`);
+printTable(["dispatch", "time", "speedup", "per call"], rows);
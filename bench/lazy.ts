@@ -0,0 +1,48 @@
+// Cold start of a module graph: lazy let tables vs eager let
+//
+//   bun bench/lazy.ts [modules] [rows]
+//
+// Every module of the graph holds one large table behind an exported lookup;
+// the entry imports all of them but reads only the first. With `lazy let`,
+// the other tables are never built.
+
+import { join } from "path";
+import { writeFileSync } from "fs";
+import { RUNS, best, coldImport, formatMs, printTable, runZeno, workDir } from "./common.ts";
+
+const modules = Number(process.argv[2] ?? 50);
+const rows = Number(process.argv[3] ?? 5000);
+
+const table: string[] = [];
+for (let i = 0; i < rows; i++) {
+  table.push(`{ id: ${i}, name: "row ${i}", score: ${i}.5, tags: ["a", "b"] }`);
+}
+const literal = `[${table.join(", ")}]`;
+
+const results: string[][] = [];
+let eagerMs = 0;
+for (const binding of ["let", "lazy let"]) {
+  const dir = workDir("lazy");
+
+  const imports: string[] = [];
+  for (let m = 0; m < modules; m++) {
+    writeFileSync(join(dir, `table${m}.zs`), `${binding} table = ${literal}
+export let lookup = (i) => table.at(i)
+`);
+    runZeno(["--emit", "js", `table${m}.zs`, `table${m}.js`], dir);
+    imports.push(`import { lookup as lookup${m} } from "./table${m}.js"`);
+  }
+  writeFileSync(join(dir, "main.zs"), `${imports.join("\n")}
+export let first = lookup0(1)
+`);
+  runZeno(["--emit", "js", "main.zs", "main.js"], dir);
+
+  const ms = best(() => coldImport(join(dir, "main.js")));
+  if (binding === "let") {
+    eagerMs = ms;
+  }
+  results.push([binding, formatMs(ms), `${(eagerMs / ms).toFixed(2)}x`]);
+}
+
+console.log(`${modules} modules of ${rows} rows, one table read, cold import, best of ${RUNS}\n`);
+printTable(["tables", "import", "speedup"], results);
@@ -0,0 +1,42 @@
+// Startup cost of a large constant table: JSON.parse lowering vs literal source
+//
+//   bun bench/literals.ts [rows]
+//
+// zeno emits a constant literal whose JSON text reaches
+// CODEGEN_JSON_PARSE_MIN_LENGTH as JSON.parse('...'). This times a cold
+// import of that module against the same table written as an object literal.
+
+import { join } from "path";
+import { readFileSync, statSync, writeFileSync } from "fs";
+import { RUNS, best, coldImport, formatMs, printTable, runZeno, workDir } from "./common.ts";
+
+const rows = Number(process.argv[2] ?? 50000);
+
+// Rows in the syntax Zenoscript and JavaScript share
+const table: string[] = [];
+for (let i = 0; i < rows; i++) {
+  table.push(`  { id: ${i}, name: "row ${i}", score: -${i}.5, active: ${i % 2 === 0}, tags: ["a", "b"], parent: null }`);
+}
+const literal = `[\n${table.join(",\n")}\n]`;
+
+const dir = workDir("literals");
+writeFileSync(join(dir, "table.zs"), `export let table = ${literal}\n`);
+runZeno(["--emit", "js", "table.zs", "lowered.js"], dir);
+if (!readFileSync(join(dir, "lowered.js"), "utf8").includes("JSON.parse(")) {
+  throw new Error("zeno did not lower the table to JSON.parse");
+}
+writeFileSync(join(dir, "literal.js"), `export const table = ${literal};\n`);
+
+const results: string[][] = [];
+let literalMs = 0;
+for (const [name, file] of [["object literal", "literal.js"], ["JSON.parse", "lowered.js"]]) {
+  const path = join(dir, file);
+  const ms = best(() => coldImport(path));
+  if (file === "literal.js") {
+    literalMs = ms;
+  }
+  results.push([name, `${(statSync(path).size / 1e6).toFixed(2)} MB`, formatMs(ms), `${(literalMs / ms).toFixed(2)}x`]);
+}
+
+console.log(`${rows} rows, cold import, best of ${RUNS}\n`);
+printTable(["module", "size", "import", "speedup"], results);
@@ -0,0 +1,55 @@
+// Output size and load time: --minify, and binary .zast input
+//
+//   bun bench/minify.ts [groups]
+//
+// The first table compares the JavaScript emitted with and without --minify
+// by size and by the time the engine takes to compile it; the second times
+// zeno reading the module as source text and as the AST saved by
+// --emit-ast bin.
+
+import { join } from "path";
+import { readFileSync, statSync, writeFileSync } from "fs";
+import { RUNS, best, formatMs, generateModule, printTable, runZeno, tracePhases, workDir } from "./common.ts";
+
+const groups = Number(process.argv[2] ?? 20000);
+const dir = workDir("minify");
+writeFileSync(join(dir, "input.zs"), generateModule(groups));
+
+const formatBytes = (bytes: number) => `${(bytes / 1e6).toFixed(2)} MB`;
+
+console.log(`${groups} declaration groups, best of ${RUNS}\n`);
+
+const outputs: string[][] = [];
+let plainSize = 0;
+for (const [name, flags] of [["plain", []], ["minified", ["--minify"]]] as [string, string[]][]) {
+  runZeno([...flags, "--emit", "js", "input.zs", `${name}.js`], dir);
+  const source = readFileSync(join(dir, `${name}.js`), "utf8");
+  const size = Buffer.byteLength(source);
+  if (name === "plain") {
+    plainSize = size;
+  }
+
+  // Compiling without running: the module has no imports or exports. Each
+  // run compiles a distinct string so the engine's code cache cannot answer
+  let run = 0;
+  const compile = best(() => {
+    const unique = `${source}\n// ${run++}`;
+    const start = performance.now();
+    new Function(unique);
+    return performance.now() - start;
+  });
+  outputs.push([name, formatBytes(size), `${((100 * size) / plainSize).toFixed(0)}%`, formatMs(compile)]);
+}
+printTable(["output", "size", "of plain", "js compile"], outputs);
+console.log();
+
+runZeno(["--emit-ast", "bin", "input.zs", "input.zast"], dir);
+const inputs: string[][] = [];
+for (const file of ["input.zs", "input.zast"]) {
+  const load = best(() => {
+    runZeno(["--trace", "trace.json", file, "output.ts"], dir);
+    return tracePhases(join(dir, "trace.json")).load;
+  });
+  inputs.push([file, formatBytes(statSync(join(dir, file)).size), formatMs(load)]);
+}
+printTable(["input", "size", "load"], inputs);
@@ -0,0 +1,58 @@
+// Parse and codegen scaling across worker threads (zeno -j) on one large
+// module
+//
+//   bun bench/parallel.ts [groups]
+//
+// The module is split at top-level declarations; its chunks are parsed and
+// its declarations generated in parallel, and every thread count must
+// produce the -j1 output byte for byte.
+
+import { join } from "path";
+import { readFileSync, writeFileSync } from "fs";
+import { RUNS, formatMs, generateModule, printTable, runZeno, tracePhases, workDir } from "./common.ts";
+
+const THREADS = [1, 2, 4, 8, 16];
+
+const groups = Number(process.argv[2] ?? 20000);
+const dir = workDir("parallel");
+const source = generateModule(groups);
+writeFileSync(join(dir, "input.zs"), source);
+console.log(`${groups} declaration groups, ${(source.length / 1e6).toFixed(1)} MB, best of ${RUNS}\n`);
+
+let expected: string | undefined;
+let serialParse = 0;
+let serialCodegen = 0;
+const rows: string[][] = [];
+for (const threads of THREADS) {
+  let parse = Infinity;
+  let codegen = Infinity;
+  let total = Infinity;
+  for (let run = 0; run < RUNS; run++) {
+    runZeno(["-j", String(threads), "--trace", "trace.json", "input.zs", "output.ts"], dir);
+    const phases = tracePhases(join(dir, "trace.json"));
+    parse = Math.min(parse, phases.parse);
+    codegen = Math.min(codegen, phases.codegen);
+    total = Math.min(total, phases.total);
+  }
+
+  const output = readFileSync(join(dir, "output.ts"), "utf8");
+  expected ??= output;
+  if (output !== expected) {
+    throw new Error(`-j${threads} output differs from -j1`);
+  }
+
+  if (threads === 1) {
+    serialParse = parse;
+    serialCodegen = codegen;
+  }
+  rows.push([
+    String(threads),
+    formatMs(parse),
+    `${(serialParse / parse).toFixed(2)}x`,
+    formatMs(codegen),
+    `${(serialCodegen / codegen).toFixed(2)}x`,
+    formatMs(total),
+  ]);
+}
+
+printTable(["threads", "parse", "speedup", "codegen", "speedup", "total"], rows);
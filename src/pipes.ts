@@ -0,0 +1,83 @@
+// Runtime view of pipe stage timings from code compiled with `zeno --trace-pipes`
+//
+// Traced modules share one ring of sampled stage timings on globalThis. Only
+// the most recent samples are kept, so aggregates describe recent behaviour.
+
+export interface PipeStageStats {
+  file: string;
+  line: number;
+  samples: number;
+  totalMs: number;
+  meanMs: number;
+  maxMs: number;
+}
+
+interface PipeTraceState {
+  capacity: number;
+  rate: number;
+  countdown: number;
+  next: number;
+  files: string[];
+  lines: number[];
+  sites: Uint32Array;
+  times: Float64Array;
+}
+
+function traceState(): PipeTraceState | undefined {
+  return (globalThis as any).__zenoPipes;
+}
+
+// Per file and line, slowest total first; empty until a traced module has loaded
+export function pipeStats(): PipeStageStats[] {
+  const state = traceState();
+  if (!state) {
+    return [];
+  }
+
+  const stats = new Map<string, PipeStageStats>();
+  const recorded = Math.min(state.next, state.capacity);
+  for (let i = 0; i < recorded; i++) {
+    const site = state.sites[i];
+    const time = state.times[i];
+    const key = `${state.files[site]}:${state.lines[site]}`;
+
+    let entry = stats.get(key);
+    if (!entry) {
+      entry = {
+        file: state.files[site],
+        line: state.lines[site],
+        samples: 0,
+        totalMs: 0,
+        meanMs: 0,
+        maxMs: 0,
+      };
+      stats.set(key, entry);
+    }
+    entry.samples++;
+    entry.totalMs += time;
+    entry.maxMs = Math.max(entry.maxMs, time);
+  }
+
+  const result = [...stats.values()];
+  for (const entry of result) {
+    entry.meanMs = entry.totalMs / entry.samples;
+  }
+  return result.sort((a, b) => b.totalMs - a.totalMs);
+}
+
+export function resetPipeStats(): void {
+  const state = traceState();
+  if (state) {
+    state.next = 0;
+  }
+}
+
+// Time one stage call in every `rate` on average, at random gaps; 1 times
+// every call
+export function setPipeSampleRate(rate: number): void {
+  const state = traceState();
+  if (state) {
+    state.rate = Math.max(1, Math.floor(rate));
+    state.countdown = Math.min(state.countdown, state.rate);
+  }
+}
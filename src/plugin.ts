@@ -1,6 +1,6 @@
 import { plugin } from "bun";
 import { spawn } from "bun";
-import { join } from "node:path";
+import { dirname, join, resolve } from "node:path";
 import { existsSync } from "node:fs";
 
 const BUILD_DIR = join(import.meta.dir, "..", "build");
@@ -32,7 +32,8 @@ async function transpileZenoscript(source: string, _path: string): Promise<strin
   try {
     // Run transpiler
     const process = spawn({
-      cmd: [TRANSPILER_BINARY, tempFile],
+      // Emit plain JavaScript so Bun can skip its TypeScript transform on load
+      cmd: [TRANSPILER_BINARY, "--emit", "js", tempFile],
       stdout: "pipe",
       stderr: "pipe",
     });
@@ -44,8 +45,8 @@ async function transpileZenoscript(source: string, _path: string): Promise<strin
       throw new Error(`Zenoscript transpilation failed: ${stderr}`);
     }
 
-    const typescript = await new Response(process.stdout).text();
-    return typescript;
+    const javascript = await new Response(process.stdout).text();
+    return javascript;
   } finally {
     // Cleanup temp file
     await Bun.$`rm -f ${tempFile}`;
@@ -60,11 +61,11 @@ const zenoscriptPlugin = {
       const source = await Bun.file(args.path).text();
 
       try {
-        const typescript = await transpileZenoscript(source, args.path);
+        const javascript = await transpileZenoscript(source, args.path);
 
         return {
-          contents: typescript,
-          loader: "ts", // Treat output as TypeScript
+          contents: javascript,
+          loader: "js", // Output is already type-stripped
         };
       } catch (error) {
         return {
@@ -83,11 +84,11 @@ const zenoscriptPlugin = {
       const source = await Bun.file(args.path).text();
 
       try {
-        const typescript = await transpileZenoscript(source, args.path);
+        const javascript = await transpileZenoscript(source, args.path);
 
         return {
-          contents: typescript,
-          loader: "ts", // Treat output as TypeScript
+          contents: javascript,
+          loader: "js", // Output is already type-stripped
         };
       } catch (error) {
         return {
@@ -101,20 +102,12 @@ const zenoscriptPlugin = {
       }
     });
 
-    // Handle .zs files as entry points
+    // Handle .zs entry points and imports; relative imports resolve against
+    // the importing module, which may itself be a .zs file
     build.onResolve({ filter: /\.zs$/ }, (args) => {
+      const resolveDir = args.resolveDir || (args.importer ? dirname(args.importer) : "");
       return {
-        path: args.path,
-        namespace: "zenoscript",
-      };
-    });
-
-    // Handle relative imports of .zs files
-    build.onResolve({ filter: /^\..*\.zs$/ }, (args) => {
-      const path = require("node:path");
-      const resolvedPath = path.resolve(args.resolveDir, args.path);
-      return {
-        path: resolvedPath,
+        path: resolveDir && args.path.startsWith(".") ? resolve(resolveDir, args.path) : args.path,
         namespace: "zenoscript",
       };
     });
@@ -1,4 +1,5 @@
 #include "ast.h"
+#include "intern.h"
 
 ASTNode* ast_node_new(ASTNodeType type) {
     ASTNode* node = malloc(sizeof(ASTNode));
@@ -7,133 +8,50 @@ ASTNode* ast_node_new(ASTNodeType type) {
     return node;
 }
 
+static void ast_stack_push(ASTNode*** stack, int* count, int* capacity, ASTNode* node) {
+    if (!node) return;
+    
+    if (*count >= *capacity) {
+        *capacity *= 2;
+        *stack = realloc(*stack, *capacity * sizeof(ASTNode*));
+    }
+    (*stack)[(*count)++] = node;
+}
+
+// Iterative so that machine-generated pipe chains of any length cannot exhaust the C stack
 void ast_node_free(ASTNode* node) {
     if (!node) return;
     
-    switch (node->type) {
-        case AST_PROGRAM:
-            ast_list_free(node->program.declarations);
-            break;
-            
-        case AST_STRUCT_DECL:
-            free(node->struct_decl.name);
-            ast_list_free(node->struct_decl.generic_params);
-            ast_list_free(node->struct_decl.fields);
-            break;
-            
-        case AST_TRAIT_DECL:
-            free(node->trait_decl.name);
-            ast_list_free(node->trait_decl.generic_params);
-            ast_list_free(node->trait_decl.methods);
-            break;
-            
-        case AST_IMPL_BLOCK:
-            free(node->impl_block.trait_name);
-            free(node->impl_block.type_name);
-            ast_list_free(node->impl_block.generic_params);
-            ast_list_free(node->impl_block.methods);
-            break;
-            
-        case AST_LET_BINDING:
-            free(node->let_binding.name);
-            ast_node_free(node->let_binding.value);
-            ast_node_free(node->let_binding.type_annotation);
-            break;
-            
-        case AST_MATCH_EXPR:
-            ast_node_free(node->match_expr.expr);
-            ast_list_free(node->match_expr.arms);
-            break;
-            
-        case AST_PIPE_EXPR:
-            ast_node_free(node->pipe_expr.left);
-            ast_node_free(node->pipe_expr.right);
-            break;
-            
-        case AST_FUNCTION_DECL:
-            free(node->function_decl.name);
-            ast_list_free(node->function_decl.params);
-            ast_node_free(node->function_decl.return_type);
-            ast_node_free(node->function_decl.body);
-            break;
-            
-        case AST_IDENTIFIER:
-            free(node->identifier.name);
-            break;
-            
-        case AST_NUMBER_LITERAL:
-            free(node->number_literal.value);
-            break;
-            
-        case AST_STRING_LITERAL:
-            free(node->string_literal.value);
-            break;
-            
-        case AST_ATOM_LITERAL:
-            free(node->atom_literal.value);
-            break;
-            
-        case AST_BLOCK:
-            ast_list_free(node->block.statements);
-            break;
-            
-        case AST_FIELD_DECL:
-            free(node->field_decl.name);
-            ast_node_free(node->field_decl.type_annotation);
-            break;
-            
-        case AST_METHOD_DECL:
-            free(node->method_decl.name);
-            ast_list_free(node->method_decl.params);
-            ast_node_free(node->method_decl.return_type);
-            ast_node_free(node->method_decl.body);
-            break;
-            
-        case AST_PARAM_DECL:
-            free(node->param_decl.name);
-            ast_node_free(node->param_decl.type_annotation);
-            break;
-            
-        case AST_TYPE_ANNOTATION:
-            free(node->type_annotation.type_name);
-            ast_list_free(node->type_annotation.generic_args);
-            break;
-            
-        case AST_GENERIC_PARAMS:
-            ast_list_free(node->generic_params.params);
-            break;
-            
-        case AST_MATCH_ARM:
-            ast_node_free(node->match_arm.pattern);
-            ast_node_free(node->match_arm.guard);
-            ast_node_free(node->match_arm.body);
-            break;
-            
-        case AST_PATTERN:
-            ast_node_free(node->pattern.pattern);
-            break;
-            
-        case AST_EXPRESSION:
-            ast_node_free(node->expression.expr);
-            break;
-            
-        case AST_CALL_EXPR:
-            ast_node_free(node->call_expr.function);
-            ast_list_free(node->call_expr.args);
-            break;
-            
-        case AST_MEMBER_ACCESS:
-            ast_node_free(node->member_access.object);
-            free(node->member_access.member);
-            break;
-            
-        case AST_ASSIGNMENT:
-            free(node->assignment.target);
-            ast_node_free(node->assignment.value);
-            break;
+    int capacity = 64;
+    int count = 0;
+    ASTNode** stack = malloc(capacity * sizeof(ASTNode*));
+    ast_stack_push(&stack, &count, &capacity, node);
+    
+    while (count > 0) {
+        ASTNode* current = stack[--count];
+        if (current->type == AST_TYPE_ANNOTATION && current->type_annotation.shared) continue;
+        
+        ASTField fields[AST_MAX_FIELDS];
+        int field_count = ast_node_fields(current, fields);
+        
+        // Strings are interned and not owned by the node
+        for (int i = 0; i < field_count; i++) {
+            if (fields[i].node) {
+                ast_stack_push(&stack, &count, &capacity, *fields[i].node);
+            } else if (fields[i].list && *fields[i].list) {
+                ASTList* list = *fields[i].list;
+                for (int j = 0; j < list->count; j++) {
+                    ast_stack_push(&stack, &count, &capacity, list->nodes[j]);
+                }
+                free(list->nodes);
+                free(list);
+            }
+        }
+        
+        free(current);
     }
     
-    free(node);
+    free(stack);
 }
 
 ASTList* ast_list_new(void) {
@@ -178,34 +96,34 @@ ASTNode* ast_create_program(ASTList* declarations) {
     return node;
 }
 
-ASTNode* ast_create_struct_decl(char* name, ASTList* generic_params, ASTList* fields) {
+ASTNode* ast_create_struct_decl(const char* name, ASTList* generic_params, ASTList* fields) {
     ASTNode* node = ast_node_new(AST_STRUCT_DECL);
-    node->struct_decl.name = strdup(name);
+    node->struct_decl.name = intern(name);
     node->struct_decl.generic_params = generic_params;
     node->struct_decl.fields = fields;
     return node;
 }
 
-ASTNode* ast_create_trait_decl(char* name, ASTList* generic_params, ASTList* methods) {
+ASTNode* ast_create_trait_decl(const char* name, ASTList* generic_params, ASTList* methods) {
     ASTNode* node = ast_node_new(AST_TRAIT_DECL);
-    node->trait_decl.name = strdup(name);
+    node->trait_decl.name = intern(name);
     node->trait_decl.generic_params = generic_params;
     node->trait_decl.methods = methods;
     return node;
 }
 
-ASTNode* ast_create_impl_block(char* trait_name, char* type_name, ASTList* generic_params, ASTList* methods) {
+ASTNode* ast_create_impl_block(const char* trait_name, const char* type_name, ASTList* generic_params, ASTList* methods) {
     ASTNode* node = ast_node_new(AST_IMPL_BLOCK);
-    node->impl_block.trait_name = trait_name ? strdup(trait_name) : NULL;
-    node->impl_block.type_name = strdup(type_name);
+    node->impl_block.trait_name = trait_name ? intern(trait_name) : NULL;
+    node->impl_block.type_name = intern(type_name);
     node->impl_block.generic_params = generic_params;
     node->impl_block.methods = methods;
     return node;
 }
 
-ASTNode* ast_create_let_binding(char* name, ASTNode* value, ASTNode* type_annotation) {
+ASTNode* ast_create_let_binding(const char* name, ASTNode* value, ASTNode* type_annotation) {
     ASTNode* node = ast_node_new(AST_LET_BINDING);
-    node->let_binding.name = strdup(name);
+    node->let_binding.name = intern(name);
     node->let_binding.value = value;
     node->let_binding.type_annotation = type_annotation;
     return node;
@@ -225,27 +143,34 @@ ASTNode* ast_create_pipe_expr(ASTNode* left, ASTNode* right) {
     return node;
 }
 
-ASTNode* ast_create_identifier(char* name) {
+ASTNode* ast_create_lazy_pipe_expr(ASTNode* left, ASTNode* right) {
+    ASTNode* node = ast_node_new(AST_LAZY_PIPE_EXPR);
+    node->pipe_expr.left = left;
+    node->pipe_expr.right = right;
+    return node;
+}
+
+ASTNode* ast_create_identifier(const char* name) {
     ASTNode* node = ast_node_new(AST_IDENTIFIER);
-    node->identifier.name = strdup(name);
+    node->identifier.name = intern(name);
     return node;
 }
 
-ASTNode* ast_create_number_literal(char* value) {
+ASTNode* ast_create_number_literal(const char* value) {
     ASTNode* node = ast_node_new(AST_NUMBER_LITERAL);
-    node->number_literal.value = strdup(value);
+    node->number_literal.value = intern(value);
     return node;
 }
 
-ASTNode* ast_create_string_literal(char* value) {
+ASTNode* ast_create_string_literal(const char* value) {
     ASTNode* node = ast_node_new(AST_STRING_LITERAL);
-    node->string_literal.value = strdup(value);
+    node->string_literal.value = intern(value);
     return node;
 }
 
-ASTNode* ast_create_atom_literal(char* value) {
+ASTNode* ast_create_atom_literal(const char* value) {
     ASTNode* node = ast_node_new(AST_ATOM_LITERAL);
-    node->atom_literal.value = strdup(value);
+    node->atom_literal.value = intern(value);
     return node;
 }
 
@@ -255,22 +180,32 @@ ASTNode* ast_create_block(ASTList* statements) {
     return node;
 }
 
-ASTNode* ast_create_field_decl(char* name, ASTNode* type_annotation) {
+ASTNode* ast_create_field_decl(const char* name, ASTNode* type_annotation) {
     ASTNode* node = ast_node_new(AST_FIELD_DECL);
-    node->field_decl.name = strdup(name);
+    node->field_decl.name = intern(name);
     node->field_decl.type_annotation = type_annotation;
     return node;
 }
 
-ASTNode* ast_create_method_decl(char* name, ASTList* params, ASTNode* return_type, ASTNode* body) {
+ASTNode* ast_create_method_decl(const char* name, ASTList* params, ASTNode* return_type, ASTNode* body) {
     ASTNode* node = ast_node_new(AST_METHOD_DECL);
-    node->method_decl.name = strdup(name);
+    node->method_decl.name = intern(name);
     node->method_decl.params = params;
     node->method_decl.return_type = return_type;
     node->method_decl.body = body;
     return node;
 }
 
+// Lambdas are anonymous function declarations, with a NULL name
+ASTNode* ast_create_function_decl(const char* name, ASTList* params, ASTNode* return_type, ASTNode* body) {
+    ASTNode* node = ast_node_new(AST_FUNCTION_DECL);
+    node->function_decl.name = name ? intern(name) : NULL;
+    node->function_decl.params = params;
+    node->function_decl.return_type = return_type;
+    node->function_decl.body = body;
+    return node;
+}
+
 ASTNode* ast_create_call_expr(ASTNode* function, ASTList* args) {
     ASTNode* node = ast_node_new(AST_CALL_EXPR);
     node->call_expr.function = function;
@@ -278,6 +213,300 @@ ASTNode* ast_create_call_expr(ASTNode* function, ASTList* args) {
     return node;
 }
 
+ASTNode* ast_create_member_access(ASTNode* object, const char* member) {
+    ASTNode* node = ast_node_new(AST_MEMBER_ACCESS);
+    node->member_access.object = object;
+    node->member_access.member = intern(member);
+    return node;
+}
+
+ASTNode* ast_create_array_pattern(ASTList* elements, const char* rest) {
+    ASTNode* node = ast_node_new(AST_ARRAY_PATTERN);
+    node->array_pattern.elements = elements;
+    node->array_pattern.rest = rest ? intern(rest) : NULL;
+    return node;
+}
+
+ASTNode* ast_create_object_pattern(ASTList* fields) {
+    ASTNode* node = ast_node_new(AST_OBJECT_PATTERN);
+    node->object_pattern.fields = fields;
+    return node;
+}
+
+ASTNode* ast_create_field_pattern(const char* key, ASTNode* pattern) {
+    ASTNode* node = ast_node_new(AST_FIELD_PATTERN);
+    node->field_pattern.key = intern(key);
+    node->field_pattern.pattern = pattern;
+    return node;
+}
+
+ASTNode* ast_create_await_expr(ASTNode* argument) {
+    ASTNode* node = ast_node_new(AST_AWAIT_EXPR);
+    node->await_expr.argument = argument;
+    return node;
+}
+
+ASTNode* ast_create_array_literal(ASTList* elements) {
+    ASTNode* node = ast_node_new(AST_ARRAY_LITERAL);
+    node->array_literal.elements = elements;
+    return node;
+}
+
+ASTNode* ast_create_object_literal(ASTList* properties) {
+    ASTNode* node = ast_node_new(AST_OBJECT_LITERAL);
+    node->object_literal.properties = properties;
+    return node;
+}
+
+ASTNode* ast_create_property(const char* key, ASTNode* value) {
+    ASTNode* node = ast_node_new(AST_PROPERTY);
+    node->property.key = intern(key);
+    node->property.value = value;
+    return node;
+}
+
+ASTNode* ast_create_lazy_expr(ASTNode* value) {
+    ASTNode* node = ast_node_new(AST_LAZY_EXPR);
+    node->lazy_expr.value = value;
+    return node;
+}
+
+ASTNode* ast_create_import_decl(const char* source, ASTList* specifiers) {
+    ASTNode* node = ast_node_new(AST_IMPORT_DECL);
+    node->import_decl.source = intern(source);
+    node->import_decl.specifiers = specifiers;
+    return node;
+}
+
+ASTNode* ast_create_import_specifier(const char* imported, const char* local) {
+    ASTNode* node = ast_node_new(AST_IMPORT_SPECIFIER);
+    node->import_specifier.imported = intern(imported);
+    node->import_specifier.local = intern(local);
+    return node;
+}
+
+ASTNode* ast_create_export_decl(ASTNode* declaration) {
+    ASTNode* node = ast_node_new(AST_EXPORT_DECL);
+    node->export_decl.declaration = declaration;
+    return node;
+}
+
+ASTNode* ast_create_export_default(ASTNode* value) {
+    ASTNode* node = ast_node_new(AST_EXPORT_DEFAULT);
+    node->export_default.value = value;
+    return node;
+}
+
+ASTNode* ast_unwrap_export(ASTNode* decl) {
+    if (decl && decl->type == AST_EXPORT_DECL && decl->export_decl.declaration) {
+        return decl->export_decl.declaration;
+    }
+    return decl;
+}
+
+// Field kinds per node type, in union order: 'S' string, 'N' node, 'L' list;
+// lower case if the parser may leave it NULL
+const char* ast_node_layout(ASTNodeType type) {
+    switch (type) {
+        case AST_PROGRAM:         return "L";
+        case AST_STRUCT_DECL:     return "SlL";
+        case AST_TRAIT_DECL:      return "SlL";
+        case AST_IMPL_BLOCK:      return "sSlL";
+        case AST_LET_BINDING:     return "SNn";
+        case AST_MATCH_EXPR:      return "NL";
+        case AST_PIPE_EXPR:       return "NN";
+        case AST_FUNCTION_DECL:   return "slnn";
+        case AST_IDENTIFIER:      return "S";
+        case AST_NUMBER_LITERAL:  return "S";
+        case AST_STRING_LITERAL:  return "S";
+        case AST_ATOM_LITERAL:    return "S";
+        case AST_BLOCK:           return "L";
+        case AST_FIELD_DECL:      return "Sn";
+        case AST_METHOD_DECL:     return "SLnn";
+        case AST_PARAM_DECL:      return "Sn";
+        case AST_TYPE_ANNOTATION: return "Sl";
+        case AST_GENERIC_PARAMS:  return "L";
+        case AST_MATCH_ARM:       return "NnN";
+        case AST_PATTERN:         return "N";
+        case AST_EXPRESSION:      return "N";
+        case AST_CALL_EXPR:       return "NL";
+        case AST_MEMBER_ACCESS:   return "NS";
+        case AST_ASSIGNMENT:      return "SN";
+        case AST_ARRAY_PATTERN:   return "Ls";
+        case AST_OBJECT_PATTERN:  return "L";
+        case AST_FIELD_PATTERN:   return "SN";
+        case AST_LAZY_PIPE_EXPR:  return "NN";
+        case AST_AWAIT_EXPR:      return "N";
+        case AST_ARRAY_LITERAL:   return "L";
+        case AST_OBJECT_LITERAL:  return "L";
+        case AST_PROPERTY:        return "SN";
+        case AST_LAZY_EXPR:       return "N";
+        case AST_IMPORT_DECL:     return "SL";
+        case AST_IMPORT_SPECIFIER: return "SS";
+        case AST_EXPORT_DECL:     return "N";
+        case AST_EXPORT_DEFAULT:  return "N";
+        default:                  return NULL;
+    }
+}
+
+// Addresses of a node's fields, in the order given by ast_node_layout
+#define FIELD_S(key, field) fields[count].name = key; fields[count++].string = &(field)
+#define FIELD_N(key, field) fields[count].name = key; fields[count++].node = &(field)
+#define FIELD_L(key, field) fields[count].name = key; fields[count++].list = &(field)
+
+int ast_node_fields(ASTNode* node, ASTField* fields) {
+    int count = 0;
+    memset(fields, 0, AST_MAX_FIELDS * sizeof(ASTField));
+
+    switch (node->type) {
+        case AST_PROGRAM:
+            FIELD_L("declarations", node->program.declarations);
+            break;
+        case AST_STRUCT_DECL:
+            FIELD_S("name", node->struct_decl.name);
+            FIELD_L("generic_params", node->struct_decl.generic_params);
+            FIELD_L("fields", node->struct_decl.fields);
+            break;
+        case AST_TRAIT_DECL:
+            FIELD_S("name", node->trait_decl.name);
+            FIELD_L("generic_params", node->trait_decl.generic_params);
+            FIELD_L("methods", node->trait_decl.methods);
+            break;
+        case AST_IMPL_BLOCK:
+            FIELD_S("trait_name", node->impl_block.trait_name);
+            FIELD_S("type_name", node->impl_block.type_name);
+            FIELD_L("generic_params", node->impl_block.generic_params);
+            FIELD_L("methods", node->impl_block.methods);
+            break;
+        case AST_LET_BINDING:
+            FIELD_S("name", node->let_binding.name);
+            FIELD_N("value", node->let_binding.value);
+            FIELD_N("type_annotation", node->let_binding.type_annotation);
+            break;
+        case AST_MATCH_EXPR:
+            FIELD_N("expr", node->match_expr.expr);
+            FIELD_L("arms", node->match_expr.arms);
+            break;
+        case AST_PIPE_EXPR:
+        case AST_LAZY_PIPE_EXPR:
+            FIELD_N("left", node->pipe_expr.left);
+            FIELD_N("right", node->pipe_expr.right);
+            break;
+        case AST_FUNCTION_DECL:
+            FIELD_S("name", node->function_decl.name);
+            FIELD_L("params", node->function_decl.params);
+            FIELD_N("return_type", node->function_decl.return_type);
+            FIELD_N("body", node->function_decl.body);
+            break;
+        case AST_IDENTIFIER:
+            FIELD_S("name", node->identifier.name);
+            break;
+        case AST_NUMBER_LITERAL:
+            FIELD_S("value", node->number_literal.value);
+            break;
+        case AST_STRING_LITERAL:
+            FIELD_S("value", node->string_literal.value);
+            break;
+        case AST_ATOM_LITERAL:
+            FIELD_S("value", node->atom_literal.value);
+            break;
+        case AST_BLOCK:
+            FIELD_L("statements", node->block.statements);
+            break;
+        case AST_FIELD_DECL:
+            FIELD_S("name", node->field_decl.name);
+            FIELD_N("type_annotation", node->field_decl.type_annotation);
+            break;
+        case AST_METHOD_DECL:
+            FIELD_S("name", node->method_decl.name);
+            FIELD_L("params", node->method_decl.params);
+            FIELD_N("return_type", node->method_decl.return_type);
+            FIELD_N("body", node->method_decl.body);
+            break;
+        case AST_PARAM_DECL:
+            FIELD_S("name", node->param_decl.name);
+            FIELD_N("type_annotation", node->param_decl.type_annotation);
+            break;
+        case AST_TYPE_ANNOTATION:
+            FIELD_S("type_name", node->type_annotation.type_name);
+            FIELD_L("generic_args", node->type_annotation.generic_args);
+            break;
+        case AST_GENERIC_PARAMS:
+            FIELD_L("params", node->generic_params.params);
+            break;
+        case AST_MATCH_ARM:
+            FIELD_N("pattern", node->match_arm.pattern);
+            FIELD_N("guard", node->match_arm.guard);
+            FIELD_N("body", node->match_arm.body);
+            break;
+        case AST_PATTERN:
+            FIELD_N("pattern", node->pattern.pattern);
+            break;
+        case AST_EXPRESSION:
+            FIELD_N("expr", node->expression.expr);
+            break;
+        case AST_CALL_EXPR:
+            FIELD_N("function", node->call_expr.function);
+            FIELD_L("args", node->call_expr.args);
+            break;
+        case AST_MEMBER_ACCESS:
+            FIELD_N("object", node->member_access.object);
+            FIELD_S("member", node->member_access.member);
+            break;
+        case AST_ASSIGNMENT:
+            FIELD_S("target", node->assignment.target);
+            FIELD_N("value", node->assignment.value);
+            break;
+        case AST_ARRAY_PATTERN:
+            FIELD_L("elements", node->array_pattern.elements);
+            FIELD_S("rest", node->array_pattern.rest);
+            break;
+        case AST_OBJECT_PATTERN:
+            FIELD_L("fields", node->object_pattern.fields);
+            break;
+        case AST_FIELD_PATTERN:
+            FIELD_S("key", node->field_pattern.key);
+            FIELD_N("pattern", node->field_pattern.pattern);
+            break;
+        case AST_AWAIT_EXPR:
+            FIELD_N("argument", node->await_expr.argument);
+            break;
+        case AST_ARRAY_LITERAL:
+            FIELD_L("elements", node->array_literal.elements);
+            break;
+        case AST_OBJECT_LITERAL:
+            FIELD_L("properties", node->object_literal.properties);
+            break;
+        case AST_PROPERTY:
+            FIELD_S("key", node->property.key);
+            FIELD_N("value", node->property.value);
+            break;
+        case AST_LAZY_EXPR:
+            FIELD_N("value", node->lazy_expr.value);
+            break;
+        case AST_IMPORT_DECL:
+            FIELD_S("source", node->import_decl.source);
+            FIELD_L("specifiers", node->import_decl.specifiers);
+            break;
+        case AST_IMPORT_SPECIFIER:
+            FIELD_S("imported", node->import_specifier.imported);
+            FIELD_S("local", node->import_specifier.local);
+            break;
+        case AST_EXPORT_DECL:
+            FIELD_N("declaration", node->export_decl.declaration);
+            break;
+        case AST_EXPORT_DEFAULT:
+            FIELD_N("value", node->export_default.value);
+            break;
+    }
+
+    return count;
+}
+
+#undef FIELD_S
+#undef FIELD_N
+#undef FIELD_L
+
 const char* ast_node_type_to_string(ASTNodeType type) {
     switch (type) {
         case AST_PROGRAM: return "PROGRAM";
@@ -304,77 +533,202 @@ const char* ast_node_type_to_string(ASTNodeType type) {
         case AST_CALL_EXPR: return "CALL_EXPR";
         case AST_MEMBER_ACCESS: return "MEMBER_ACCESS";
         case AST_ASSIGNMENT: return "ASSIGNMENT";
+        case AST_ARRAY_PATTERN: return "ARRAY_PATTERN";
+        case AST_OBJECT_PATTERN: return "OBJECT_PATTERN";
+        case AST_FIELD_PATTERN: return "FIELD_PATTERN";
+        case AST_LAZY_PIPE_EXPR: return "LAZY_PIPE_EXPR";
+        case AST_AWAIT_EXPR: return "AWAIT_EXPR";
+        case AST_ARRAY_LITERAL: return "ARRAY_LITERAL";
+        case AST_OBJECT_LITERAL: return "OBJECT_LITERAL";
+        case AST_PROPERTY: return "PROPERTY";
+        case AST_LAZY_EXPR: return "LAZY_EXPR";
+        case AST_IMPORT_DECL: return "IMPORT_DECL";
+        case AST_IMPORT_SPECIFIER: return "IMPORT_SPECIFIER";
+        case AST_EXPORT_DECL: return "EXPORT_DECL";
+        case AST_EXPORT_DEFAULT: return "EXPORT_DEFAULT";
         default: return "UNKNOWN";
     }
 }
 
-void ast_print(ASTNode* node, int indent) {
+typedef struct {
+    ASTNode* node;
+    int indent;
+} ASTPrintFrame;
+
+static void ast_print_push(ASTPrintFrame** stack, int* count, int* capacity, ASTNode* node, int indent) {
     if (!node) return;
     
-    for (int i = 0; i < indent; i++) {
-        printf("  ");
+    if (*count >= *capacity) {
+        *capacity *= 2;
+        *stack = realloc(*stack, *capacity * sizeof(ASTPrintFrame));
     }
+    (*stack)[*count].node = node;
+    (*stack)[*count].indent = indent;
+    (*count)++;
+}
+
+static void ast_print_push_list(ASTPrintFrame** stack, int* count, int* capacity, ASTList* list, int indent) {
+    if (!list) return;
     
-    printf("%s", ast_node_type_to_string(node->type));
-    
-    switch (node->type) {
-        case AST_IDENTIFIER:
-            printf(": %s", node->identifier.name);
-            break;
-        case AST_NUMBER_LITERAL:
-            printf(": %s", node->number_literal.value);
-            break;
-        case AST_STRING_LITERAL:
-            printf(": \"%s\"", node->string_literal.value);
-            break;
-        case AST_ATOM_LITERAL:
-            printf(": %s", node->atom_literal.value);
-            break;
-        case AST_STRUCT_DECL:
-            printf(": %s", node->struct_decl.name);
-            break;
-        case AST_TRAIT_DECL:
-            printf(": %s", node->trait_decl.name);
-            break;
-        case AST_LET_BINDING:
-            printf(": %s", node->let_binding.name);
-            break;
-        default:
-            break;
+    // Pushed in reverse so they pop in source order
+    for (int i = list->count - 1; i >= 0; i--) {
+        ast_print_push(stack, count, capacity, list->nodes[i], indent);
     }
-    
-    printf("\n");
-    
-    // Print child nodes
-    switch (node->type) {
-        case AST_PROGRAM:
-            if (node->program.declarations) {
-                for (int i = 0; i < node->program.declarations->count; i++) {
-                    ast_print(node->program.declarations->nodes[i], indent + 1);
-                }
+}
+
+// Preorder without recursion, so chains of any depth are safe
+void ast_walk(ASTNode* root, void (*visit)(ASTNode* node, void* context), void* context) {
+    int capacity = 64;
+    int count = 0;
+    ASTNode** stack = malloc(capacity * sizeof(ASTNode*));
+    if (root) stack[count++] = root;
+
+    while (count > 0) {
+        ASTNode* node = stack[--count];
+        visit(node, context);
+
+        // Push children last-to-first so the first child is visited next
+        ASTField fields[AST_MAX_FIELDS];
+        int field_count = ast_node_fields(node, fields);
+        for (int i = field_count - 1; i >= 0; i--) {
+            ASTNode** children;
+            int child_count;
+            if (fields[i].node) {
+                children = fields[i].node;
+                child_count = 1;
+            } else if (fields[i].list && *fields[i].list) {
+                children = (*fields[i].list)->nodes;
+                child_count = (*fields[i].list)->count;
+            } else {
+                continue;
             }
-            break;
-            
-        case AST_STRUCT_DECL:
-            if (node->struct_decl.fields) {
-                for (int i = 0; i < node->struct_decl.fields->count; i++) {
-                    ast_print(node->struct_decl.fields->nodes[i], indent + 1);
+
+            for (int j = child_count - 1; j >= 0; j--) {
+                if (!children[j]) continue;
+                if (count >= capacity) {
+                    capacity *= 2;
+                    stack = realloc(stack, capacity * sizeof(ASTNode*));
                 }
+                stack[count++] = children[j];
             }
-            break;
-            
-        case AST_LET_BINDING:
-            if (node->let_binding.value) {
-                ast_print(node->let_binding.value, indent + 1);
-            }
-            break;
-            
-        case AST_PIPE_EXPR:
-            ast_print(node->pipe_expr.left, indent + 1);
-            ast_print(node->pipe_expr.right, indent + 1);
-            break;
-            
-        default:
-            break;
+        }
     }
+
+    free(stack);
+}
+
+void ast_print(ASTNode* root, int root_indent) {
+    if (!root) return;
+    
+    int capacity = 64;
+    int count = 0;
+    ASTPrintFrame* stack = malloc(capacity * sizeof(ASTPrintFrame));
+    ast_print_push(&stack, &count, &capacity, root, root_indent);
+    
+    while (count > 0) {
+        ASTPrintFrame frame = stack[--count];
+        ASTNode* node = frame.node;
+        int indent = frame.indent;
+        
+        for (int i = 0; i < indent; i++) {
+            printf("  ");
+        }
+        
+        printf("%s", ast_node_type_to_string(node->type));
+        
+        switch (node->type) {
+            case AST_IDENTIFIER:
+                printf(": %s", node->identifier.name);
+                break;
+            case AST_NUMBER_LITERAL:
+                printf(": %s", node->number_literal.value);
+                break;
+            case AST_STRING_LITERAL:
+                printf(": \"%s\"", node->string_literal.value);
+                break;
+            case AST_ATOM_LITERAL:
+                printf(": %s", node->atom_literal.value);
+                break;
+            case AST_STRUCT_DECL:
+                printf(": %s", node->struct_decl.name);
+                break;
+            case AST_TRAIT_DECL:
+                printf(": %s", node->trait_decl.name);
+                break;
+            case AST_LET_BINDING:
+                printf(": %s", node->let_binding.name);
+                break;
+            case AST_PROPERTY:
+                printf(": %s", node->property.key);
+                break;
+            case AST_IMPORT_DECL:
+                printf(": \"%s\"", node->import_decl.source);
+                break;
+            case AST_IMPORT_SPECIFIER:
+                printf(": %s as %s", node->import_specifier.imported, node->import_specifier.local);
+                break;
+            default:
+                break;
+        }
+        
+        printf("\n");
+        
+        // Queue child nodes
+        switch (node->type) {
+            case AST_PROGRAM:
+                ast_print_push_list(&stack, &count, &capacity, node->program.declarations, indent + 1);
+                break;
+                
+            case AST_STRUCT_DECL:
+                ast_print_push_list(&stack, &count, &capacity, node->struct_decl.fields, indent + 1);
+                break;
+                
+            case AST_LET_BINDING:
+                ast_print_push(&stack, &count, &capacity, node->let_binding.value, indent + 1);
+                break;
+                
+            case AST_PIPE_EXPR:
+            case AST_LAZY_PIPE_EXPR:
+                ast_print_push(&stack, &count, &capacity, node->pipe_expr.right, indent + 1);
+                ast_print_push(&stack, &count, &capacity, node->pipe_expr.left, indent + 1);
+                break;
+                
+            case AST_AWAIT_EXPR:
+                ast_print_push(&stack, &count, &capacity, node->await_expr.argument, indent + 1);
+                break;
+                
+            case AST_ARRAY_LITERAL:
+                ast_print_push_list(&stack, &count, &capacity, node->array_literal.elements, indent + 1);
+                break;
+                
+            case AST_OBJECT_LITERAL:
+                ast_print_push_list(&stack, &count, &capacity, node->object_literal.properties, indent + 1);
+                break;
+                
+            case AST_PROPERTY:
+                ast_print_push(&stack, &count, &capacity, node->property.value, indent + 1);
+                break;
+                
+            case AST_LAZY_EXPR:
+                ast_print_push(&stack, &count, &capacity, node->lazy_expr.value, indent + 1);
+                break;
+                
+            case AST_IMPORT_DECL:
+                ast_print_push_list(&stack, &count, &capacity, node->import_decl.specifiers, indent + 1);
+                break;
+                
+            case AST_EXPORT_DECL:
+                ast_print_push(&stack, &count, &capacity, node->export_decl.declaration, indent + 1);
+                break;
+                
+            case AST_EXPORT_DEFAULT:
+                ast_print_push(&stack, &count, &capacity, node->export_default.value, indent + 1);
+                break;
+                
+            default:
+                break;
+        }
+    }
+    
+    free(stack);
 }
\ No newline at end of file
@@ -34,7 +34,20 @@ typedef enum {
     AST_EXPRESSION,
     AST_CALL_EXPR,
     AST_MEMBER_ACCESS,
-    AST_ASSIGNMENT
+    AST_ASSIGNMENT,
+    AST_ARRAY_PATTERN,
+    AST_OBJECT_PATTERN,
+    AST_FIELD_PATTERN,
+    AST_LAZY_PIPE_EXPR,
+    AST_AWAIT_EXPR,
+    AST_ARRAY_LITERAL,
+    AST_OBJECT_LITERAL,
+    AST_PROPERTY,
+    AST_LAZY_EXPR,
+    AST_IMPORT_DECL,
+    AST_IMPORT_SPECIFIER,
+    AST_EXPORT_DECL,
+    AST_EXPORT_DEFAULT
 } ASTNodeType;
 
 // Generic list structure for AST nodes
@@ -44,7 +57,8 @@ struct ASTList {
     int capacity;
 };
 
-// Main AST node structure
+// Main AST node structure. Every string in a node is interned (see intern.h):
+// nodes do not own their strings, and equal names share one pointer.
 struct ASTNode {
     ASTNodeType type;
     int line;
@@ -56,26 +70,26 @@ struct ASTNode {
         } program;
         
         struct {
-            char* name;
+            const char* name;
             ASTList* generic_params;
             ASTList* fields;
         } struct_decl;
         
         struct {
-            char* name;
+            const char* name;
             ASTList* generic_params;
             ASTList* methods;
         } trait_decl;
         
         struct {
-            char* trait_name;
-            char* type_name;
+            const char* trait_name;
+            const char* type_name;
             ASTList* generic_params;
             ASTList* methods;
         } impl_block;
         
         struct {
-            char* name;
+            const char* name;
             ASTNode* value;
             ASTNode* type_annotation;
         } let_binding;
@@ -83,34 +97,37 @@ struct ASTNode {
         struct {
             ASTNode* expr;
             ASTList* arms;
+            int exhaustive_arms;    // Set by match_check_exhaustive: the first n arms always match, 0 if unproven
         } match_expr;
         
         struct {
             ASTNode* left;
             ASTNode* right;
-        } pipe_expr;
+        } pipe_expr;            // Also AST_LAZY_PIPE_EXPR
         
         struct {
-            char* name;
+            const char* name;
             ASTList* params;
             ASTNode* return_type;
             ASTNode* body;
+            int tail_loop;          // Set by tailcall_mark: self tail calls become loop iterations
         } function_decl;
         
         struct {
-            char* name;
+            const char* name;
+            int lazy;               // Set by lazy_mark: reads a deferred top-level let
         } identifier;
         
         struct {
-            char* value;
+            const char* value;
         } number_literal;
         
         struct {
-            char* value;
+            const char* value;
         } string_literal;
         
         struct {
-            char* value;
+            const char* value;
         } atom_literal;
         
         struct {
@@ -118,25 +135,26 @@ struct ASTNode {
         } block;
         
         struct {
-            char* name;
+            const char* name;
             ASTNode* type_annotation;
         } field_decl;
         
         struct {
-            char* name;
+            const char* name;
             ASTList* params;
             ASTNode* return_type;
             ASTNode* body;
         } method_decl;
         
         struct {
-            char* name;
+            const char* name;
             ASTNode* type_annotation;
         } param_decl;
         
         struct {
-            char* type_name;
+            const char* type_name;
             ASTList* generic_args;
+            int shared;     // Owned by the type table (see types.h), never freed with the tree
         } type_annotation;
         
         struct {
@@ -160,20 +178,85 @@ struct ASTNode {
         struct {
             ASTNode* function;
             ASTList* args;
+            int tail_call;          // Set by tailcall_mark: a self call in tail position
         } call_expr;
         
         struct {
             ASTNode* object;
-            char* member;
+            const char* member;
         } member_access;
         
         struct {
-            char* target;
+            const char* target;
             ASTNode* value;
         } assignment;
+        
+        struct {
+            ASTList* elements;
+            const char* rest;       // ...rest binds the remaining elements; NULL without one
+        } array_pattern;
+        
+        struct {
+            ASTList* fields;        // FIELD_PATTERN nodes
+        } object_pattern;
+        
+        struct {
+            const char* key;
+            ASTNode* pattern;       // { key } is stored as { key: key }
+        } field_pattern;
+        
+        struct {
+            ASTNode* argument;
+        } await_expr;
+        
+        struct {
+            ASTList* elements;
+        } array_literal;
+        
+        struct {
+            ASTList* properties;    // PROPERTY nodes
+        } object_literal;
+        
+        struct {
+            const char* key;
+            ASTNode* value;
+        } property;
+        
+        struct {
+            ASTNode* value;         // The initializer of a `lazy let`
+            int deferred;           // Set by lazy_mark: evaluated on first use
+        } lazy_expr;
+        
+        struct {
+            const char* source;     // The module specifier, as written
+            ASTList* specifiers;    // IMPORT_SPECIFIER nodes; empty for `import "source"`
+        } import_decl;
+        
+        struct {
+            const char* imported;   // "default" for a default import, "*" for a namespace
+            const char* local;
+        } import_specifier;
+        
+        struct {
+            ASTNode* declaration;   // A STRUCT_DECL, TRAIT_DECL, IMPL_BLOCK or LET_BINDING
+        } export_decl;
+        
+        struct {
+            ASTNode* value;
+        } export_default;
     };
 };
 
+// Generic view of a node's fields, for serializers that walk every node type
+#define AST_MAX_FIELDS 4
+
+typedef struct {
+    const char* name;
+    const char** string;
+    ASTNode** node;
+    ASTList** list;
+} ASTField;
+
 // Function prototypes
 ASTNode* ast_node_new(ASTNodeType type);
 void ast_node_free(ASTNode* node);
@@ -184,23 +267,46 @@ ASTNode* ast_list_get(ASTList* list, int index);
 
 // AST creation helpers
 ASTNode* ast_create_program(ASTList* declarations);
-ASTNode* ast_create_struct_decl(char* name, ASTList* generic_params, ASTList* fields);
-ASTNode* ast_create_trait_decl(char* name, ASTList* generic_params, ASTList* methods);
-ASTNode* ast_create_impl_block(char* trait_name, char* type_name, ASTList* generic_params, ASTList* methods);
-ASTNode* ast_create_let_binding(char* name, ASTNode* value, ASTNode* type_annotation);
+ASTNode* ast_create_struct_decl(const char* name, ASTList* generic_params, ASTList* fields);
+ASTNode* ast_create_trait_decl(const char* name, ASTList* generic_params, ASTList* methods);
+ASTNode* ast_create_impl_block(const char* trait_name, const char* type_name, ASTList* generic_params, ASTList* methods);
+ASTNode* ast_create_let_binding(const char* name, ASTNode* value, ASTNode* type_annotation);
 ASTNode* ast_create_match_expr(ASTNode* expr, ASTList* arms);
 ASTNode* ast_create_pipe_expr(ASTNode* left, ASTNode* right);
-ASTNode* ast_create_identifier(char* name);
-ASTNode* ast_create_number_literal(char* value);
-ASTNode* ast_create_string_literal(char* value);
-ASTNode* ast_create_atom_literal(char* value);
+ASTNode* ast_create_lazy_pipe_expr(ASTNode* left, ASTNode* right);
+ASTNode* ast_create_identifier(const char* name);
+ASTNode* ast_create_number_literal(const char* value);
+ASTNode* ast_create_string_literal(const char* value);
+ASTNode* ast_create_atom_literal(const char* value);
 ASTNode* ast_create_block(ASTList* statements);
-ASTNode* ast_create_field_decl(char* name, ASTNode* type_annotation);
-ASTNode* ast_create_method_decl(char* name, ASTList* params, ASTNode* return_type, ASTNode* body);
+ASTNode* ast_create_field_decl(const char* name, ASTNode* type_annotation);
+ASTNode* ast_create_method_decl(const char* name, ASTList* params, ASTNode* return_type, ASTNode* body);
+ASTNode* ast_create_function_decl(const char* name, ASTList* params, ASTNode* return_type, ASTNode* body);
 ASTNode* ast_create_call_expr(ASTNode* function, ASTList* args);
+ASTNode* ast_create_member_access(ASTNode* object, const char* member);
+ASTNode* ast_create_array_pattern(ASTList* elements, const char* rest);
+ASTNode* ast_create_object_pattern(ASTList* fields);
+ASTNode* ast_create_field_pattern(const char* key, ASTNode* pattern);
+ASTNode* ast_create_await_expr(ASTNode* argument);
+ASTNode* ast_create_array_literal(ASTList* elements);
+ASTNode* ast_create_object_literal(ASTList* properties);
+ASTNode* ast_create_property(const char* key, ASTNode* value);
+ASTNode* ast_create_lazy_expr(ASTNode* value);
+ASTNode* ast_create_import_decl(const char* source, ASTList* specifiers);
+ASTNode* ast_create_import_specifier(const char* imported, const char* local);
+ASTNode* ast_create_export_decl(ASTNode* declaration);
+ASTNode* ast_create_export_default(ASTNode* value);
+
+// The declaration an `export` wraps, or decl itself
+ASTNode* ast_unwrap_export(ASTNode* decl);
 
 // Utility functions
 void ast_print(ASTNode* node, int indent);
 const char* ast_node_type_to_string(ASTNodeType type);
+const char* ast_node_layout(ASTNodeType type);
+int ast_node_fields(ASTNode* node, ASTField* fields);
+
+// Visit every node of a tree in source preorder
+void ast_walk(ASTNode* root, void (*visit)(ASTNode* node, void* context), void* context);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,570 @@
+#include "astbin.h"
+#include "intern.h"
+#include "types.h"
+#include <ctype.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ASTBIN_HEADER_SIZE 40
+#define ASTBIN_RECORD_SIZE (12 + 4 * ASTBIN_SLOTS)
+
+static void astbin_put_u32(unsigned char* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t astbin_get_u32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint32_t astbin_checksum(const unsigned char* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+// Encoder
+
+typedef struct {
+    unsigned char* data;
+    size_t length;
+    size_t capacity;
+} ASTBinBuffer;
+
+// One frame per node whose slots are still being encoded
+typedef struct {
+    size_t record;          // Offset of the node's record in the node buffer
+    ASTField fields[ASTBIN_SLOTS];
+    int field_count;
+    int field;              // Next slot to encode
+    int item;               // Next item of the current list slot, -1 before the list is reserved
+    uint32_t list;          // Offset of the current list in the list buffer
+} ASTBinEncodeFrame;
+
+typedef struct {
+    ASTBinBuffer nodes;
+    ASTBinBuffer lists;
+    ASTBinBuffer strings;
+    ASTBinEncodeFrame* frames;
+    int frame_count;
+    int frame_capacity;
+    uint32_t node_count;
+    uint32_t* string_slots;     // Open-addressing set of string offsets + 1, 0 is empty
+    uint32_t string_capacity;
+    uint32_t string_count;
+} ASTBinEncoder;
+
+// Append size zeroed bytes and return their offset
+static size_t astbin_reserve(ASTBinBuffer* buffer, size_t size) {
+    if (buffer->length + size > buffer->capacity) {
+        buffer->capacity = buffer->capacity == 0 ? 4096 : buffer->capacity * 2;
+        while (buffer->length + size > buffer->capacity) {
+            buffer->capacity *= 2;
+        }
+        buffer->data = realloc(buffer->data, buffer->capacity);
+    }
+
+    size_t offset = buffer->length;
+    memset(buffer->data + offset, 0, size);
+    buffer->length += size;
+    return offset;
+}
+
+static uint32_t astbin_hash(const char* str) {
+    uint32_t hash = 5381;
+    int c;
+    while ((c = (unsigned char)*str++)) {
+        hash = ((hash << 5) + hash) + c;
+    }
+    return hash;
+}
+
+static void astbin_grow_strings(ASTBinEncoder* enc) {
+    uint32_t old_capacity = enc->string_capacity;
+    uint32_t* old_slots = enc->string_slots;
+
+    enc->string_capacity = old_capacity == 0 ? 256 : old_capacity * 2;
+    enc->string_slots = calloc(enc->string_capacity, sizeof(uint32_t));
+
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (!old_slots[i]) continue;
+
+        const char* str = (const char*)enc->strings.data + old_slots[i] - 1;
+        uint32_t slot = astbin_hash(str) & (enc->string_capacity - 1);
+        while (enc->string_slots[slot]) {
+            slot = (slot + 1) & (enc->string_capacity - 1);
+        }
+        enc->string_slots[slot] = old_slots[i];
+    }
+
+    free(old_slots);
+}
+
+// Identical strings (type names, field names, ...) are stored once
+static uint32_t astbin_encode_string(ASTBinEncoder* enc, const char* str) {
+    if (!str) return ASTBIN_NONE;
+
+    if ((enc->string_count + 1) * 2 > enc->string_capacity) {
+        astbin_grow_strings(enc);
+    }
+
+    uint32_t slot = astbin_hash(str) & (enc->string_capacity - 1);
+    while (enc->string_slots[slot]) {
+        uint32_t offset = enc->string_slots[slot] - 1;
+        if (strcmp((const char*)enc->strings.data + offset, str) == 0) {
+            return offset;
+        }
+        slot = (slot + 1) & (enc->string_capacity - 1);
+    }
+
+    size_t length = strlen(str) + 1;
+    uint32_t offset = astbin_reserve(&enc->strings, length);
+    memcpy(enc->strings.data + offset, str, length);
+
+    enc->string_slots[slot] = offset + 1;
+    enc->string_count++;
+    return offset;
+}
+
+// Assign the next preorder index, write the record header and queue the node's slots
+static uint32_t astbin_open_node(ASTBinEncoder* enc, ASTNode* node) {
+    if (!node) return ASTBIN_NONE;
+
+    uint32_t index = enc->node_count++;
+    size_t record = astbin_reserve(&enc->nodes, ASTBIN_RECORD_SIZE);
+    astbin_put_u32(enc->nodes.data + record, node->type);
+    astbin_put_u32(enc->nodes.data + record + 4, node->line);
+    astbin_put_u32(enc->nodes.data + record + 8, node->column);
+    for (int i = 0; i < ASTBIN_SLOTS; i++) {
+        astbin_put_u32(enc->nodes.data + record + 12 + 4 * i, ASTBIN_NONE);
+    }
+
+    if (enc->frame_count >= enc->frame_capacity) {
+        enc->frame_capacity = enc->frame_capacity == 0 ? 64 : enc->frame_capacity * 2;
+        enc->frames = realloc(enc->frames, enc->frame_capacity * sizeof(ASTBinEncodeFrame));
+    }
+
+    ASTBinEncodeFrame* frame = &enc->frames[enc->frame_count++];
+    frame->record = record;
+    frame->field_count = ast_node_fields(node, frame->fields);
+    frame->field = 0;
+    frame->item = -1;
+    return index;
+}
+
+// Encode a whole tree with an explicit work stack, so deep pipe chains cannot
+// exhaust the C stack. Children are opened as soon as they are reached, which
+// keeps the numbering in preorder.
+static uint32_t astbin_encode_tree(ASTBinEncoder* enc, ASTNode* root) {
+    uint32_t root_index = astbin_open_node(enc, root);
+
+    while (enc->frame_count > 0) {
+        ASTBinEncodeFrame* frame = &enc->frames[enc->frame_count - 1];
+        if (frame->field >= frame->field_count) {
+            enc->frame_count--;
+            continue;
+        }
+
+        // Opening a child may move both the frame stack and the node buffer
+        int slot = frame->field;
+        size_t slot_offset = frame->record + 12 + 4 * slot;
+        ASTField* field = &frame->fields[slot];
+
+        if (field->string) {
+            astbin_put_u32(enc->nodes.data + slot_offset, astbin_encode_string(enc, *field->string));
+            frame->field++;
+        } else if (field->node) {
+            frame->field++;
+            uint32_t child = astbin_open_node(enc, *field->node);
+            astbin_put_u32(enc->nodes.data + slot_offset, child);
+        } else {
+            ASTList* list = *field->list;
+            if (!list) {
+                frame->field++;
+                continue;
+            }
+
+            if (frame->item < 0) {
+                frame->list = astbin_reserve(&enc->lists, 4 * (list->count + 1));
+                astbin_put_u32(enc->lists.data + frame->list, list->count);
+                astbin_put_u32(enc->nodes.data + slot_offset, frame->list);
+                frame->item = 0;
+            }
+
+            if (frame->item < list->count) {
+                int item = frame->item++;
+                uint32_t item_offset = frame->list + 4 * (item + 1);
+                uint32_t child = astbin_open_node(enc, list->nodes[item]);
+                astbin_put_u32(enc->lists.data + item_offset, child);
+            } else {
+                frame->item = -1;
+                frame->field++;
+            }
+        }
+    }
+
+    return root_index;
+}
+
+unsigned char* astbin_encode(ASTNode* root, size_t* size) {
+    ASTBinEncoder enc;
+    memset(&enc, 0, sizeof(enc));
+
+    uint32_t root_index = astbin_encode_tree(&enc, root);
+
+    size_t nodes_offset = ASTBIN_HEADER_SIZE;
+    size_t lists_offset = nodes_offset + enc.nodes.length;
+    size_t strings_offset = lists_offset + enc.lists.length;
+    size_t total = strings_offset + enc.strings.length;
+
+    unsigned char* data = malloc(total);
+    memcpy(data, ASTBIN_MAGIC, 4);
+    astbin_put_u32(data + 4, ASTBIN_VERSION);
+    astbin_put_u32(data + 12, enc.node_count);
+    astbin_put_u32(data + 16, root_index);
+    astbin_put_u32(data + 20, nodes_offset);
+    astbin_put_u32(data + 24, lists_offset);
+    astbin_put_u32(data + 28, enc.lists.length);
+    astbin_put_u32(data + 32, strings_offset);
+    astbin_put_u32(data + 36, enc.strings.length);
+
+    if (enc.nodes.length) memcpy(data + nodes_offset, enc.nodes.data, enc.nodes.length);
+    if (enc.lists.length) memcpy(data + lists_offset, enc.lists.data, enc.lists.length);
+    if (enc.strings.length) memcpy(data + strings_offset, enc.strings.data, enc.strings.length);
+
+    free(enc.nodes.data);
+    free(enc.lists.data);
+    free(enc.strings.data);
+    free(enc.string_slots);
+    free(enc.frames);
+
+    astbin_put_u32(data + 8, astbin_checksum(data + ASTBIN_HEADER_SIZE, total - ASTBIN_HEADER_SIZE));
+
+    *size = total;
+    return data;
+}
+
+int astbin_write_file(const char* filename, ASTNode* root) {
+    size_t size;
+    unsigned char* data = astbin_encode(root, &size);
+
+    FILE* file = filename ? fopen(filename, "wb") : stdout;
+    if (!file) {
+        fprintf(stderr, "Error: Cannot write to file '%s'\n", filename);
+        free(data);
+        return 0;
+    }
+
+    int success = fwrite(data, 1, size, file) == size;
+    if (filename) {
+        fclose(file);
+    }
+
+    free(data);
+    return success;
+}
+
+// Reader
+
+static int astbin_init(ASTBinary* bin) {
+    const unsigned char* data = bin->data;
+
+    if (bin->size < ASTBIN_HEADER_SIZE || memcmp(data, ASTBIN_MAGIC, 4) != 0) {
+        fprintf(stderr, "Error: Not a binary AST\n");
+        return 0;
+    }
+
+    uint32_t version = astbin_get_u32(data + 4);
+    if (version != ASTBIN_VERSION) {
+        fprintf(stderr, "Error: Unsupported binary AST version %u (expected %u)\n", version, ASTBIN_VERSION);
+        return 0;
+    }
+
+    if (astbin_get_u32(data + 8) != astbin_checksum(data + ASTBIN_HEADER_SIZE, bin->size - ASTBIN_HEADER_SIZE)) {
+        fprintf(stderr, "Error: Corrupt binary AST (checksum mismatch)\n");
+        return 0;
+    }
+
+    bin->node_count = astbin_get_u32(data + 12);
+    bin->root = astbin_get_u32(data + 16);
+    uint64_t nodes_offset = astbin_get_u32(data + 20);
+    uint64_t lists_offset = astbin_get_u32(data + 24);
+    bin->lists_size = astbin_get_u32(data + 28);
+    uint64_t strings_offset = astbin_get_u32(data + 32);
+    bin->strings_size = astbin_get_u32(data + 36);
+
+    if (nodes_offset + (uint64_t)bin->node_count * ASTBIN_RECORD_SIZE > bin->size ||
+        lists_offset + bin->lists_size > bin->size ||
+        strings_offset + bin->strings_size > bin->size ||
+        (bin->strings_size > 0 && data[strings_offset + bin->strings_size - 1] != '\0') ||
+        (bin->root != ASTBIN_NONE && bin->root >= bin->node_count)) {
+        fprintf(stderr, "Error: Corrupt binary AST\n");
+        return 0;
+    }
+
+    bin->nodes = data + nodes_offset;
+    bin->lists = data + lists_offset;
+    bin->strings = (const char*)data + strings_offset;
+    return 1;
+}
+
+ASTBinary* astbin_open_memory(const unsigned char* data, size_t size) {
+    ASTBinary* bin = malloc(sizeof(ASTBinary));
+    memset(bin, 0, sizeof(ASTBinary));
+    bin->data = data;
+    bin->size = size;
+
+    if (!astbin_init(bin)) {
+        free(bin);
+        return NULL;
+    }
+    return bin;
+}
+
+ASTBinary* astbin_open(const char* filename) {
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Error: Cannot open file '%s'\n", filename);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        fprintf(stderr, "Error: Cannot read file '%s'\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        fprintf(stderr, "Error: Cannot map file '%s'\n", filename);
+        return NULL;
+    }
+
+    ASTBinary* bin = astbin_open_memory(data, st.st_size);
+    if (!bin) {
+        munmap(data, st.st_size);
+        return NULL;
+    }
+    bin->mapped = 1;
+    return bin;
+}
+
+void astbin_close(ASTBinary* bin) {
+    if (!bin) return;
+
+    if (bin->mapped) {
+        munmap((void*)bin->data, bin->size);
+    }
+    free(bin);
+}
+
+int astbin_is_file(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) return 0;
+
+    char magic[4];
+    int is_binary = fread(magic, 1, 4, file) == 4 && memcmp(magic, ASTBIN_MAGIC, 4) == 0;
+    fclose(file);
+    return is_binary;
+}
+
+static const unsigned char* astbin_record(const ASTBinary* bin, uint32_t node) {
+    return bin->nodes + (size_t)node * ASTBIN_RECORD_SIZE;
+}
+
+ASTNodeType astbin_node_type(const ASTBinary* bin, uint32_t node) {
+    return (ASTNodeType)astbin_get_u32(astbin_record(bin, node));
+}
+
+uint32_t astbin_node_line(const ASTBinary* bin, uint32_t node) {
+    return astbin_get_u32(astbin_record(bin, node) + 4);
+}
+
+uint32_t astbin_node_column(const ASTBinary* bin, uint32_t node) {
+    return astbin_get_u32(astbin_record(bin, node) + 8);
+}
+
+static uint32_t astbin_slot(const ASTBinary* bin, uint32_t node, int slot) {
+    return astbin_get_u32(astbin_record(bin, node) + 12 + 4 * slot);
+}
+
+const char* astbin_node_string(const ASTBinary* bin, uint32_t node, int slot) {
+    uint32_t offset = astbin_slot(bin, node, slot);
+    if (offset == ASTBIN_NONE || offset >= bin->strings_size) return NULL;
+    return bin->strings + offset;
+}
+
+uint32_t astbin_node_child(const ASTBinary* bin, uint32_t node, int slot) {
+    uint32_t child = astbin_slot(bin, node, slot);
+    return child < bin->node_count ? child : ASTBIN_NONE;
+}
+
+uint32_t astbin_list_count(const ASTBinary* bin, uint32_t node, int slot) {
+    uint32_t offset = astbin_slot(bin, node, slot);
+    if (offset == ASTBIN_NONE || (uint64_t)offset + 4 > bin->lists_size) return 0;
+
+    uint32_t count = astbin_get_u32(bin->lists + offset);
+    if ((uint64_t)offset + 4 + (uint64_t)count * 4 > bin->lists_size) return 0;
+    return count;
+}
+
+uint32_t astbin_list_item(const ASTBinary* bin, uint32_t node, int slot, uint32_t index) {
+    if (index >= astbin_list_count(bin, node, slot)) return ASTBIN_NONE;
+
+    uint32_t offset = astbin_slot(bin, node, slot);
+    uint32_t child = astbin_get_u32(bin->lists + offset + 4 * (index + 1));
+    return child < bin->node_count ? child : ASTBIN_NONE;
+}
+
+// Decoder: children must come after their parent, which also rules out cycles
+
+typedef struct {
+    uint32_t index;
+    ASTNode** ref;          // Where the decoded node is stored in its parent
+    const char* layout;
+    ASTField fields[ASTBIN_SLOTS];
+    int field_count;
+    int field;              // Next slot to decode
+    uint32_t item;          // Next item of the current list slot
+} ASTBinDecodeFrame;
+
+typedef struct {
+    const ASTBinary* bin;
+    ASTBinDecodeFrame* frames;
+    int count;
+    int capacity;
+    int ok;
+} ASTBinDecoder;
+
+// Create the node stored at index into *ref and queue its slots
+static void astbin_open_decoded(ASTBinDecoder* dec, uint32_t index, uint32_t parent, ASTNode** ref) {
+    const ASTBinary* bin = dec->bin;
+    if (index >= bin->node_count || (parent != ASTBIN_NONE && index <= parent)) {
+        dec->ok = 0;
+        return;
+    }
+
+    const char* layout = ast_node_layout(astbin_node_type(bin, index));
+    if (!layout) {
+        dec->ok = 0;
+        return;
+    }
+
+    ASTNode* node = ast_node_new(astbin_node_type(bin, index));
+    node->line = astbin_node_line(bin, index);
+    node->column = astbin_node_column(bin, index);
+
+    if (dec->count >= dec->capacity) {
+        dec->capacity = dec->capacity == 0 ? 64 : dec->capacity * 2;
+        dec->frames = realloc(dec->frames, dec->capacity * sizeof(ASTBinDecodeFrame));
+    }
+
+    ASTBinDecodeFrame* frame = &dec->frames[dec->count++];
+    frame->index = index;
+    frame->ref = ref;
+    frame->layout = layout;
+    frame->field_count = ast_node_fields(node, frame->fields);
+    frame->field = 0;
+    frame->item = 0;
+    *ref = node;
+}
+
+ASTNode* astbin_to_ast(const ASTBinary* bin) {
+    ASTBinDecoder dec;
+    memset(&dec, 0, sizeof(dec));
+    dec.bin = bin;
+    dec.ok = 1;
+
+    ASTNode* root = NULL;
+    if (bin->root != ASTBIN_NONE) {
+        astbin_open_decoded(&dec, bin->root, ASTBIN_NONE, &root);
+    }
+
+    while (dec.count > 0 && dec.ok) {
+        ASTBinDecodeFrame* frame = &dec.frames[dec.count - 1];
+        if (frame->field >= frame->field_count) {
+            // Complete types are swapped for their shared node; their arguments already were
+            ASTNode* node = *frame->ref;
+            if (node->type == AST_TYPE_ANNOTATION) {
+                *frame->ref = types_get(node->type_annotation.type_name, node->type_annotation.generic_args);
+                free(node);
+            }
+            dec.count--;
+            continue;
+        }
+
+        // Decoding a child may move the frame stack; node fields stay put
+        int slot = frame->field;
+        uint32_t index = frame->index;
+        char kind = frame->layout[slot];
+        ASTField field = frame->fields[slot];
+        uint32_t value = astbin_slot(bin, index, slot);
+
+        // Upper-case slots are never absent in a parsed tree, and codegen relies on that
+        if (value == ASTBIN_NONE) {
+            if (isupper((unsigned char)kind)) {
+                dec.ok = 0;
+            }
+            frame->field++;
+            continue;
+        }
+
+        switch (toupper((unsigned char)kind)) {
+            case 'S': {
+                const char* str = astbin_node_string(bin, index, slot);
+                if (!str) {
+                    dec.ok = 0;
+                    break;
+                }
+                *field.string = intern(str);
+                frame->field++;
+                break;
+            }
+            case 'N':
+                frame->field++;
+                astbin_open_decoded(&dec, value, index, field.node);
+                break;
+            case 'L': {
+                if (!*field.list) {
+                    *field.list = ast_list_new();
+                }
+
+                uint32_t item = frame->item;
+                if (item >= astbin_list_count(bin, index, slot)) {
+                    frame->item = 0;
+                    frame->field++;
+                    break;
+                }
+
+                frame->item++;
+                uint32_t child = astbin_list_item(bin, index, slot, item);
+                if (child == ASTBIN_NONE) {
+                    dec.ok = 0;
+                    break;
+                }
+
+                ASTList* list = *field.list;
+                ast_list_add(list, NULL);
+                astbin_open_decoded(&dec, child, index, &list->nodes[list->count - 1]);
+                break;
+            }
+        }
+    }
+
+    free(dec.frames);
+
+    if (!dec.ok || !root || root->type != AST_PROGRAM) {
+        fprintf(stderr, "Error: Corrupt binary AST\n");
+        ast_node_free(root);
+        return NULL;
+    }
+    return root;
+}
@@ -0,0 +1,64 @@
+#ifndef ASTBIN_H
+#define ASTBIN_H
+
+#include "ast.h"
+#include <stdint.h>
+
+// Binary AST format
+//
+// All integers are little-endian uint32. The file is a header followed by
+// three sections, each addressed by byte offset from the start of the file:
+//
+//   header   magic "\177ZST", version, checksum, node_count, root,
+//            nodes_offset, lists_offset, lists_size, strings_offset, strings_size
+//   nodes    node_count records of { type, line, column, slot[4] }
+//   lists    { count, node[count] } runs, addressed by offset into the section
+//   strings  NUL-terminated strings, addressed by offset into the section
+//
+// Each node's slots hold its fields in ast_node_layout order. Absent
+// children, lists and strings are ASTBIN_NONE. Nodes are stored in preorder,
+// so a child's index is always greater than its parent's. The checksum is a
+// 32-bit FNV-1a hash of everything after the header, so a damaged cache file
+// is rejected instead of compiled.
+
+#define ASTBIN_MAGIC "\177ZST"
+#define ASTBIN_VERSION 1
+#define ASTBIN_NONE 0xFFFFFFFFu
+#define ASTBIN_SLOTS AST_MAX_FIELDS
+
+typedef struct {
+    const unsigned char* data;
+    size_t size;
+    int mapped;             // data is an mmap of a file rather than caller-owned memory
+    uint32_t node_count;
+    uint32_t root;
+    const unsigned char* nodes;
+    const unsigned char* lists;
+    uint32_t lists_size;
+    const char* strings;
+    uint32_t strings_size;
+} ASTBinary;
+
+// Encoding
+unsigned char* astbin_encode(ASTNode* root, size_t* size);
+int astbin_write_file(const char* filename, ASTNode* root);
+
+// Zero-copy access to an encoded tree
+ASTBinary* astbin_open(const char* filename);
+ASTBinary* astbin_open_memory(const unsigned char* data, size_t size);
+void astbin_close(ASTBinary* bin);
+int astbin_is_file(const char* filename);
+
+// Slot kinds come from ast_node_layout
+ASTNodeType astbin_node_type(const ASTBinary* bin, uint32_t node);
+uint32_t astbin_node_line(const ASTBinary* bin, uint32_t node);
+uint32_t astbin_node_column(const ASTBinary* bin, uint32_t node);
+const char* astbin_node_string(const ASTBinary* bin, uint32_t node, int slot);
+uint32_t astbin_node_child(const ASTBinary* bin, uint32_t node, int slot);
+uint32_t astbin_list_count(const ASTBinary* bin, uint32_t node, int slot);
+uint32_t astbin_list_item(const ASTBinary* bin, uint32_t node, int slot, uint32_t index);
+
+// Rebuild a regular AST, e.g. to run codegen from a cached parse
+ASTNode* astbin_to_ast(const ASTBinary* bin);
+
+#endif
@@ -0,0 +1,119 @@
+// Times the three ways the parser can receive tokens on one generated
+// module: lexed on demand (parser_new), lexed into one array up front
+// (TokenBuffer), and lexed on a second thread (TokenStream).
+//
+// Built and run by `make bench`:
+//
+//   tokens_bench [groups] [runs]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../lexer.h"
+#include "../parser.h"
+
+typedef enum {
+    TOKENS_INTERLEAVED,
+    TOKENS_BATCHED,
+    TOKENS_THREADED
+} TokensMode;
+
+static const char* mode_names[] = { "interleaved", "batched", "threaded" };
+
+static double tokens_now_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000.0 + now.tv_nsec / 1000000.0;
+}
+
+// A module of independent declaration groups, like bench/common.ts
+static char* tokens_generate(int groups) {
+    size_t capacity = (size_t)groups * 512 + 1;
+    char* source = malloc(capacity);
+    size_t length = 0;
+    for (int i = 0; i < groups; i++) {
+        length += snprintf(source + length, capacity - length,
+            "struct User%d {\n  name: string;\n  age: number;\n}\n"
+            "trait Show%d {\n  show(): string;\n}\n"
+            "impl Show%d for User%d {\n  show() {\n    \"user %d\"\n  }\n}\n"
+            "let status%d = :ok\n"
+            "let message%d = match status%d {\n  :ok => \"Success %d\"\n  :error => \"Failed\"\n  _ => \"Unknown\"\n}\n"
+            "let greeting%d = \"  Hello %d  \" |> trim |> toUpperCase\n"
+            "let record%d = { id: %d, name: \"user %d\", tags: [\"a\", \"b\", :c], nested: { ok: true } }\n\n",
+            i, i, i, i, i, i, i, i, i, i, i, i, i, i);
+    }
+    return source;
+}
+
+// Lex and parse source once; returns the wall time, or -1 on a parse error
+static double tokens_parse(const char* source, TokensMode mode) {
+    double start = tokens_now_ms();
+
+    Lexer* lexer = lexer_new(source);
+    TokenBuffer* buffer = NULL;
+    TokenStream* stream = NULL;
+    Parser* parser;
+    switch (mode) {
+        case TOKENS_BATCHED:
+            buffer = token_buffer_lex(lexer);
+            parser = parser_new_buffered(buffer);
+            break;
+        case TOKENS_THREADED:
+            stream = token_stream_start(lexer);
+            parser = stream ? parser_new_streamed(stream) : parser_new(lexer);
+            break;
+        default:
+            parser = parser_new(lexer);
+            break;
+    }
+
+    ASTNode* ast = parser_parse(parser);
+    int failed = !ast || parser_has_errors(parser);
+    double elapsed = tokens_now_ms() - start;
+
+    ast_node_free(ast);
+    parser_free(parser);
+    token_stream_free(stream);
+    token_buffer_free(buffer);
+    lexer_free(lexer);
+    return failed ? -1 : elapsed;
+}
+
+int main(int argc, char** argv) {
+    int groups = argc > 1 ? atoi(argv[1]) : 20000;
+    int runs = argc > 2 ? atoi(argv[2]) : 5;
+    if (groups <= 0 || runs <= 0) {
+        fprintf(stderr, "Usage: %s [groups] [runs]\n", argv[0]);
+        return 1;
+    }
+
+    char* source = tokens_generate(groups);
+    printf("%d declaration groups, %.1f MB, best of %d\n\n", groups, strlen(source) / 1e6, runs);
+    printf("%-12s  %10s  %8s\n", "tokens", "parse", "speedup");
+    printf("------------  ----------  --------\n");
+
+    double interleaved = 0;
+    for (int mode = TOKENS_INTERLEAVED; mode <= TOKENS_THREADED; mode++) {
+        double fastest = -1;
+        for (int run = 0; run < runs; run++) {
+            double elapsed = tokens_parse(source, mode);
+            if (elapsed < 0) {
+                fprintf(stderr, "Error: %s parse failed\n", mode_names[mode]);
+                free(source);
+                return 1;
+            }
+            if (fastest < 0 || elapsed < fastest) {
+                fastest = elapsed;
+            }
+        }
+
+        if (mode == TOKENS_INTERLEAVED) {
+            interleaved = fastest;
+        }
+        printf("%-12s  %7.1f ms  %7.2fx\n", mode_names[mode], fastest, interleaved / fastest);
+    }
+
+    free(source);
+    return 0;
+}
@@ -1,6 +1,24 @@
 #include "zenoscript.h"
+#include "trace.h"
 #include <getopt.h>
 
+// Long-only options
+enum {
+    OPT_DCE = 256,
+    OPT_EMIT,
+    OPT_DECLARATIONS,
+    OPT_MINIFY,
+    OPT_STRUCT_FACTORIES,
+    OPT_STATIC_DISPATCH,
+    OPT_EMIT_AST,
+    OPT_DUMP_TOKENS,
+    OPT_DUMP_AST,
+    OPT_TRACE,
+    OPT_INSTRUMENT,
+    OPT_PROFILE_USE,
+    OPT_TRACE_PIPES
+};
+
 int main(int argc, char* argv[]) {
     ZenoscriptOptions options = {0};
     
@@ -10,13 +28,28 @@ int main(int argc, char* argv[]) {
         {"version", no_argument,       0, 'v'},
         {"verbose", no_argument,       0, 'V'},
         {"debug",   no_argument,       0, 'd'},
+        {"dce",     no_argument,       0, OPT_DCE},
+        {"emit",    required_argument, 0, OPT_EMIT},
+        {"declarations", no_argument,  0, OPT_DECLARATIONS},
+        {"minify",  no_argument,       0, OPT_MINIFY},
+        {"struct-factories", no_argument, 0, OPT_STRUCT_FACTORIES},
+        {"static-dispatch", no_argument,  0, OPT_STATIC_DISPATCH},
+        {"threads", required_argument,    0, 'j'},
+        {"emit-ast", required_argument,   0, OPT_EMIT_AST},
+        {"dump-tokens", required_argument, 0, OPT_DUMP_TOKENS},
+        {"dump-ast", required_argument,   0, OPT_DUMP_AST},
+        {"trace",   required_argument,    0, OPT_TRACE},
+        {"instrument", required_argument, 0, OPT_INSTRUMENT},
+        {"profile-use", required_argument, 0, OPT_PROFILE_USE},
+        {"trace-pipes", no_argument,      0, OPT_TRACE_PIPES},
         {0, 0, 0, 0}
     };
     
     int opt;
     int option_index = 0;
+    const char* trace_file = NULL;
     
-    while ((opt = getopt_long(argc, argv, "hvVd", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "hvVdj:", long_options, &option_index)) != -1) {
         switch (opt) {
             case 'h':
                 zenoscript_print_help();
@@ -30,6 +63,69 @@ int main(int argc, char* argv[]) {
             case 'd':
                 options.debug = 1;
                 break;
+            case OPT_DCE:
+                options.eliminate_dead_code = 1;
+                break;
+            case OPT_EMIT:
+                if (strcmp(optarg, "js") == 0) {
+                    options.emit_js = 1;
+                } else if (strcmp(optarg, "ts") == 0) {
+                    options.emit_js = 0;
+                } else {
+                    fprintf(stderr, "Error: Unknown emit target '%s' (expected 'ts' or 'js')\n", optarg);
+                    return 1;
+                }
+                break;
+            case OPT_DECLARATIONS:
+                options.emit_declarations = 1;
+                break;
+            case OPT_MINIFY:
+                options.minify = 1;
+                break;
+            case OPT_STRUCT_FACTORIES:
+                options.struct_factories = 1;
+                break;
+            case OPT_STATIC_DISPATCH:
+                options.static_dispatch = 1;
+                break;
+            case OPT_EMIT_AST:
+                if (strcmp(optarg, "bin") != 0) {
+                    fprintf(stderr, "Error: Unknown AST format '%s' (expected 'bin')\n", optarg);
+                    return 1;
+                }
+                options.emit_ast = 1;
+                break;
+            case OPT_DUMP_TOKENS:
+            case OPT_DUMP_AST:
+                if (strcmp(optarg, "json") != 0) {
+                    fprintf(stderr, "Error: Unknown dump format '%s' (expected 'json')\n", optarg);
+                    return 1;
+                }
+                if (opt == OPT_DUMP_TOKENS) {
+                    options.dump_tokens = 1;
+                } else {
+                    options.dump_ast = 1;
+                }
+                break;
+            case OPT_TRACE:
+                trace_file = optarg;
+                break;
+            case OPT_INSTRUMENT:
+                options.instrument = optarg;
+                break;
+            case OPT_PROFILE_USE:
+                options.profile_use = optarg;
+                break;
+            case OPT_TRACE_PIPES:
+                options.trace_pipes = 1;
+                break;
+            case 'j':
+                options.threads = atoi(optarg);
+                if (options.threads < 1) {
+                    fprintf(stderr, "Error: Invalid thread count '%s'\n", optarg);
+                    return 1;
+                }
+                break;
             default:
                 fprintf(stderr, "Try 'zeno --help' for more information.\n");
                 return 1;
@@ -47,7 +143,16 @@ int main(int argc, char* argv[]) {
     const char* output_file = (optind + 1 < argc) ? argv[optind + 1] : NULL;
     
     
+    if (trace_file && !trace_start(trace_file)) {
+        return 1;
+    }
+    
     // Normal transpilation
     int success = zenoscript_transpile_file(input_file, output_file, &options);
+    
+    if (trace_file && !trace_stop()) {
+        fprintf(stderr, "Error: Failed to write trace '%s'\n", trace_file);
+        success = 0;
+    }
     return success ? 0 : 1;
 }
\ No newline at end of file
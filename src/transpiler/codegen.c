@@ -1,4 +1,10 @@
 #include "codegen.h"
+#include "parallel.h"
+#include "intern.h"
+#include "json.h"
+#include "match.h"
+#include "trace.h"
+#include <ctype.h>
 
 CodeGenerator* codegen_new(void) {
     CodeGenerator* gen = malloc(sizeof(CodeGenerator));
@@ -6,7 +12,18 @@ CodeGenerator* codegen_new(void) {
     gen->buffer = malloc(gen->capacity);
     gen->length = 0;
     gen->indent_level = 0;
+    gen->depth = 0;
     gen->buffer[0] = '\0';
+    memset(&gen->options, 0, sizeof(CodegenOptions));
+    gen->dispatch = NULL;
+    gen->profile_arms = NULL;
+    gen->pipe_sites = NULL;
+    gen->awaits = 0;
+    gen->map_async = 0;
+    gen->exporting = 0;
+    gen->match_labels = 0;
+    gen->json_lengths = NULL;
+    gen->tail_function = NULL;
     return gen;
 }
 
@@ -34,14 +51,59 @@ void codegen_write(CodeGenerator* gen, const char* str) {
     gen->length += len;
 }
 
+static void codegen_write_raw(CodeGenerator* gen, const char* data, int length) {
+    codegen_ensure_capacity(gen, length + 1);
+    
+    memcpy(gen->buffer + gen->length, data, length);
+    gen->length += length;
+    gen->buffer[gen->length] = '\0';
+}
+
+static int codegen_is_identifier_char(char c) {
+    return isalnum((unsigned char)c) || c == '_' || c == '$';
+}
+
+// Write layout text; when minifying, whitespace is kept only where it separates two words
+void codegen_write_punct(CodeGenerator* gen, const char* str) {
+    if (!gen->options.minify) {
+        codegen_write(gen, str);
+        return;
+    }
+    
+    codegen_ensure_capacity(gen, strlen(str) + 1);
+    
+    for (const char* p = str; *p; p++) {
+        if (isspace((unsigned char)*p)) {
+            const char* next = p;
+            while (*next && isspace((unsigned char)*next)) next++;
+            
+            char prev = gen->length > 0 ? gen->buffer[gen->length - 1] : '\0';
+            if (codegen_is_identifier_char(prev) && codegen_is_identifier_char(*next)) {
+                gen->buffer[gen->length++] = ' ';
+            }
+            p = next - 1;
+            continue;
+        }
+        
+        gen->buffer[gen->length++] = *p;
+    }
+    gen->buffer[gen->length] = '\0';
+}
+
 void codegen_write_line(CodeGenerator* gen, const char* str) {
     codegen_write_indent(gen);
     codegen_write(gen, str);
-    codegen_write(gen, "\n");
+    if (!gen->options.minify) {
+        codegen_write(gen, "\n");
+    }
 }
 
 void codegen_write_indent(CodeGenerator* gen) {
-    for (int i = 0; i < gen->indent_level; i++) {
+    if (gen->options.minify) return;
+    
+    // Past CODEGEN_MAX_INDENT levels, output size stays linear in nesting depth
+    int levels = gen->indent_level < CODEGEN_MAX_INDENT ? gen->indent_level : CODEGEN_MAX_INDENT;
+    for (int i = 0; i < levels; i++) {
         codegen_write(gen, "  ");
     }
 }
@@ -56,10 +118,67 @@ void codegen_decrease_indent(CodeGenerator* gen) {
     }
 }
 
+const char* codegen_temp_name(CodeGenerator* gen, const char* name, const char* short_name) {
+    // '$' never appears in Zenoscript identifiers, so short names cannot collide
+    return gen->options.minify ? short_name : name;
+}
+
+// A line of runtime helper source. When minifying, whitespace outside string
+// literals goes as in codegen_write_punct, and every name in names, a NULL
+// terminated list of long and short pairs, is shortened unless it follows a
+// '.'. Names listed must not also be written as object keys.
+static void codegen_write_runtime_line(CodeGenerator* gen, const char* const* names, const char* line) {
+    if (!gen->options.minify) {
+        codegen_write_line(gen, line);
+        return;
+    }
+    
+    const char* p = line;
+    while (*p) {
+        if (*p == '"') {
+            const char* end = p + 1;
+            while (*end && *end != '"') end += end[0] == '\\' && end[1] ? 2 : 1;
+            if (*end) end++;
+            codegen_write_raw(gen, p, end - p);
+            p = end;
+        } else if (isspace((unsigned char)*p)) {
+            while (isspace((unsigned char)*p)) p++;
+            char prev = gen->length > 0 ? gen->buffer[gen->length - 1] : '\0';
+            if (codegen_is_identifier_char(prev) && codegen_is_identifier_char(*p)) {
+                codegen_write_raw(gen, " ", 1);
+            }
+        } else if (codegen_is_identifier_char(*p)) {
+            const char* end = p;
+            while (codegen_is_identifier_char(*end)) end++;
+            const char* short_name = NULL;
+            for (int i = 0; names && names[i] && !short_name && (p == line || p[-1] != '.'); i += 2) {
+                if ((int)strlen(names[i]) == end - p && strncmp(names[i], p, end - p) == 0) {
+                    short_name = names[i + 1];
+                }
+            }
+            if (short_name) {
+                codegen_write(gen, short_name);
+            } else {
+                codegen_write_raw(gen, p, end - p);
+            }
+            p = end;
+        } else {
+            codegen_write_raw(gen, p++, 1);
+        }
+    }
+}
+
 char* codegen_generate(ASTNode* ast) {
+    return codegen_generate_with_options(ast, NULL);
+}
+
+char* codegen_generate_with_options(ASTNode* ast, const CodegenOptions* options) {
     if (!ast) return NULL;
     
     CodeGenerator* gen = codegen_new();
+    if (options) {
+        gen->options = *options;
+    }
     codegen_generate_program(gen, ast);
     
     char* result = strdup(gen->buffer);
@@ -67,157 +186,1060 @@ char* codegen_generate(ASTNode* ast) {
     return result;
 }
 
-void codegen_generate_program(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_PROGRAM) return;
+typedef struct {
+    CodeGenerator* parent;
+    ASTList* declarations;
+    int batch_size;
+    CodeGenerator** outputs;
+} CodegenBatchJob;
+
+// Render one batch of consecutive declarations into a generator of its own
+static void codegen_generate_batch(void* context, int index) {
+    CodegenBatchJob* job = context;
+    int start = index * job->batch_size;
+    int end = start + job->batch_size;
+    if (end > job->declarations->count) {
+        end = job->declarations->count;
+    }
     
-    for (int i = 0; i < node->program.declarations->count; i++) {
-        ASTNode* decl = node->program.declarations->nodes[i];
-        
-        switch (decl->type) {
-            case AST_STRUCT_DECL:
-                codegen_generate_struct_decl(gen, decl);
-                break;
-            case AST_TRAIT_DECL:
-                codegen_generate_trait_decl(gen, decl);
-                break;
-            case AST_IMPL_BLOCK:
-                codegen_generate_impl_block(gen, decl);
-                break;
-            case AST_LET_BINDING:
-                codegen_generate_let_binding(gen, decl);
-                break;
-            default:
-                codegen_generate_expression(gen, decl);
-                break;
-        }
-        
-        codegen_write(gen, "\n");
+    TraceSpan span = trace_begin("codegen batch");
+    CodeGenerator* gen = codegen_new();
+    gen->options = job->parent->options;
+    gen->dispatch = job->parent->dispatch;
+    gen->profile_arms = job->parent->profile_arms;
+    gen->pipe_sites = job->parent->pipe_sites;
+    gen->awaits = job->parent->awaits;
+    gen->map_async = job->parent->map_async;
+    
+    for (int i = start; i < end; i++) {
+        codegen_generate_declaration(gen, job->declarations->nodes[i]);
     }
+    
+    job->outputs[index] = gen;
+    trace_end(span, NULL);
 }
 
-void codegen_generate_struct_decl(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_STRUCT_DECL) return;
+// Counters live in one typed array per module indexed by arm slot. Every
+// instrumented module registers its array, source file and arm positions with
+// one registry on globalThis, whose exit hook writes each profile file once
+// with the arms of all modules that name it.
+static void codegen_generate_profile_runtime(CodeGenerator* gen, const ProfileSites* arms) {
+    static const char* const names[] = {
+        "__zeno_writeFileSync", "$F", "__zeno_prof", "$P", "outputs", "o", "path", "p",
+        "modules", "m", "out", "t", "file", "f", "sites", "s", "counts", "c", NULL
+    };
+    const char* any = gen->options.emit_js ? "" : ": any";
+    char line[160];
     
-    codegen_write(gen, "type ");
-    codegen_write(gen, node->struct_decl.name);
+    codegen_write_runtime_line(gen, names, "import { writeFileSync as __zeno_writeFileSync } from \"node:fs\";");
+    snprintf(line, sizeof(line), "const __zeno_prof = ((globalThis%s).__zenoProfile ?\?= (() => {", gen->options.emit_js ? "" : " as any");
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    snprintf(line, sizeof(line), "const outputs%s = new Map();", any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_write_runtime_line(gen, names, "process.on(\"exit\", () => {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "for (const [path, modules] of outputs) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "let out = \"\";");
+    codegen_write_runtime_line(gen, names, "for (const { file, sites, counts } of modules) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "for (let i = 0; i < counts.length; i++) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "out += file + \":\" + sites[2 * i] + \":\" + sites[2 * i + 1] + \" \" + counts[i] + \"\\n\";");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_write_runtime_line(gen, names, "__zeno_writeFileSync(path, out);");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "});");
+    snprintf(line, sizeof(line), "const register = (path%s, file%s, sites%s) => {", any, any, any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "const counts = new Uint32Array(sites.length / 2);");
+    codegen_write_runtime_line(gen, names, "if (!outputs.has(path)) outputs.set(path, []);");
+    codegen_write_runtime_line(gen, names, "outputs.get(path).push({ file, sites, counts });");
+    codegen_write_runtime_line(gen, names, "return counts;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
+    codegen_write_runtime_line(gen, names, "return { register };");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "})()).register(");
+    codegen_increase_indent(gen);
     
-    if (node->struct_decl.generic_params && node->struct_decl.generic_params->count > 0) {
-        codegen_generate_generic_params(gen, node->struct_decl.generic_params);
+    codegen_write_indent(gen);
+    codegen_write(gen, "\"");
+    codegen_write_escaped(gen, gen->options.instrument);
+    codegen_write(gen, "\",");
+    codegen_write_punct(gen, "\n");
+    codegen_write_indent(gen);
+    codegen_write(gen, "\"");
+    codegen_write_escaped(gen, gen->options.source_file ? gen->options.source_file : "<input>");
+    codegen_write(gen, "\",");
+    codegen_write_punct(gen, "\n");
+    codegen_write_indent(gen);
+    codegen_write_punct(gen, "new Uint32Array([");
+    for (int i = 0; i < arms->count; i++) {
+        snprintf(line, sizeof(line), "%s%d,%d", i > 0 ? "," : "", arms->nodes[i]->line, arms->nodes[i]->column);
+        codegen_write(gen, line);
     }
+    codegen_write(gen, "])");
+    codegen_write_punct(gen, "\n");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, ");");
+}
+
+// One ring of sampled stage timings is shared by every traced module through
+// globalThis; src/pipes.ts reads it back. Each module registers the file and
+// line of its stages and addresses them from the base index it gets back.
+static void codegen_generate_pipe_runtime(CodeGenerator* gen, const ProfileSites* pipes) {
+    // src/pipes.ts reads the fields of state, which keep their names
+    static const char* const names[] = {
+        "__zeno_pipes", "$T", "state", "s", "record", "r", "reload", "l", "site", "i",
+        "start", "b", "slot", "o", "file", "f", "line", "e", "base", "a", "value", "v",
+        "name", "m", "result", "u", NULL
+    };
+    const char* any = gen->options.emit_js ? "" : ": any";
+    char line[160];
     
-    codegen_write(gen, " = ");
+    snprintf(line, sizeof(line), "const __zeno_pipes = ((globalThis%s).__zenoPipes ?\?= (() => {", gen->options.emit_js ? "" : " as any");
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    snprintf(line, sizeof(line), "const state%s = { capacity: %d, rate: %d, countdown: %d, next: 0, files: [], lines: [] };", any, CODEGEN_PIPE_TRACE_CAPACITY, CODEGEN_PIPE_SAMPLE_RATE, CODEGEN_PIPE_SAMPLE_RATE);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_write_runtime_line(gen, names, "state.sites = new Uint32Array(state.capacity);");
+    codegen_write_runtime_line(gen, names, "state.times = new Float64Array(state.capacity);");
+    snprintf(line, sizeof(line), "const record = (site%s, start%s) => {", any, any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "const slot = state.next++ & (state.capacity - 1);");
+    codegen_write_runtime_line(gen, names, "state.sites[slot] = site;");
+    codegen_write_runtime_line(gen, names, "state.times[slot] = performance.now() - start;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
+    // Gaps are uniform over 1 to 2 * rate - 1, so a loop calling stages in a
+    // fixed cycle still samples each of them
+    codegen_write_runtime_line(gen, names, "const reload = () => state.rate > 1 ? 1 + Math.floor(Math.random() * (2 * state.rate - 1)) : 1;");
+    snprintf(line, sizeof(line), "state.register = (file%s, lines%s) => {", any, any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "const base = state.lines.length;");
+    codegen_write_runtime_line(gen, names, "for (const line of lines) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "state.files.push(file);");
+    codegen_write_runtime_line(gen, names, "state.lines.push(line);");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_write_runtime_line(gen, names, "return base;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
     
-    if (node->struct_decl.fields->count == 0) {
-        codegen_write(gen, "{}");
-    } else {
-        codegen_write(gen, "{\n");
-        codegen_increase_indent(gen);
-        
-        for (int i = 0; i < node->struct_decl.fields->count; i++) {
-            codegen_generate_field_decl(gen, node->struct_decl.fields->nodes[i]);
+    // Unsampled calls cost one decrement and compare
+    snprintf(line, sizeof(line), "state.call = (site%s, f%s, value%s) => {", any, any, any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "if (--state.countdown > 0) return f(value);");
+    codegen_write_runtime_line(gen, names, "state.countdown = reload();");
+    codegen_write_runtime_line(gen, names, "const start = performance.now();");
+    codegen_write_runtime_line(gen, names, "const result = f(value);");
+    codegen_write_runtime_line(gen, names, "record(site, start);");
+    codegen_write_runtime_line(gen, names, "return result;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
+    snprintf(line, sizeof(line), "state.method = (site%s, value%s, name%s) => {", any, any, any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "if (--state.countdown > 0) return value[name]();");
+    codegen_write_runtime_line(gen, names, "state.countdown = reload();");
+    codegen_write_runtime_line(gen, names, "const start = performance.now();");
+    codegen_write_runtime_line(gen, names, "const result = value[name]();");
+    codegen_write_runtime_line(gen, names, "record(site, start);");
+    codegen_write_runtime_line(gen, names, "return result;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
+    codegen_write_runtime_line(gen, names, "return state;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "})());");
+    
+    codegen_write_indent(gen);
+    codegen_write(gen, "const ");
+    codegen_write(gen, codegen_temp_name(gen, "__zeno_pipe_base", "$B"));
+    codegen_write_punct(gen, " = ");
+    codegen_write(gen, codegen_temp_name(gen, "__zeno_pipes", "$T"));
+    codegen_write(gen, ".register(\"");
+    codegen_write_escaped(gen, gen->options.source_file ? gen->options.source_file : "<input>");
+    codegen_write_punct(gen, "\", [");
+    for (int i = 0; i < pipes->count; i++) {
+        // A stage is timed where its function is written
+        ASTNode* right = pipes->nodes[i]->pipe_expr.right;
+        snprintf(line, sizeof(line), "%s%d", i > 0 ? "," : "", right->line ? right->line : pipes->nodes[i]->line);
+        codegen_write(gen, line);
+    }
+    codegen_write(gen, "]);");
+    codegen_write_punct(gen, "\n");
+}
+
+// Up to `limit` workers take the next unstarted item until none are left,
+// writing each result at its item's index; a failure stops further calls
+static void codegen_generate_map_async_runtime(CodeGenerator* gen) {
+    static const char* const names[] = {
+        "__zeno_map_async", "$A", "items", "s", "limit", "l", "values", "v", "results", "r",
+        "next", "x", "worker", "w", "workers", "k", "error", "e", NULL
+    };
+    const char* any = gen->options.emit_js ? "" : ": any";
+    char line[160];
+    
+    snprintf(line, sizeof(line), "const __zeno_map_async = async (items%s, f%s, limit%s = Infinity) => {", any, any, any);
+    codegen_write_runtime_line(gen, names, line);
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "const values = Array.from(items);");
+    codegen_write_runtime_line(gen, names, "const results = new Array(values.length);");
+    codegen_write_runtime_line(gen, names, "let next = 0;");
+    codegen_write_runtime_line(gen, names, "const worker = async () => {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "while (next < values.length) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "const i = next++;");
+    codegen_write_runtime_line(gen, names, "try {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "results[i] = await f(values[i]);");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "} catch (error) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "next = values.length;");
+    codegen_write_runtime_line(gen, names, "throw error;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
+    codegen_write_runtime_line(gen, names, "const workers = [];");
+    codegen_write_runtime_line(gen, names, "for (let n = Math.min(Math.max(1, limit), values.length); n > 0; n--) {");
+    codegen_increase_indent(gen);
+    codegen_write_runtime_line(gen, names, "workers.push(worker());");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "}");
+    codegen_write_runtime_line(gen, names, "await Promise.all(workers);");
+    codegen_write_runtime_line(gen, names, "return results;");
+    codegen_decrease_indent(gen);
+    codegen_write_runtime_line(gen, names, "};");
+}
+
+// `mapAsync(f)` or `mapAsync(f, limit)` as a pipe stage, possibly awaited
+static int codegen_is_map_async_call(ASTNode* right) {
+    if (right && right->type == AST_AWAIT_EXPR) {
+        right = right->await_expr.argument;
+    }
+    return right && right->type == AST_CALL_EXPR &&
+           right->call_expr.function->type == AST_IDENTIFIER &&
+           right->call_expr.function->identifier.name == intern_map_async &&
+           right->call_expr.args && right->call_expr.args->count >= 1 && right->call_expr.args->count <= 2;
+}
+
+// Such a stage, unless the program has its own mapAsync
+static int codegen_is_map_async(CodeGenerator* gen, ASTNode* right) {
+    return gen->map_async && codegen_is_map_async_call(right);
+}
+
+static int codegen_pattern_binds(ASTNode* pattern, const char* name) {
+    if (!pattern) return 0;
+
+    switch (pattern->type) {
+        case AST_IDENTIFIER:
+            return pattern->identifier.name == name;
+        case AST_ARRAY_PATTERN:
+            if (pattern->array_pattern.rest == name) return 1;
+            for (int i = 0; i < pattern->array_pattern.elements->count; i++) {
+                if (codegen_pattern_binds(pattern->array_pattern.elements->nodes[i], name)) return 1;
+            }
+            return 0;
+        case AST_OBJECT_PATTERN:
+            for (int i = 0; i < pattern->object_pattern.fields->count; i++) {
+                if (codegen_pattern_binds(pattern->object_pattern.fields->nodes[i]->field_pattern.pattern, name)) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+typedef struct {
+    int awaits;
+    int map_async;
+    int binds_map_async;    // A let, parameter, import or pattern named mapAsync
+} CodegenAsyncUse;
+
+static void codegen_find_async_use(ASTNode* node, void* context) {
+    CodegenAsyncUse* use = context;
+    switch (node->type) {
+        case AST_AWAIT_EXPR:
+            use->awaits++;
+            break;
+        case AST_PIPE_EXPR:
+            use->map_async += codegen_is_map_async_call(node->pipe_expr.right);
+            break;
+        case AST_LET_BINDING:
+            use->binds_map_async |= node->let_binding.name == intern_map_async;
+            break;
+        case AST_PARAM_DECL:
+            use->binds_map_async |= node->param_decl.name == intern_map_async;
+            break;
+        case AST_IMPORT_SPECIFIER:
+            use->binds_map_async |= node->import_specifier.local == intern_map_async;
+            break;
+        case AST_MATCH_ARM:
+            use->binds_map_async |= codegen_pattern_binds(node->match_arm.pattern, intern_map_async);
+            break;
+        default:
+            break;
+    }
+}
+
+static void codegen_generate_declarations(CodeGenerator* gen, ASTList* declarations) {
+    if (gen->options.threads <= 1 || declarations->count < PARALLEL_CODEGEN_MIN_DECLS) {
+        for (int i = 0; i < declarations->count; i++) {
+            codegen_generate_declaration(gen, declarations->nodes[i]);
         }
-        
-        codegen_decrease_indent(gen);
-        codegen_write(gen, "}");
+        return;
     }
     
-    codegen_write(gen, ";");
+    // Declarations only read the AST, so batches render independently and are joined in order
+    int batch_count = gen->options.threads * 4;
+    CodegenBatchJob job;
+    job.parent = gen;
+    job.declarations = declarations;
+    job.batch_size = (declarations->count + batch_count - 1) / batch_count;
+    batch_count = (declarations->count + job.batch_size - 1) / job.batch_size;
+    job.outputs = calloc(batch_count, sizeof(CodeGenerator*));
+    
+    parallel_for(batch_count, gen->options.threads, codegen_generate_batch, &job);
+    
+    int total = 0;
+    for (int i = 0; i < batch_count; i++) {
+        total += job.outputs[i]->length;
+    }
+    codegen_ensure_capacity(gen, total + 1);
+    
+    for (int i = 0; i < batch_count; i++) {
+        memcpy(gen->buffer + gen->length, job.outputs[i]->buffer, job.outputs[i]->length);
+        gen->length += job.outputs[i]->length;
+        codegen_free(job.outputs[i]);
+    }
+    gen->buffer[gen->length] = '\0';
+    
+    free(job.outputs);
 }
 
-void codegen_generate_trait_decl(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_TRAIT_DECL) return;
+static CodegenDispatchIndex* codegen_dispatch_index_build(ASTNode* program);
+static void codegen_dispatch_index_free(CodegenDispatchIndex* index);
+
+void codegen_generate_program(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_PROGRAM) return;
     
-    codegen_write(gen, "interface ");
-    codegen_write(gen, node->trait_decl.name);
+    CodegenDispatchIndex* dispatch = NULL;
+    if (gen->options.static_dispatch) {
+        dispatch = codegen_dispatch_index_build(node);
+        gen->dispatch = dispatch;
+    }
     
-    if (node->trait_decl.generic_params && node->trait_decl.generic_params->count > 0) {
-        codegen_generate_generic_params(gen, node->trait_decl.generic_params);
+    ProfileSites* arms = NULL;
+    if (gen->options.instrument) {
+        arms = profile_sites_collect(node, AST_MATCH_ARM);
+        if (arms->count > 0) {
+            codegen_generate_profile_runtime(gen, arms);
+        }
+        gen->profile_arms = arms;
     }
     
-    codegen_write(gen, " {\n");
-    codegen_increase_indent(gen);
+    ProfileSites* pipes = NULL;
+    if (gen->options.trace_pipes) {
+        pipes = profile_sites_collect(node, AST_PIPE_EXPR);
+        if (pipes->count > 0) {
+            codegen_generate_pipe_runtime(gen, pipes);
+        }
+        gen->pipe_sites = pipes;
+    }
     
-    for (int i = 0; i < node->trait_decl.methods->count; i++) {
-        ASTNode* method = node->trait_decl.methods->nodes[i];
-        codegen_write_indent(gen);
-        codegen_write(gen, method->method_decl.name);
-        codegen_write(gen, "(");
+    CodegenAsyncUse use = { 0, 0, 0 };
+    ast_walk(node, codegen_find_async_use, &use);
+    gen->map_async = use.map_async > 0 && !use.binds_map_async;
+    if (gen->map_async) {
+        codegen_generate_map_async_runtime(gen);
+    }
+    gen->awaits = use.awaits;
+    
+    codegen_generate_declarations(gen, node->program.declarations);
+    
+    gen->profile_arms = NULL;
+    gen->pipe_sites = NULL;
+    gen->dispatch = NULL;
+    profile_sites_free(arms);
+    profile_sites_free(pipes);
+    codegen_dispatch_index_free(dispatch);
+}
+
+// Each top-level statement an exported declaration generates is exported
+static void codegen_write_export(CodeGenerator* gen) {
+    if (gen->exporting) {
+        codegen_write(gen, "export ");
+    }
+}
+
+// The source is written as given; .zs modules are resolved by the bundler plugin
+static void codegen_generate_import_decl(CodeGenerator* gen, ASTNode* node) {
+    ASTList* specifiers = node->import_decl.specifiers;
+    
+    codegen_write(gen, "import ");
+    int named = 0;
+    for (int i = 0; i < specifiers->count; i++) {
+        const char* imported = specifiers->nodes[i]->import_specifier.imported;
+        const char* local = specifiers->nodes[i]->import_specifier.local;
         
-        if (method->method_decl.params) {
-            codegen_generate_parameter_list(gen, method->method_decl.params);
+        if (strcmp(imported, "default") == 0) {
+            // The parser puts a default import first
+            codegen_write(gen, local);
+            continue;
         }
         
-        codegen_write(gen, ")");
-        
-        if (method->method_decl.return_type) {
-            codegen_write(gen, ": ");
-            codegen_generate_type_annotation(gen, method->method_decl.return_type);
+        if (i > 0) codegen_write_punct(gen, ", ");
+        if (strcmp(imported, "*") == 0) {
+            codegen_write(gen, "* as ");
+            codegen_write(gen, local);
+            continue;
         }
         
-        codegen_write(gen, ";\n");
+        if (named++ == 0) codegen_write_punct(gen, "{ ");
+        codegen_write(gen, imported);
+        if (local != imported) {
+            codegen_write(gen, " as ");
+            codegen_write(gen, local);
+        }
     }
+    if (named > 0) codegen_write_punct(gen, " }");
+    if (specifiers->count > 0) codegen_write_punct(gen, " from ");
     
-    codegen_decrease_indent(gen);
-    codegen_write(gen, "}");
+    codegen_write(gen, "\"");
+    codegen_write_escaped(gen, node->import_decl.source);
+    codegen_write(gen, "\";");
 }
 
-void codegen_generate_impl_block(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_IMPL_BLOCK) return;
+void codegen_generate_declaration(CodeGenerator* gen, ASTNode* decl) {
+    int start = gen->length;
     
-    if (node->impl_block.trait_name) {
-        // Trait implementation - generate functional object
-        codegen_write(gen, "const ");
-        codegen_write(gen, node->impl_block.type_name);
-        codegen_write(gen, node->impl_block.trait_name);
-        codegen_write(gen, " = {\n");
-        codegen_increase_indent(gen);
-        
-        for (int i = 0; i < node->impl_block.methods->count; i++) {
-            ASTNode* method = node->impl_block.methods->nodes[i];
-            codegen_write_indent(gen);
-            codegen_write(gen, method->method_decl.name);
-            codegen_write(gen, ": (obj: ");
-            codegen_write(gen, node->impl_block.type_name);
-            
-            if (method->method_decl.params && method->method_decl.params->count > 0) {
-                codegen_write(gen, ", ");
-                codegen_generate_parameter_list(gen, method->method_decl.params);
-            }
-            
-            codegen_write(gen, ")");
-            
-            if (method->method_decl.return_type) {
-                codegen_write(gen, ": ");
-                codegen_generate_type_annotation(gen, method->method_decl.return_type);
+    gen->exporting = decl->type == AST_EXPORT_DECL;
+    decl = ast_unwrap_export(decl);
+    
+    switch (decl->type) {
+        case AST_STRUCT_DECL:
+            codegen_generate_struct_decl(gen, decl);
+            break;
+        case AST_TRAIT_DECL:
+            codegen_generate_trait_decl(gen, decl);
+            break;
+        case AST_IMPL_BLOCK:
+            codegen_generate_impl_block(gen, decl);
+            break;
+        case AST_LET_BINDING:
+            codegen_generate_let_binding(gen, decl);
+            break;
+        case AST_IMPORT_DECL:
+            codegen_generate_import_decl(gen, decl);
+            break;
+        case AST_EXPORT_DEFAULT:
+            codegen_write(gen, "export default ");
+            codegen_generate_expression(gen, decl->export_default.value);
+            codegen_write(gen, ";");
+            break;
+        default: {
+            int expression = gen->length;
+            codegen_generate_expression(gen, decl);
+
+            // A statement starting with { parses as a block: ({ a: 1 }). Unminified
+            // statements end without semicolons, so the parenthesis must not
+            // continue the line before it as a call: ;({ a: 1 })
+            if (decl->type != AST_BLOCK && gen->length > expression && gen->buffer[expression] == '{') {
+                const char* open = gen->options.minify ? "(" : ";(";
+                int shift = strlen(open);
+                codegen_ensure_capacity(gen, shift + 2);
+                memmove(gen->buffer + expression + shift, gen->buffer + expression, gen->length - expression + 1);
+                memcpy(gen->buffer + expression, open, shift);
+                gen->length += shift;
+                codegen_write(gen, ")");
             }
-            
-            codegen_write(gen, " => ");
-            
-            if (method->method_decl.body) {
-                codegen_generate_block(gen, method->method_decl.body);
+            break;
+        }
+    }
+    gen->exporting = 0;
+    
+    // Type-only declarations produce nothing when emitting JavaScript
+    if (gen->length > start) {
+        if (!gen->options.minify) {
+            codegen_write(gen, "\n");
+        } else if (gen->buffer[gen->length - 1] != ';' && gen->buffer[gen->length - 1] != '}') {
+            // Without newlines, automatic semicolon insertion no longer separates statements
+            codegen_write(gen, ";");
+        }
+    }
+}
+
+static void codegen_generate_struct_type(CodeGenerator* gen, ASTNode* node);
+static void codegen_write_dispatch_name(CodeGenerator* gen, ASTNode* impl, ASTNode* method);
+static void codegen_generate_impl_method_signature(CodeGenerator* gen, ASTNode* impl, ASTNode* method);
+static void codegen_generate_struct_factory_signature(CodeGenerator* gen, ASTNode* node, const char* arrow);
+
+// Whether node awaits outside the functions nested in it, so that the
+// function or match wrapper it is generated into must be async
+static int codegen_contains_await(CodeGenerator* gen, ASTNode* node) {
+    if (!gen->awaits || !node) return 0;
+    
+    int capacity = 64;
+    int count = 0;
+    ASTNode** stack = malloc(capacity * sizeof(ASTNode*));
+    stack[count++] = node;
+    
+    int found = 0;
+    while (count > 0) {
+        ASTNode* current = stack[--count];
+        if (current->type == AST_AWAIT_EXPR) {
+            found = 1;
+            break;
+        }
+        if (current->type == AST_FUNCTION_DECL && current != node) continue;
+        
+        ASTField fields[AST_MAX_FIELDS];
+        int field_count = ast_node_fields(current, fields);
+        for (int i = 0; i < field_count; i++) {
+            ASTNode** children;
+            int child_count;
+            if (fields[i].node) {
+                children = fields[i].node;
+                child_count = 1;
+            } else if (fields[i].list && *fields[i].list) {
+                children = (*fields[i].list)->nodes;
+                child_count = (*fields[i].list)->count;
             } else {
-                codegen_write(gen, "{}");
+                continue;
             }
             
-            if (i < node->impl_block.methods->count - 1) {
-                codegen_write(gen, ",");
+            for (int j = 0; j < child_count; j++) {
+                if (!children[j]) continue;
+                if (count >= capacity) {
+                    capacity *= 2;
+                    stack = realloc(stack, capacity * sizeof(ASTNode*));
+                }
+                stack[count++] = children[j];
             }
-            codegen_write(gen, "\n");
         }
-        
-        codegen_decrease_indent(gen);
-        codegen_write(gen, "};");
+    }
+    
+    free(stack);
+    return found;
+}
+
+// An async function declared to return T returns Promise<T>
+static void codegen_generate_return_type(CodeGenerator* gen, ASTNode* type, int async) {
+    if (async) codegen_write(gen, "Promise<");
+    if (type) {
+        codegen_generate_type_annotation(gen, type);
     } else {
-        // Type implementation - generate class
-        codegen_write(gen, "class ");
-        codegen_write(gen, node->impl_block.type_name);
-        codegen_write(gen, "Impl");
-        
-        if (node->impl_block.generic_params && node->impl_block.generic_params->count > 0) {
+        codegen_write(gen, "any");
+    }
+    if (async) codegen_write(gen, ">");
+}
+
+// Signature of a method as it appears in a declaration file
+static void codegen_generate_method_signature(CodeGenerator* gen, ASTNode* method, const char* self_type) {
+    codegen_write_indent(gen);
+    codegen_write(gen, method->method_decl.name);
+    codegen_write(gen, "(");
+    
+    if (self_type) {
+        codegen_write(gen, "obj: ");
+        codegen_write(gen, self_type);
+        if (method->method_decl.params && method->method_decl.params->count > 0) {
+            codegen_write(gen, ", ");
+        }
+    }
+    codegen_generate_parameter_list(gen, method->method_decl.params);
+    
+    codegen_write(gen, "): ");
+    codegen_generate_return_type(gen, method->method_decl.return_type, codegen_contains_await(gen, method->method_decl.body));
+    codegen_write(gen, ";\n");
+}
+
+static void codegen_generate_ambient_let(CodeGenerator* gen, ASTNode* node) {
+    // A deferred lazy let is its accessor
+    ASTNode* value = node->let_binding.value;
+    int deferred = value && value->type == AST_LAZY_EXPR && value->lazy_expr.deferred;
+    if (value && value->type == AST_LAZY_EXPR) {
+        value = value->lazy_expr.value;
+    }
+    
+    codegen_write_export(gen);
+    codegen_write(gen, deferred ? "declare let " : "declare const ");
+    codegen_write(gen, node->let_binding.name);
+    codegen_write(gen, deferred ? ": () => " : ": ");
+    
+    if (node->let_binding.type_annotation) {
+        codegen_generate_type_annotation(gen, node->let_binding.type_annotation);
+    } else if (value && value->type == AST_NUMBER_LITERAL) {
+        codegen_write(gen, "number");
+    } else if (value && value->type == AST_STRING_LITERAL) {
+        codegen_write(gen, "string");
+    } else if (value && value->type == AST_ATOM_LITERAL) {
+        codegen_write(gen, "symbol");
+    } else if (value && value->type == AST_FUNCTION_DECL) {
+        // (a: A, b: any) => R, with any for whatever is unannotated
+        ASTList* params = value->function_decl.params;
+        codegen_write(gen, "(");
+        for (int i = 0; i < params->count; i++) {
+            if (i > 0) codegen_write(gen, ", ");
+            codegen_write(gen, params->nodes[i]->param_decl.name);
+            codegen_write(gen, ": ");
+            if (params->nodes[i]->param_decl.type_annotation) {
+                codegen_generate_type_annotation(gen, params->nodes[i]->param_decl.type_annotation);
+            } else {
+                codegen_write(gen, "any");
+            }
+        }
+        codegen_write(gen, ") => ");
+        codegen_generate_return_type(gen, value->function_decl.return_type, codegen_contains_await(gen, value->function_decl.body));
+    } else {
+        codegen_write(gen, "any");
+    }
+    codegen_write(gen, ";");
+}
+
+static void codegen_generate_ambient_impl(CodeGenerator* gen, ASTNode* node) {
+    ASTList* methods = node->impl_block.methods;
+    
+    if (node->impl_block.trait_name && gen->options.static_dispatch) {
+        for (int i = 0; i < methods->count; i++) {
+            ASTNode* method = methods->nodes[i];
+            codegen_write(gen, "declare function ");
+            codegen_write_dispatch_name(gen, node, method);
+            codegen_generate_impl_method_signature(gen, node, method);
+            if (!method->method_decl.return_type) {
+                codegen_write(gen, ": ");
+                codegen_generate_return_type(gen, NULL, codegen_contains_await(gen, method->method_decl.body));
+            }
+            codegen_write(gen, ";\n");
+        }
+    }
+    
+    codegen_write_export(gen);
+    if (node->impl_block.trait_name) {
+        codegen_write(gen, "declare const ");
+        codegen_write(gen, node->impl_block.type_name);
+        codegen_write(gen, node->impl_block.trait_name);
+        codegen_write(gen, ": {\n");
+    } else {
+        codegen_write(gen, "declare class ");
+        codegen_write(gen, node->impl_block.type_name);
+        codegen_write(gen, "Impl");
+        codegen_generate_generic_params(gen, node->impl_block.generic_params);
+        codegen_write(gen, " {\n");
+    }
+    
+    codegen_increase_indent(gen);
+    for (int i = 0; i < methods->count; i++) {
+        codegen_generate_method_signature(gen, methods->nodes[i],
+            node->impl_block.trait_name ? node->impl_block.type_name : NULL);
+    }
+    codegen_decrease_indent(gen);
+    
+    codegen_write(gen, node->impl_block.trait_name ? "};" : "}");
+}
+
+char* codegen_generate_declaration_file(ASTNode* ast, const CodegenOptions* options) {
+    if (!ast || ast->type != AST_PROGRAM) return NULL;
+    
+    CodeGenerator* gen = codegen_new();
+    if (options) {
+        gen->options.struct_factories = options->struct_factories;
+        gen->options.static_dispatch = options->static_dispatch;
+    }
+    
+    CodegenAsyncUse use = { 0, 0, 0 };
+    ast_walk(ast, codegen_find_async_use, &use);
+    gen->awaits = use.awaits;
+    
+    for (int i = 0; i < ast->program.declarations->count; i++) {
+        ASTNode* decl = ast->program.declarations->nodes[i];
+        gen->exporting = decl->type == AST_EXPORT_DECL;
+        decl = ast_unwrap_export(decl);
+        
+        switch (decl->type) {
+            case AST_STRUCT_DECL:
+                codegen_generate_struct_type(gen, decl);
+                if (gen->options.struct_factories) {
+                    codegen_write(gen, "\n");
+                    codegen_write_export(gen);
+                    codegen_write(gen, "declare const ");
+                    codegen_write(gen, decl->struct_decl.name);
+                    codegen_write(gen, ": ");
+                    codegen_generate_struct_factory_signature(gen, decl, " => ");
+                    codegen_write(gen, ";");
+                }
+                break;
+            case AST_TRAIT_DECL:
+                codegen_generate_trait_decl(gen, decl);
+                break;
+            case AST_IMPL_BLOCK:
+                codegen_generate_ambient_impl(gen, decl);
+                break;
+            case AST_LET_BINDING:
+                codegen_generate_ambient_let(gen, decl);
+                break;
+            case AST_IMPORT_DECL:
+                // Exported signatures may name imported types
+                codegen_generate_import_decl(gen, decl);
+                break;
+            case AST_EXPORT_DEFAULT:
+                if (decl->export_default.value->type == AST_IDENTIFIER) {
+                    codegen_write(gen, "export default ");
+                    codegen_write(gen, decl->export_default.value->identifier.name);
+                } else {
+                    codegen_write(gen, "declare const __default: any;\nexport default __default");
+                }
+                codegen_write(gen, ";");
+                break;
+            default:
+                // Statements have no declaration surface
+                continue;
+        }
+        
+        codegen_write(gen, "\n");
+    }
+    
+    char* result = strdup(gen->buffer);
+    codegen_free(gen);
+    return result;
+}
+
+// Parameters and return type of a struct factory: <T>(a: A, b: B): Name<T>
+static void codegen_generate_struct_factory_signature(CodeGenerator* gen, ASTNode* node, const char* arrow) {
+    ASTList* fields = node->struct_decl.fields;
+    
+    if (!gen->options.emit_js) {
+        codegen_generate_generic_params(gen, node->struct_decl.generic_params);
+    }
+    
+    codegen_write(gen, "(");
+    for (int i = 0; i < fields->count; i++) {
+        ASTNode* field = fields->nodes[i];
+        if (i > 0) codegen_write_punct(gen, ", ");
+        codegen_write(gen, field->field_decl.name);
+        
+        if (!gen->options.emit_js && field->field_decl.type_annotation) {
+            codegen_write_punct(gen, ": ");
+            codegen_generate_type_annotation(gen, field->field_decl.type_annotation);
+        }
+    }
+    codegen_write(gen, ")");
+    
+    if (!gen->options.emit_js) {
+        codegen_write_punct(gen, arrow);
+        codegen_write(gen, node->struct_decl.name);
+        codegen_generate_generic_params(gen, node->struct_decl.generic_params);
+    }
+}
+
+// A single allocation site that always initializes fields in declaration order,
+// so every instance of the struct shares one hidden class
+static void codegen_generate_struct_factory(CodeGenerator* gen, ASTNode* node) {
+    ASTList* fields = node->struct_decl.fields;
+    
+    codegen_write_export(gen);
+    codegen_write(gen, "const ");
+    codegen_write(gen, node->struct_decl.name);
+    codegen_write_punct(gen, " = ");
+    codegen_generate_struct_factory_signature(gen, node, ": ");
+    codegen_write_punct(gen, " => (");
+    
+    if (fields->count == 0) {
+        codegen_write(gen, "{}");
+    } else {
+        codegen_write_punct(gen, "{ ");
+        for (int i = 0; i < fields->count; i++) {
+            const char* field_name = fields->nodes[i]->field_decl.name;
+            if (i > 0) codegen_write_punct(gen, ", ");
+            codegen_write(gen, field_name);
+            codegen_write_punct(gen, ": ");
+            codegen_write(gen, field_name);
+        }
+        codegen_write_punct(gen, " }");
+    }
+    
+    codegen_write(gen, ");");
+}
+
+void codegen_generate_struct_decl(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_STRUCT_DECL) return;
+    
+    if (!gen->options.emit_js) {
+        codegen_generate_struct_type(gen, node);
+    }
+    
+    if (gen->options.struct_factories) {
+        if (!gen->options.emit_js) {
+            codegen_write_punct(gen, "\n");
+        }
+        codegen_generate_struct_factory(gen, node);
+    }
+}
+
+static void codegen_generate_struct_type(CodeGenerator* gen, ASTNode* node) {
+    codegen_write_export(gen);
+    codegen_write(gen, "type ");
+    codegen_write(gen, node->struct_decl.name);
+    
+    if (node->struct_decl.generic_params && node->struct_decl.generic_params->count > 0) {
+        codegen_generate_generic_params(gen, node->struct_decl.generic_params);
+    }
+    
+    codegen_write_punct(gen, " = ");
+    
+    if (node->struct_decl.fields->count == 0) {
+        codegen_write(gen, "{}");
+    } else {
+        codegen_write_punct(gen, "{\n");
+        codegen_increase_indent(gen);
+        
+        for (int i = 0; i < node->struct_decl.fields->count; i++) {
+            codegen_generate_field_decl(gen, node->struct_decl.fields->nodes[i]);
+        }
+        
+        codegen_decrease_indent(gen);
+        codegen_write(gen, "}");
+    }
+    
+    codegen_write(gen, ";");
+}
+
+void codegen_generate_trait_decl(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_TRAIT_DECL) return;
+    if (gen->options.emit_js) return;
+    
+    codegen_write_export(gen);
+    codegen_write(gen, "interface ");
+    codegen_write(gen, node->trait_decl.name);
+    
+    if (node->trait_decl.generic_params && node->trait_decl.generic_params->count > 0) {
+        codegen_generate_generic_params(gen, node->trait_decl.generic_params);
+    }
+    
+    codegen_write_punct(gen, " {\n");
+    codegen_increase_indent(gen);
+    
+    for (int i = 0; i < node->trait_decl.methods->count; i++) {
+        ASTNode* method = node->trait_decl.methods->nodes[i];
+        codegen_write_indent(gen);
+        codegen_write(gen, method->method_decl.name);
+        codegen_write(gen, "(");
+        
+        if (method->method_decl.params) {
+            codegen_generate_parameter_list(gen, method->method_decl.params);
+        }
+        
+        codegen_write(gen, ")");
+        
+        if (method->method_decl.return_type) {
+            codegen_write_punct(gen, ": ");
+            codegen_generate_type_annotation(gen, method->method_decl.return_type);
+        }
+        
+        codegen_write_punct(gen, ";\n");
+    }
+    
+    codegen_decrease_indent(gen);
+    codegen_write(gen, "}");
+}
+
+// Top-level function name for a trait method under static dispatch: UserShow$show
+static void codegen_write_dispatch_name(CodeGenerator* gen, ASTNode* impl, ASTNode* method) {
+    codegen_write(gen, impl->impl_block.type_name);
+    codegen_write(gen, impl->impl_block.trait_name);
+    codegen_write(gen, "$");
+    codegen_write(gen, method->method_decl.name);
+}
+
+// (obj: Type, params): ReturnType
+static void codegen_generate_impl_method_signature(CodeGenerator* gen, ASTNode* impl, ASTNode* method) {
+    codegen_write(gen, "(obj");
+    if (!gen->options.emit_js) {
+        codegen_write_punct(gen, ": ");
+        codegen_write(gen, impl->impl_block.type_name);
+    }
+    
+    if (method->method_decl.params && method->method_decl.params->count > 0) {
+        codegen_write_punct(gen, ", ");
+        codegen_generate_parameter_list(gen, method->method_decl.params);
+    }
+    
+    codegen_write(gen, ")");
+    
+    if (method->method_decl.return_type && !gen->options.emit_js) {
+        codegen_write_punct(gen, ": ");
+        codegen_generate_return_type(gen, method->method_decl.return_type, codegen_contains_await(gen, method->method_decl.body));
+    }
+}
+
+static void codegen_generate_impl_method_body(CodeGenerator* gen, ASTNode* method) {
+    if (method->method_decl.body) {
+        codegen_generate_block(gen, method->method_decl.body);
+    } else {
+        codegen_write(gen, "{}");
+    }
+}
+
+// Resolves Object.method to a trait impl method when Object names a trait impl object
+static CodegenDispatchEntry* codegen_dispatch_slot(CodegenDispatchIndex* index, const char* object, const char* method) {
+    uintptr_t hash = ((uintptr_t)object >> 3) * 31 + ((uintptr_t)method >> 3);
+    uintptr_t slot = hash & (index->capacity - 1);
+    while (index->entries[slot].object &&
+           (index->entries[slot].object != object || index->entries[slot].method != method)) {
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return &index->entries[slot];
+}
+
+// Built once per program; the first impl of a type and trait wins, as
+// declarations are searched in order
+static CodegenDispatchIndex* codegen_dispatch_index_build(ASTNode* program) {
+    ASTList* declarations = program->program.declarations;
+    
+    int methods = 0;
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* impl = ast_unwrap_export(declarations->nodes[i]);
+        if (impl->type == AST_IMPL_BLOCK && impl->impl_block.trait_name) {
+            methods += impl->impl_block.methods->count;
+        }
+    }
+    
+    CodegenDispatchIndex* index = malloc(sizeof(CodegenDispatchIndex));
+    index->count = 0;
+    index->capacity = 16;
+    while (index->capacity < methods * 2) {
+        index->capacity *= 2;
+    }
+    index->entries = calloc(index->capacity, sizeof(CodegenDispatchEntry));
+    
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* impl = ast_unwrap_export(declarations->nodes[i]);
+        if (impl->type != AST_IMPL_BLOCK || !impl->impl_block.trait_name) continue;
+        
+        size_t type_length = strlen(impl->impl_block.type_name);
+        size_t trait_length = strlen(impl->impl_block.trait_name);
+        char* object = malloc(type_length + trait_length + 1);
+        memcpy(object, impl->impl_block.type_name, type_length);
+        memcpy(object + type_length, impl->impl_block.trait_name, trait_length + 1);
+        const char* name = intern(object);
+        free(object);
+        for (int m = 0; m < impl->impl_block.methods->count; m++) {
+            ASTNode* method = impl->impl_block.methods->nodes[m];
+            CodegenDispatchEntry* entry = codegen_dispatch_slot(index, name, method->method_decl.name);
+            if (entry->object) continue;
+            
+            entry->object = name;
+            entry->method = method->method_decl.name;
+            entry->impl = impl;
+            entry->decl = method;
+            index->count++;
+        }
+    }
+    return index;
+}
+
+static void codegen_dispatch_index_free(CodegenDispatchIndex* index) {
+    if (index) {
+        free(index->entries);
+        free(index);
+    }
+}
+
+// TypeTrait.method, when the program has that impl: the method and its impl
+static ASTNode* codegen_resolve_static_method(CodeGenerator* gen, ASTNode* callee, ASTNode** impl_out) {
+    if (!gen->dispatch || gen->dispatch->count == 0) return NULL;
+    if (callee->type != AST_MEMBER_ACCESS || callee->member_access.object->type != AST_IDENTIFIER) return NULL;
+    
+    CodegenDispatchEntry* entry = codegen_dispatch_slot(gen->dispatch, callee->member_access.object->identifier.name,
+                                                        callee->member_access.member);
+    if (!entry->object) return NULL;
+    
+    *impl_out = entry->impl;
+    return entry->decl;
+}
+
+void codegen_generate_impl_block(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_IMPL_BLOCK) return;
+    
+    if (node->impl_block.trait_name) {
+        // Static dispatch: every method is also a top-level function the JIT can inline
+        if (gen->options.static_dispatch) {
+            for (int i = 0; i < node->impl_block.methods->count; i++) {
+                ASTNode* method = node->impl_block.methods->nodes[i];
+                if (codegen_contains_await(gen, method->method_decl.body)) {
+                    codegen_write(gen, "async ");
+                }
+                codegen_write(gen, "function ");
+                codegen_write_dispatch_name(gen, node, method);
+                codegen_generate_impl_method_signature(gen, node, method);
+                codegen_write_punct(gen, " ");
+                codegen_generate_impl_method_body(gen, method);
+                codegen_write_punct(gen, "\n");
+            }
+        }
+        
+        // Trait implementation - generate functional object
+        codegen_write_export(gen);
+        codegen_write(gen, "const ");
+        codegen_write(gen, node->impl_block.type_name);
+        codegen_write(gen, node->impl_block.trait_name);
+        codegen_write_punct(gen, " = {\n");
+        codegen_increase_indent(gen);
+        
+        for (int i = 0; i < node->impl_block.methods->count; i++) {
+            ASTNode* method = node->impl_block.methods->nodes[i];
+            codegen_write_indent(gen);
+            codegen_write(gen, method->method_decl.name);
+            codegen_write_punct(gen, ": ");
+            
+            if (gen->options.static_dispatch) {
+                codegen_write_dispatch_name(gen, node, method);
+            } else {
+                if (codegen_contains_await(gen, method->method_decl.body)) {
+                    codegen_write(gen, "async ");
+                }
+                codegen_generate_impl_method_signature(gen, node, method);
+                codegen_write_punct(gen, " => ");
+                codegen_generate_impl_method_body(gen, method);
+            }
+            
+            if (i < node->impl_block.methods->count - 1) {
+                codegen_write(gen, ",");
+            }
+            codegen_write_punct(gen, "\n");
+        }
+        
+        codegen_decrease_indent(gen);
+        codegen_write(gen, "};");
+    } else {
+        // Type implementation - generate class
+        codegen_write_export(gen);
+        codegen_write(gen, "class ");
+        codegen_write(gen, node->impl_block.type_name);
+        codegen_write(gen, "Impl");
+        
+        if (node->impl_block.generic_params && node->impl_block.generic_params->count > 0 && !gen->options.emit_js) {
             codegen_generate_generic_params(gen, node->impl_block.generic_params);
         }
         
-        codegen_write(gen, " {\n");
+        codegen_write_punct(gen, " {\n");
         codegen_increase_indent(gen);
         
         for (int i = 0; i < node->impl_block.methods->count; i++) {
@@ -229,113 +1251,1248 @@ void codegen_generate_impl_block(CodeGenerator* gen, ASTNode* node) {
     }
 }
 
-void codegen_generate_let_binding(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_LET_BINDING) return;
+// `lazy let name = value` as an accessor that evaluates value on the first
+// call and then replaces itself with one returning the result
+static void codegen_generate_lazy_binding(CodeGenerator* gen, ASTNode* node) {
+    const char* name = node->let_binding.name;
+    ASTNode* type = gen->options.emit_js ? NULL : node->let_binding.type_annotation;
+    const char* value = codegen_temp_name(gen, "__lazy_let", "$b");
+    
+    codegen_write_export(gen);
+    codegen_write(gen, "let ");
+    codegen_write(gen, name);
+    codegen_write_punct(gen, " = ()");
+    if (type) {
+        codegen_write_punct(gen, ": ");
+        codegen_generate_type_annotation(gen, type);
+    }
+    codegen_write_punct(gen, " => {\n");
+    codegen_increase_indent(gen);
+    
+    codegen_write_indent(gen);
+    codegen_write(gen, "const ");
+    codegen_write(gen, value);
+    if (type) {
+        codegen_write_punct(gen, ": ");
+        codegen_generate_type_annotation(gen, type);
+    }
+    codegen_write_punct(gen, " = ");
+    codegen_generate_expression(gen, node->let_binding.value->lazy_expr.value);
+    codegen_write_punct(gen, ";\n");
+    
+    codegen_write_indent(gen);
+    codegen_write(gen, name);
+    codegen_write_punct(gen, " = () => ");
+    codegen_write(gen, value);
+    codegen_write_punct(gen, ";\n");
+    
+    codegen_write_indent(gen);
+    codegen_write(gen, "return ");
+    codegen_write(gen, value);
+    codegen_write_punct(gen, ";\n");
+    
+    codegen_decrease_indent(gen);
+    codegen_write_indent(gen);
+    codegen_write(gen, "};");
+}
+
+void codegen_generate_let_binding(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_LET_BINDING) return;
+    
+    ASTNode* value = node->let_binding.value;
+    if (value && value->type == AST_LAZY_EXPR && value->lazy_expr.deferred) {
+        codegen_generate_lazy_binding(gen, node);
+        return;
+    }
+    
+    codegen_write_export(gen);
+    codegen_write(gen, "const ");
+    codegen_write(gen, node->let_binding.name);
+    
+    if (node->let_binding.type_annotation && !gen->options.emit_js) {
+        codegen_write_punct(gen, ": ");
+        codegen_generate_type_annotation(gen, node->let_binding.type_annotation);
+    }
+    
+    codegen_write_punct(gen, " = ");
+    codegen_generate_expression(gen, node->let_binding.value);
+    codegen_write(gen, ";");
+}
+
+static void codegen_generate_tail(CodeGenerator* gen, ASTNode* function, ASTNode* node);
+
+// The arm's hit counter when instrumented, then its value
+static void codegen_generate_match_arm_body(CodeGenerator* gen, ASTNode* arm) {
+    if (gen->profile_arms) {
+        int slot = profile_site_slot(gen->profile_arms, arm);
+        if (slot >= 0) {
+            char counter[48];
+            snprintf(counter, sizeof(counter), "%s[%d]++;", codegen_temp_name(gen, "__zeno_prof", "$P"), slot);
+            codegen_write_line(gen, counter);
+        }
+    }
+    if (gen->tail_function) {
+        codegen_generate_tail(gen, gen->tail_function, arm->match_arm.body);
+        return;
+    }
+    codegen_write_indent(gen);
+    codegen_write(gen, "return ");
+    codegen_generate_expression(gen, arm->match_arm.body);
+    codegen_write_punct(gen, ";\n");
+}
+
+// Reads occurrence from its temp once declared, else from its parent
+static void codegen_write_match_occurrence(CodeGenerator* gen, const MatchTree* tree, int occurrence, const char* declared) {
+    const MatchOccurrence* entry = &tree->occurrences[occurrence];
+    if (entry->access == MATCH_ROOT || declared[occurrence]) {
+        char temp[32];
+        if (entry->access == MATCH_ROOT) {
+            snprintf(temp, sizeof(temp), "%s", codegen_temp_name(gen, "__match_value", "$m"));
+        } else {
+            snprintf(temp, sizeof(temp), gen->options.minify ? "$m%d" : "__match_%d", occurrence);
+        }
+        codegen_write(gen, temp);
+        return;
+    }
+    
+    codegen_write_match_occurrence(gen, tree, entry->parent, declared);
+    switch (entry->access) {
+        case MATCH_FIELD:
+            codegen_write(gen, ".");
+            codegen_write(gen, entry->key);
+            break;
+        case MATCH_INDEX: {
+            char index[32];
+            snprintf(index, sizeof(index), "[%d]", entry->index);
+            codegen_write(gen, index);
+            break;
+        }
+        case MATCH_LENGTH:
+            codegen_write(gen, ".length");
+            break;
+        case MATCH_ROOT:
+            break;
+    }
+}
+
+static void codegen_generate_match_test(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared) {
+    switch (node->test) {
+        case MATCH_TEST_EQUALS:
+            codegen_write_match_occurrence(gen, tree, node->occurrence, declared);
+            codegen_write_punct(gen, " === ");
+            if (node->value->type == AST_ATOM_LITERAL) {
+                codegen_write_atom(gen, node->value->atom_literal.value);
+            } else {
+                codegen_generate_expression(gen, node->value);
+            }
+            break;
+        case MATCH_TEST_ARRAY:
+            codegen_write(gen, "Array.isArray(");
+            codegen_write_match_occurrence(gen, tree, node->occurrence, declared);
+            codegen_write(gen, ")");
+            break;
+        case MATCH_TEST_OBJECT:
+            codegen_write(gen, "typeof ");
+            codegen_write_match_occurrence(gen, tree, node->occurrence, declared);
+            codegen_write_punct(gen, " === ");
+            codegen_write(gen, "\"object\"");
+            codegen_write_punct(gen, " && ");
+            codegen_write_match_occurrence(gen, tree, node->occurrence, declared);
+            codegen_write_punct(gen, " !== ");
+            codegen_write(gen, "null");
+            break;
+        case MATCH_TEST_LENGTH:
+        case MATCH_TEST_MIN_LENGTH: {
+            char count[32];
+            snprintf(count, sizeof(count), "%d", node->count);
+            codegen_write_match_occurrence(gen, tree, node->occurrence, declared);
+            codegen_write_punct(gen, node->test == MATCH_TEST_LENGTH ? " === " : " >= ");
+            codegen_write(gen, count);
+            break;
+        }
+    }
+}
+
+static void codegen_generate_match_node(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared);
+
+// The labelled block a shared node follows; each tree takes a label per node
+static void codegen_write_match_label(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node) {
+    char label[32];
+    snprintf(label, sizeof(label), gen->options.minify ? "$c%d" : "__match_case_%d",
+             gen->match_labels - tree->node_count + node->order);
+    codegen_write(gen, label);
+}
+
+// A shared node is generated once, after its owner's labelled block, and
+// reached by breaking out of it
+static void codegen_generate_match_goto(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared) {
+    if (node->shared) {
+        codegen_write_indent(gen);
+        codegen_write(gen, "break ");
+        codegen_write_match_label(gen, tree, node);
+        codegen_write_punct(gen, ";\n");
+        return;
+    }
+    codegen_generate_match_node(gen, tree, node, declared);
+}
+
+// A branch gets its own copy of the declared temps, as its block scopes them
+static void codegen_generate_match_branch(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared) {
+    char* copy = malloc(tree->occurrence_count);
+    memcpy(copy, declared, tree->occurrence_count);
+    codegen_increase_indent(gen);
+    codegen_generate_match_goto(gen, tree, node, copy);
+    codegen_decrease_indent(gen);
+    free(copy);
+}
+
+static void codegen_generate_match_binds(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared) {
+    for (int i = 0; i < node->bind_count; i++) {
+        const MatchBind* bind = &node->binds[i];
+        codegen_write_indent(gen);
+        codegen_write(gen, "const ");
+        codegen_write(gen, bind->name);
+        codegen_write_punct(gen, " = ");
+        codegen_write_match_occurrence(gen, tree, bind->occurrence, declared);
+        if (bind->rest_from >= 0) {
+            char slice[32];
+            snprintf(slice, sizeof(slice), ".slice(%d)", bind->rest_from);
+            codegen_write(gen, slice);
+        }
+        codegen_write_punct(gen, ";\n");
+    }
+}
+
+// A leaf binds and evaluates its arm, trying the next node if its guard fails
+static void codegen_generate_match_leaf(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared) {
+    ASTNode* guard = node->arm->match_arm.guard;
+    if (!guard) {
+        codegen_generate_match_binds(gen, tree, node, declared);
+        codegen_generate_match_arm_body(gen, node->arm);
+        return;
+    }
+    
+    // Bindings are scoped to the guarded arm so later arms may reuse names
+    if (node->bind_count > 0) {
+        codegen_write_line(gen, "{");
+        codegen_increase_indent(gen);
+        codegen_generate_match_binds(gen, tree, node, declared);
+    }
+    codegen_write_indent(gen);
+    codegen_write_punct(gen, "if (");
+    codegen_generate_expression(gen, guard);
+    codegen_write_punct(gen, ") {\n");
+    codegen_increase_indent(gen);
+    codegen_generate_match_arm_body(gen, node->arm);
+    codegen_decrease_indent(gen);
+    codegen_write_line(gen, "}");
+    if (node->bind_count > 0) {
+        codegen_decrease_indent(gen);
+        codegen_write_line(gen, "}");
+    }
+    codegen_generate_match_goto(gen, tree, node->next, declared);
+}
+
+// A test and its branches, with tests on temps already in scope chained as
+// else-ifs. Falling out of the chain reaches fallthrough, the innermost
+// shared node after it, so no else is needed for that.
+static void codegen_generate_match_tests(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node,
+                                         const MatchNode* fallthrough, char* local) {
+    codegen_write_indent(gen);
+    codegen_write_punct(gen, "if (");
+    codegen_generate_match_test(gen, tree, node, local);
+    codegen_write_punct(gen, ") {\n");
+    codegen_generate_match_branch(gen, tree, node->then_branch, local);
+    
+    const MatchNode* rest = node->else_branch;
+    while (rest->kind == MATCH_NODE_TEST && !rest->shared && !rest->owned &&
+           (local[rest->occurrence] || tree->occurrences[rest->occurrence].access == MATCH_ROOT)) {
+        codegen_write_indent(gen);
+        codegen_write_punct(gen, "} else if (");
+        codegen_generate_match_test(gen, tree, rest, local);
+        codegen_write_punct(gen, ") {\n");
+        codegen_generate_match_branch(gen, tree, rest->then_branch, local);
+        rest = rest->else_branch;
+    }
+    
+    if (rest != fallthrough && (rest->kind != MATCH_NODE_FAIL || tree->shared)) {
+        codegen_write_indent(gen);
+        codegen_write_punct(gen, "} else {\n");
+        codegen_generate_match_branch(gen, tree, rest, local);
+    }
+    codegen_write_line(gen, "}");
+}
+
+// owned's labelled block around the blocks of the shared nodes node owns
+// inside it, with node's own code innermost; owned follows its block, seeing
+// only the temps declared before the blocks
+static void codegen_generate_match_owned(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node,
+                                         const MatchNode* owned, char* local) {
+    codegen_write_indent(gen);
+    codegen_write_match_label(gen, tree, owned);
+    codegen_write_punct(gen, ": {\n");
+    codegen_increase_indent(gen);
+    if (owned->owned_next) {
+        codegen_generate_match_owned(gen, tree, node, owned->owned_next, local);
+    } else if (node->kind == MATCH_NODE_TEST) {
+        codegen_generate_match_tests(gen, tree, node, owned, local);
+    } else {
+        codegen_generate_match_leaf(gen, tree, node, local);
+    }
+    codegen_decrease_indent(gen);
+    codegen_write_line(gen, "}");
+    
+    char* copy = malloc(tree->occurrence_count);
+    memcpy(copy, local, tree->occurrence_count);
+    codegen_generate_match_node(gen, tree, owned, copy);
+    free(copy);
+}
+
+// Failing paths fall through to the throw after the tree, so FAIL emits
+// nothing, unless the fall would land in a shared node
+static void codegen_generate_match_node(CodeGenerator* gen, const MatchTree* tree, const MatchNode* node, const char* declared) {
+    char* local = (char*)declared;
+    
+    if (node->kind == MATCH_NODE_FAIL) {
+        if (tree->shared) {
+            codegen_write_line(gen, "throw new Error(\"Non-exhaustive match\");");
+        }
+        return;
+    }
+    
+    if (node->kind == MATCH_NODE_LEAF && !node->owned) {
+        codegen_generate_match_leaf(gen, tree, node, declared);
+        return;
+    }
+    
+    // Each occurrence is read once, into a temp before its first test, and
+    // later tests and bindings below it reuse the temp
+    if (node->kind == MATCH_NODE_TEST && !declared[node->occurrence] &&
+        tree->occurrences[node->occurrence].access != MATCH_ROOT) {
+        char temp[32];
+        snprintf(temp, sizeof(temp), gen->options.minify ? "$m%d" : "__match_%d", node->occurrence);
+        codegen_write_indent(gen);
+        codegen_write(gen, "const ");
+        codegen_write(gen, temp);
+        codegen_write_punct(gen, " = ");
+        codegen_write_match_occurrence(gen, tree, node->occurrence, declared);
+        codegen_write_punct(gen, ";\n");
+        local[node->occurrence] = 1;
+    }
+    
+    if (node->owned) {
+        codegen_generate_match_owned(gen, tree, node, node->owned, local);
+    } else {
+        codegen_generate_match_tests(gen, tree, node, NULL, local);
+    }
+}
+
+// Literal, atom and wildcard arms: one comparison each, in order
+static void codegen_generate_match_chain(CodeGenerator* gen, ASTNode* node, const char* match_value) {
+    // Past a proven-exhaustive arm nothing is reachable, and that arm needs no test
+    int count = node->match_expr.arms->count;
+    int exhaustive = node->match_expr.exhaustive_arms > 0 && node->match_expr.exhaustive_arms <= count;
+    if (exhaustive) {
+        count = node->match_expr.exhaustive_arms;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        ASTNode* arm = node->match_expr.arms->nodes[i];
+        
+        if (exhaustive && i == count - 1) {
+            if (i > 0) {
+                codegen_write_indent(gen);
+                codegen_write_punct(gen, "} else {\n");
+                codegen_increase_indent(gen);
+            }
+            codegen_generate_match_arm_body(gen, arm);
+            if (i > 0) {
+                codegen_decrease_indent(gen);
+                codegen_write_line(gen, "}");
+            }
+            break;
+        }
+        
+        if (i == 0) {
+            codegen_write_indent(gen);
+            codegen_write_punct(gen, "if (");
+        } else {
+            codegen_write_indent(gen);
+            codegen_write_punct(gen, "} else if (");
+        }
+        
+        // Generate pattern matching condition
+        ASTNode* pattern = arm->match_arm.pattern;
+        if (pattern->type == AST_IDENTIFIER && pattern->identifier.name == intern_underscore) {
+            codegen_write(gen, "true");
+        } else if (pattern->type == AST_ATOM_LITERAL) {
+            codegen_write(gen, match_value);
+            codegen_write_punct(gen, " === ");
+            codegen_write_atom(gen, pattern->atom_literal.value);
+        } else {
+            codegen_write(gen, match_value);
+            codegen_write_punct(gen, " === ");
+            codegen_generate_expression(gen, pattern);
+        }
+        
+        // Add guard condition if present
+        if (arm->match_arm.guard) {
+            codegen_write_punct(gen, " && (");
+            codegen_generate_expression(gen, arm->match_arm.guard);
+            codegen_write(gen, ")");
+        }
+        
+        codegen_write_punct(gen, ") {\n");
+        codegen_increase_indent(gen);
+        codegen_generate_match_arm_body(gen, arm);
+        codegen_decrease_indent(gen);
+    }
+    
+    if (!exhaustive) {
+        codegen_write_indent(gen);
+        codegen_write_punct(gen, "} else {\n");
+        codegen_increase_indent(gen);
+        codegen_write_line(gen, "throw new Error(\"Non-exhaustive match\");");
+        codegen_decrease_indent(gen);
+        codegen_write_line(gen, "}");
+    }
+}
+
+// Arms returning from an immediately invoked function, or as statements in
+// the tail of a looping lambda, where they return or continue the loop
+static void codegen_generate_match(CodeGenerator* gen, ASTNode* node, ASTNode* tail) {
+    const char* match_value = codegen_temp_name(gen, "__match_value", "$m");
+    ASTNode* outer_tail = gen->tail_function;
+    gen->tail_function = NULL;
+    
+    // Awaiting arms need an async function, whose promise is awaited in turn
+    int async = !tail && codegen_contains_await(gen, node);
+    if (tail) {
+        codegen_write_indent(gen);
+        codegen_write_punct(gen, "{\n");
+    } else {
+        codegen_write_punct(gen, async ? "(await (async () => {\n" : "(() => {\n");
+    }
+    codegen_increase_indent(gen);
+    codegen_write_indent(gen);
+    codegen_write(gen, "const ");
+    codegen_write(gen, match_value);
+    codegen_write_punct(gen, " = \n");
+    codegen_generate_expression(gen, node->match_expr.expr);
+    codegen_write_punct(gen, ";\n");
+    gen->tail_function = tail;
+    
+    if (match_needs_tree(node)) {
+        MatchTree* tree = match_tree_build(node);
+        char* declared = calloc(tree->occurrence_count > 0 ? tree->occurrence_count : 1, 1);
+        gen->match_labels += tree->node_count;
+        codegen_generate_match_node(gen, tree, tree->root, declared);
+        gen->match_labels -= tree->node_count;
+        if (tree->can_fail && !tree->shared) {
+            codegen_write_line(gen, "throw new Error(\"Non-exhaustive match\");");
+        }
+        free(declared);
+        match_tree_free(tree);
+    } else {
+        codegen_generate_match_chain(gen, node, match_value);
+    }
+    
+    gen->tail_function = outer_tail;
+    codegen_decrease_indent(gen);
+    if (tail) {
+        codegen_write_line(gen, "}");
+    } else {
+        codegen_write(gen, async ? "})())" : "})()");
+    }
+}
+
+void codegen_generate_match_expr(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_MATCH_EXPR) return;
+    codegen_generate_match(gen, node, NULL);
+}
+
+// Whether arg passes param straight through, needing no assignment.
+// tailcall_mark rules out loops whose body rebinds a parameter's name, so
+// an identifier named after the parameter resolves to it.
+static int codegen_tail_passes_through(ASTNode* param, ASTNode* arg) {
+    return arg->type == AST_IDENTIFIER && !arg->identifier.lazy &&
+           arg->identifier.name == param->param_decl.name;
+}
+
+// f(x, y) in the tail of f: reassign the parameters and go round again. The
+// new values are all computed before any parameter changes.
+static void codegen_generate_tail_call(CodeGenerator* gen, ASTNode* function, ASTNode* call) {
+    ASTList* params = function->function_decl.params;
+    ASTList* args = call->call_expr.args;
+    
+    int changed = 0;
+    for (int i = 0; i < params->count; i++) {
+        changed += !codegen_tail_passes_through(params->nodes[i], args->nodes[i]);
+    }
+    
+    char temp[32];
+    for (int i = 0; i < params->count && changed > 1; i++) {
+        ASTNode* arg = args->nodes[i];
+        if (codegen_tail_passes_through(params->nodes[i], arg)) continue;
+        
+        snprintf(temp, sizeof(temp), gen->options.minify ? "$t%d" : "__tail_%d", i);
+        codegen_write_indent(gen);
+        codegen_write(gen, "const ");
+        codegen_write(gen, temp);
+        codegen_write_punct(gen, " = ");
+        codegen_generate_expression(gen, arg);
+        codegen_write_punct(gen, ";\n");
+    }
+    
+    for (int i = 0; i < params->count; i++) {
+        ASTNode* arg = args->nodes[i];
+        if (codegen_tail_passes_through(params->nodes[i], arg)) continue;
+        
+        codegen_write_indent(gen);
+        codegen_write(gen, params->nodes[i]->param_decl.name);
+        codegen_write_punct(gen, " = ");
+        if (changed > 1) {
+            snprintf(temp, sizeof(temp), gen->options.minify ? "$t%d" : "__tail_%d", i);
+            codegen_write(gen, temp);
+        } else {
+            codegen_generate_expression(gen, arg);
+        }
+        codegen_write_punct(gen, ";\n");
+    }
+    
+    codegen_write_line(gen, "continue;");
+}
+
+// node in tail position of a function body, as statements that return its
+// value; with a looping function, its marked self calls continue the loop
+static void codegen_generate_expression_node(CodeGenerator* gen, ASTNode* node);
+static void codegen_generate_tail_node(CodeGenerator* gen, ASTNode* function, ASTNode* node);
+
+typedef struct {
+    CodeGenerator* gen;
+    ASTNode* function;      // Looping function of a tail, NULL for an expression
+    ASTNode* node;
+    int tail;
+} CodegenDescent;
+
+static void codegen_descend_run(void* context) {
+    CodegenDescent* descent = context;
+    if (descent->tail) {
+        codegen_generate_tail_node(descent->gen, descent->function, descent->node);
+    } else {
+        codegen_generate_expression_node(descent->gen, descent->node);
+    }
+}
+
+// Generate node one level deeper, continuing on a fresh stack every
+// PARALLEL_STACK_DEPTH levels
+static void codegen_descend(CodeGenerator* gen, ASTNode* function, ASTNode* node, int tail) {
+    CodegenDescent descent = { gen, function, node, tail };
+    if (++gen->depth % PARALLEL_STACK_DEPTH == 0) {
+        parallel_call_on_new_stack(codegen_descend_run, &descent);
+    } else {
+        codegen_descend_run(&descent);
+    }
+    gen->depth--;
+}
+
+void codegen_generate_expression(CodeGenerator* gen, ASTNode* node) {
+    codegen_descend(gen, NULL, node, 0);
+}
+
+static void codegen_generate_tail(CodeGenerator* gen, ASTNode* function, ASTNode* node) {
+    codegen_descend(gen, function, node, 1);
+}
+
+static void codegen_generate_tail_node(CodeGenerator* gen, ASTNode* function, ASTNode* node) {
+    while (node && node->type == AST_BLOCK) {
+        ASTList* statements = node->block.statements;
+        for (int i = 0; i < statements->count - 1; i++) {
+            codegen_write_indent(gen);
+            codegen_generate_expression(gen, statements->nodes[i]);
+            codegen_write_punct(gen, ";\n");
+        }
+        node = statements->count > 0 ? statements->nodes[statements->count - 1] : NULL;
+    }
+    
+    if (!node) {
+        codegen_write_line(gen, "return;");
+    } else if (function && node->type == AST_CALL_EXPR && node->call_expr.tail_call) {
+        codegen_generate_tail_call(gen, function, node);
+    } else if (function && node->type == AST_MATCH_EXPR) {
+        codegen_generate_match(gen, node, function);
+    } else {
+        codegen_write_indent(gen);
+        codegen_write(gen, "return ");
+        codegen_generate_expression(gen, node);
+        codegen_write_punct(gen, ";\n");
+    }
+}
+
+// (a: A, b: B): R => body, where a block body returns its last statement
+void codegen_generate_lambda(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_FUNCTION_DECL) return;
+    
+    int async = codegen_contains_await(gen, node->function_decl.body);
+    if (async) {
+        codegen_write(gen, "async ");
+    }
+    codegen_write(gen, "(");
+    codegen_generate_parameter_list(gen, node->function_decl.params);
+    codegen_write(gen, ")");
+    
+    if (node->function_decl.return_type && !gen->options.emit_js) {
+        codegen_write_punct(gen, ": ");
+        codegen_generate_return_type(gen, node->function_decl.return_type, async);
+    }
+    codegen_write_punct(gen, " => ");
+    
+    ASTNode* body = node->function_decl.body;
+    if (!node->function_decl.tail_loop && body->type == AST_OBJECT_LITERAL) {
+        // A bare { after => would open a block
+        codegen_write(gen, "(");
+        codegen_generate_expression(gen, body);
+        codegen_write(gen, ")");
+        return;
+    }
+    if (!node->function_decl.tail_loop && body->type != AST_BLOCK) {
+        codegen_generate_expression(gen, body);
+        return;
+    }
+    
+    ASTNode* outer_tail = gen->tail_function;
+    gen->tail_function = NULL;
+    codegen_write_punct(gen, "{\n");
+    codegen_increase_indent(gen);
+    if (node->function_decl.tail_loop) {
+        codegen_write_indent(gen);
+        codegen_write_punct(gen, "while (true) {\n");
+        codegen_increase_indent(gen);
+        codegen_generate_tail(gen, node, body);
+        codegen_decrease_indent(gen);
+        codegen_write_line(gen, "}");
+    } else {
+        codegen_generate_tail(gen, NULL, body);
+    }
+    codegen_decrease_indent(gen);
+    codegen_write_indent(gen);
+    codegen_write(gen, "}");
+    gen->tail_function = outer_tail;
+}
+
+// __zeno_pipe_base + slot, then the separator before the stage's operands
+static void codegen_write_pipe_site(CodeGenerator* gen, int slot) {
+    char site[32];
+    snprintf(site, sizeof(site), "%d", slot);
+    codegen_write(gen, codegen_temp_name(gen, "__zeno_pipe_base", "$B"));
+    codegen_write_punct(gen, " + ");
+    codegen_write(gen, site);
+    codegen_write_punct(gen, ", ");
+}
+
+// Pipe chains are left-nested, so a chain of n stages is n levels deep. The
+// spine is walked with a loop: every stage's prefix is written outermost
+// first, then the innermost value, then the suffixes innermost first.
+//
+// `|> await f` awaits that stage's result, and `|> mapAsync(f, limit)` maps
+// a collection through an async f with at most limit calls in flight.
+void codegen_generate_pipe_expr(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_PIPE_EXPR) return;
+    
+    int count = 0;
+    for (ASTNode* stage = node; stage->type == AST_PIPE_EXPR; stage = stage->pipe_expr.left) {
+        count++;
+    }
+    
+    ASTNode** stages = malloc(count * sizeof(ASTNode*));
+    // Stages whose suffix is a member access on their operand
+    char* postfix = calloc(count, 1);
+    
+    ASTNode* stage = node;
+    for (int i = 0; i < count; i++, stage = stage->pipe_expr.left) {
+        stages[i] = stage;
+        
+        ASTNode* right = stage->pipe_expr.right;
+        int slot = gen->pipe_sites ? profile_site_slot(gen->pipe_sites, stage) : -1;
+        if (right->type == AST_AWAIT_EXPR) {
+            // Parenthesized when the next stage accesses a member of the result
+            codegen_write(gen, i > 0 && postfix[i - 1] ? "(await " : "await ");
+            right = right->await_expr.argument;
+        }
+        
+        if (codegen_is_map_async(gen, right)) {
+            codegen_write(gen, codegen_temp_name(gen, "__zeno_map_async", "$A"));
+            codegen_write(gen, "(");
+            continue;
+        }
+        
+        if (right->type == AST_IDENTIFIER && codegen_is_builtin_method(right->identifier.name)) {
+            // Method chaining for built-in string/array methods: value.method()
+            if (slot >= 0 && right->identifier.name != intern_length) {
+                codegen_write(gen, codegen_temp_name(gen, "__zeno_pipes", "$T"));
+                codegen_write(gen, ".method(");
+                codegen_write_pipe_site(gen, slot);
+            } else {
+                postfix[i] = 1;
+            }
+            continue;
+        }
+        
+        if (slot >= 0) {
+            // Traced: value |> func => __zeno_pipes.call(site, func, value)
+            codegen_write(gen, codegen_temp_name(gen, "__zeno_pipes", "$T"));
+            codegen_write(gen, ".call(");
+            codegen_write_pipe_site(gen, slot);
+        }
+        
+        // Resolvable trait method: value |> UserShow.show => UserShow$show(value)
+        ASTNode* impl = NULL;
+        ASTNode* method = codegen_resolve_static_method(gen, right, &impl);
+        if (method) {
+            codegen_write_dispatch_name(gen, impl, method);
+        } else {
+            // Default function call transformation: value |> func => func(value)
+            if (right->type == AST_FUNCTION_DECL) {
+                codegen_write(gen, "(");
+                codegen_generate_expression(gen, right);
+                codegen_write(gen, ")");
+            } else {
+                codegen_generate_expression(gen, right);
+            }
+        }
+        codegen_write_punct(gen, slot >= 0 ? ", " : "(");
+    }
+    
+    if (stage->type == AST_AWAIT_EXPR && postfix[count - 1]) {
+        codegen_write(gen, "(");
+        codegen_generate_expression(gen, stage);
+        codegen_write(gen, ")");
+    } else {
+        codegen_generate_expression(gen, stage);
+    }
+    
+    for (int i = count - 1; i >= 0; i--) {
+        ASTNode* right = stages[i]->pipe_expr.right;
+        int awaited = right->type == AST_AWAIT_EXPR;
+        if (awaited) {
+            right = right->await_expr.argument;
+        }
+        
+        int slot = gen->pipe_sites ? profile_site_slot(gen->pipe_sites, stages[i]) : -1;
+        if (codegen_is_map_async(gen, right)) {
+            // The function, then the limit if given
+            ASTList* args = right->call_expr.args;
+            for (int j = 0; j < args->count; j++) {
+                codegen_write_punct(gen, ", ");
+                codegen_generate_expression(gen, args->nodes[j]);
+            }
+            codegen_write(gen, ")");
+        } else if (right->type == AST_IDENTIFIER && codegen_is_builtin_method(right->identifier.name)) {
+            // A length read is a property access, too cheap to be worth timing
+            if (slot >= 0 && right->identifier.name != intern_length) {
+                codegen_write_punct(gen, ", \"");
+                codegen_write(gen, right->identifier.name);
+                codegen_write(gen, "\")");
+            } else {
+                codegen_write(gen, ".");
+                codegen_write(gen, right->identifier.name);
+                if (right->identifier.name != intern_length) {
+                    codegen_write(gen, "()");
+                }
+            }
+        } else {
+            codegen_write(gen, ")");
+        }
+        
+        if (awaited && i > 0 && postfix[i - 1]) {
+            codegen_write(gen, ")");
+        }
+    }
+    
+    free(stages);
+    free(postfix);
+}
+
+// Lazy pipes
+//
+// A chain of `|>>` stages is fused into one loop over the source, inside a
+// generator, or inside a plain function when the chain ends in a terminal
+// stage that consumes it. Every value goes through all stages before the
+// next is pulled from the source, and nothing is pulled after a take() is
+// satisfied, so no intermediate arrays are built and an infinite source is
+// fine. Bare functions and built-in methods apply to each value.
+
+typedef enum {
+    LAZY_APPLY,             // f: each value through f
+    LAZY_METHOD,            // trim: each value's built-in method
+    LAZY_MAP,
+    LAZY_FILTER,
+    LAZY_TAKE,
+    LAZY_TAKE_WHILE,
+    LAZY_DROP,
+    LAZY_DROP_WHILE,
+    LAZY_FLAT_MAP,
     
-    codegen_write(gen, "const ");
-    codegen_write(gen, node->let_binding.name);
+    // Terminal stages, recognized only last in a chain
+    LAZY_TO_ARRAY,
+    LAZY_COUNT,
+    LAZY_FIRST,
+    LAZY_FIND,
+    LAZY_SOME,
+    LAZY_EVERY,
+    LAZY_REDUCE,
+    LAZY_FOR_EACH
+} CodegenLazyStage;
+
+static const struct {
+    const char* name;
+    CodegenLazyStage stage;
+    int args;
+} codegen_lazy_operators[] = {
+    { "map", LAZY_MAP, 1 },
+    { "filter", LAZY_FILTER, 1 },
+    { "take", LAZY_TAKE, 1 },
+    { "takeWhile", LAZY_TAKE_WHILE, 1 },
+    { "drop", LAZY_DROP, 1 },
+    { "dropWhile", LAZY_DROP_WHILE, 1 },
+    { "flatMap", LAZY_FLAT_MAP, 1 },
+    { "toArray", LAZY_TO_ARRAY, 0 },
+    { "count", LAZY_COUNT, 0 },
+    { "first", LAZY_FIRST, 0 },
+    { "find", LAZY_FIND, 1 },
+    { "some", LAZY_SOME, 1 },
+    { "every", LAZY_EVERY, 1 },
+    { "reduce", LAZY_REDUCE, 2 },
+    { "forEach", LAZY_FOR_EACH, 1 },
+};
+
+static CodegenLazyStage codegen_lazy_stage(ASTNode* right, int last) {
+    const char* name = NULL;
+    int args = 0;
+    if (right->type == AST_IDENTIFIER) {
+        name = right->identifier.name;
+    } else if (right->type == AST_CALL_EXPR && right->call_expr.function->type == AST_IDENTIFIER) {
+        name = right->call_expr.function->identifier.name;
+        args = right->call_expr.args ? right->call_expr.args->count : 0;
+    }
     
-    if (node->let_binding.type_annotation) {
-        codegen_write(gen, ": ");
-        codegen_generate_type_annotation(gen, node->let_binding.type_annotation);
+    if (name) {
+        int count = sizeof(codegen_lazy_operators) / sizeof(codegen_lazy_operators[0]);
+        for (int i = 0; i < count; i++) {
+            if (strcmp(name, codegen_lazy_operators[i].name) != 0 || args != codegen_lazy_operators[i].args) continue;
+            
+            CodegenLazyStage stage = codegen_lazy_operators[i].stage;
+            if (stage < LAZY_TO_ARRAY || last) return stage;
+        }
     }
     
-    codegen_write(gen, " = ");
-    codegen_generate_expression(gen, node->let_binding.value);
-    codegen_write(gen, ";");
+    if (right->type == AST_IDENTIFIER && codegen_is_builtin_method(right->identifier.name)) {
+        return LAZY_METHOD;
+    }
+    return LAZY_APPLY;
 }
 
-void codegen_generate_match_expr(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_MATCH_EXPR) return;
+// Temporaries of a fused chain: __lazy_<kind><index>, or $<short><index> when minifying
+static void codegen_write_lazy_temp(CodeGenerator* gen, const char* name, const char* short_name, int index) {
+    char temp[48];
+    if (index < 0) {
+        snprintf(temp, sizeof(temp), "%s", gen->options.minify ? short_name : name);
+    } else {
+        snprintf(temp, sizeof(temp), gen->options.minify ? "%s%d" : "%s_%d", gen->options.minify ? short_name : name, index);
+    }
+    codegen_write(gen, temp);
+}
+
+// Leaves the outer loop, labelled when flatMap() nests loops inside it
+static void codegen_write_lazy_break(CodeGenerator* gen, int nested) {
+    codegen_write(gen, "break");
+    if (nested) {
+        codegen_write(gen, " ");
+        codegen_write_lazy_temp(gen, "__lazy", "$L", -1);
+    }
+    codegen_write_punct(gen, ";\n");
+}
+
+// Once a take() has passed on its last value and that value is done with
+// at the take's loop depth, nothing more can come out: stop
+static void codegen_write_lazy_done_checks(CodeGenerator* gen, const int* take_depths, int stages, int depth, int nested) {
+    for (int i = 0; i < stages; i++) {
+        if (take_depths[i] != depth) continue;
+        
+        codegen_write_indent(gen);
+        codegen_write_punct(gen, "if (");
+        codegen_write_lazy_temp(gen, "__lazy_done", "$d", i);
+        codegen_write_punct(gen, ") ");
+        codegen_write_lazy_break(gen, nested);
+    }
+}
+
+// Skip the current value, as a block body one level in
+static void codegen_write_lazy_skip(CodeGenerator* gen, const int* take_depths, int stage, int depth, int nested) {
+    codegen_write_punct(gen, "{\n");
+    codegen_increase_indent(gen);
+    codegen_write_lazy_done_checks(gen, take_depths, stage, depth, nested);
+    codegen_write_line(gen, "continue;");
+    codegen_decrease_indent(gen);
+    codegen_write_line(gen, "}");
+}
+
+// What the fused function returns once no more values can come out
+static void codegen_write_lazy_return(CodeGenerator* gen, CodegenLazyStage terminal) {
+    codegen_write(gen, "return");
+    if (terminal == LAZY_TO_ARRAY || terminal == LAZY_COUNT || terminal == LAZY_REDUCE) {
+        codegen_write(gen, " ");
+        codegen_write_lazy_temp(gen, "__lazy_result", "$r", -1);
+    } else if (terminal == LAZY_SOME || terminal == LAZY_EVERY) {
+        codegen_write(gen, " ");
+        codegen_write(gen, terminal == LAZY_SOME ? "false" : "true");
+    }
+    codegen_write_punct(gen, ";\n");
+}
+
+void codegen_generate_lazy_pipe_expr(CodeGenerator* gen, ASTNode* node) {
+    if (node->type != AST_LAZY_PIPE_EXPR) return;
     
-    codegen_write(gen, "(() => {\n");
+    int count = 0;
+    for (ASTNode* stage = node; stage->type == AST_LAZY_PIPE_EXPR; stage = stage->pipe_expr.left) {
+        count++;
+    }
+    
+    // Stages in source order
+    ASTNode** stages = malloc(count * sizeof(ASTNode*));
+    CodegenLazyStage* kinds = malloc(count * sizeof(CodegenLazyStage));
+    ASTNode* source = node;
+    for (int i = count - 1; i >= 0; i--, source = source->pipe_expr.left) {
+        stages[i] = source->pipe_expr.right;
+    }
+    
+    // Loop depth of each take(), -1 for other stages
+    int* take_depths = malloc(count * sizeof(int));
+    int nested = 0;
+    for (int i = 0; i < count; i++) {
+        kinds[i] = codegen_lazy_stage(stages[i], i == count - 1);
+        take_depths[i] = kinds[i] == LAZY_TAKE ? nested : -1;
+        nested += kinds[i] == LAZY_FLAT_MAP;
+    }
+    CodegenLazyStage terminal = kinds[count - 1] >= LAZY_TO_ARRAY ? kinds[count - 1] : LAZY_APPLY;
+    
+    // Stage operands are evaluated once, in order, as arguments of the fused
+    // function: operand j of stage i is __lazy_arg_<2i + j> inside it
+    codegen_write_punct(gen, terminal == LAZY_APPLY ? "(function* (" : "((");
+    codegen_write_lazy_temp(gen, "__lazy_source", "$l", -1);
+    for (int i = 0; i < count; i++) {
+        ASTNode* impl = NULL;
+        if (kinds[i] == LAZY_APPLY && !codegen_resolve_static_method(gen, stages[i], &impl)) {
+            codegen_write_punct(gen, ", ");
+            codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+        } else if (kinds[i] != LAZY_APPLY && kinds[i] != LAZY_METHOD && stages[i]->type == AST_CALL_EXPR) {
+            for (int j = 0; j < stages[i]->call_expr.args->count; j++) {
+                codegen_write_punct(gen, ", ");
+                codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2 + j);
+            }
+        }
+    }
+    codegen_write_punct(gen, terminal == LAZY_APPLY ? ") {\n" : ") => {\n");
     codegen_increase_indent(gen);
-    codegen_write_line(gen, "const __match_value = ");
-    codegen_generate_expression(gen, node->match_expr.expr);
-    codegen_write(gen, ";\n");
     
-    for (int i = 0; i < node->match_expr.arms->count; i++) {
-        ASTNode* arm = node->match_expr.arms->nodes[i];
-        
-        if (i == 0) {
+    // State kept across values
+    for (int i = 0; i < count; i++) {
+        if (kinds[i] == LAZY_TAKE || kinds[i] == LAZY_DROP) {
             codegen_write_indent(gen);
-            codegen_write(gen, "if (");
-        } else {
+            codegen_write(gen, "let ");
+            codegen_write_lazy_temp(gen, "__lazy_count", "$c", i);
+            codegen_write_punct(gen, " = 0;\n");
+        } else if (kinds[i] == LAZY_DROP_WHILE) {
             codegen_write_indent(gen);
-            codegen_write(gen, "} else if (");
+            codegen_write(gen, "let ");
+            codegen_write_lazy_temp(gen, "__lazy_dropping", "$w", i);
+            codegen_write_punct(gen, " = true;\n");
         }
+    }
+    for (int i = 0; i < count; i++) {
+        if (kinds[i] != LAZY_TAKE) continue;
         
-        // Generate pattern matching condition
-        ASTNode* pattern = arm->match_arm.pattern;
-        if (pattern->type == AST_IDENTIFIER && strcmp(pattern->identifier.name, "_") == 0) {
-            codegen_write(gen, "true");
-        } else if (pattern->type == AST_ATOM_LITERAL) {
-            codegen_write(gen, "__match_value === ");
-            codegen_write(gen, codegen_atom_to_symbol(pattern->atom_literal.value));
+        codegen_write_indent(gen);
+        codegen_write(gen, "let ");
+        codegen_write_lazy_temp(gen, "__lazy_done", "$d", i);
+        codegen_write_punct(gen, " = ");
+        codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+        codegen_write_punct(gen, " <= 0;\n");
+    }
+    if (terminal == LAZY_TO_ARRAY || terminal == LAZY_COUNT || terminal == LAZY_REDUCE) {
+        codegen_write_indent(gen);
+        codegen_write(gen, terminal == LAZY_TO_ARRAY ? "const " : "let ");
+        codegen_write_lazy_temp(gen, "__lazy_result", "$r", -1);
+        codegen_write_punct(gen, " = ");
+        if (terminal == LAZY_TO_ARRAY) {
+            codegen_write(gen, "[]");
+        } else if (terminal == LAZY_COUNT) {
+            codegen_write(gen, "0");
         } else {
-            codegen_write(gen, "__match_value === ");
-            codegen_generate_expression(gen, pattern);
+            codegen_write_lazy_temp(gen, "__lazy_arg", "$a", (count - 1) * 2 + 1);
         }
+        codegen_write_punct(gen, ";\n");
+    }
+    
+    // A take(0) or less anywhere lets nothing through: return before the
+    // source is pulled or any stage runs
+    int takes = 0;
+    for (int i = 0; i < count; i++) {
+        if (kinds[i] != LAZY_TAKE) continue;
         
-        // Add guard condition if present
-        if (arm->match_arm.guard) {
-            codegen_write(gen, " && (");
-            codegen_generate_expression(gen, arm->match_arm.guard);
-            codegen_write(gen, ")");
+        if (takes++ == 0) {
+            codegen_write_indent(gen);
+            codegen_write_punct(gen, "if (");
+        } else {
+            codegen_write_punct(gen, " || ");
         }
+        codegen_write_lazy_temp(gen, "__lazy_done", "$d", i);
+    }
+    if (takes) {
+        codegen_write_punct(gen, ") ");
+        codegen_write_lazy_return(gen, terminal);
+    }
+    
+    // The value after stage i is __lazy_<i>; the loop variable is __lazy_value
+    codegen_write_indent(gen);
+    if (nested) {
+        codegen_write_lazy_temp(gen, "__lazy", "$L", -1);
+        codegen_write_punct(gen, ": ");
+    }
+    codegen_write_punct(gen, "for (");
+    codegen_write(gen, "const ");
+    codegen_write_lazy_temp(gen, "__lazy_value", "$v", -1);
+    codegen_write(gen, " of ");
+    codegen_write_lazy_temp(gen, "__lazy_source", "$l", -1);
+    codegen_write_punct(gen, ") {\n");
+    codegen_increase_indent(gen);
+    
+    int depth = 0;
+    int current = -1;
+    for (int i = 0; i < count; i++) {
+        CodegenLazyStage kind = kinds[i];
+        if (kind >= LAZY_TO_ARRAY) break;
         
-        codegen_write(gen, ") {\n");
-        codegen_increase_indent(gen);
         codegen_write_indent(gen);
-        codegen_write(gen, "return ");
-        codegen_generate_expression(gen, arm->match_arm.body);
-        codegen_write(gen, ";\n");
-        codegen_decrease_indent(gen);
+        switch (kind) {
+            case LAZY_APPLY:
+            case LAZY_METHOD:
+            case LAZY_MAP: {
+                ASTNode* impl = NULL;
+                ASTNode* method = kind == LAZY_APPLY ? codegen_resolve_static_method(gen, stages[i], &impl) : NULL;
+                codegen_write(gen, "const ");
+                codegen_write_lazy_temp(gen, "__lazy", "$v", i);
+                codegen_write_punct(gen, " = ");
+                if (kind == LAZY_METHOD) {
+                    codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+                    codegen_write(gen, ".");
+                    codegen_write(gen, stages[i]->identifier.name);
+                    if (stages[i]->identifier.name != intern_length) {
+                        codegen_write(gen, "()");
+                    }
+                } else {
+                    if (method) {
+                        codegen_write_dispatch_name(gen, impl, method);
+                    } else {
+                        codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+                    }
+                    codegen_write(gen, "(");
+                    codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+                    codegen_write(gen, ")");
+                }
+                codegen_write_punct(gen, ";\n");
+                current = i;
+                break;
+            }
+            case LAZY_FILTER:
+            case LAZY_TAKE_WHILE:
+                codegen_write_punct(gen, "if (!");
+                codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+                codegen_write(gen, "(");
+                codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+                codegen_write_punct(gen, ")) ");
+                if (kind == LAZY_FILTER) {
+                    codegen_write_lazy_skip(gen, take_depths, i, depth, nested);
+                } else {
+                    codegen_write_lazy_break(gen, nested);
+                }
+                break;
+            case LAZY_TAKE:
+                // The last taken value finishes its way through the stages
+                codegen_write_punct(gen, "if (++");
+                codegen_write_lazy_temp(gen, "__lazy_count", "$c", i);
+                codegen_write_punct(gen, " >= ");
+                codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+                codegen_write_punct(gen, ") ");
+                codegen_write_lazy_temp(gen, "__lazy_done", "$d", i);
+                codegen_write_punct(gen, " = true;\n");
+                break;
+            case LAZY_DROP:
+                codegen_write_punct(gen, "if (");
+                codegen_write_lazy_temp(gen, "__lazy_count", "$c", i);
+                codegen_write_punct(gen, " < ");
+                codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+                codegen_write_punct(gen, ") {\n");
+                codegen_increase_indent(gen);
+                codegen_write_indent(gen);
+                codegen_write_lazy_temp(gen, "__lazy_count", "$c", i);
+                codegen_write_punct(gen, "++;\n");
+                codegen_write_lazy_done_checks(gen, take_depths, i, depth, nested);
+                codegen_write_line(gen, "continue;");
+                codegen_decrease_indent(gen);
+                codegen_write_line(gen, "}");
+                break;
+            case LAZY_DROP_WHILE:
+                codegen_write_punct(gen, "if (");
+                codegen_write_lazy_temp(gen, "__lazy_dropping", "$w", i);
+                codegen_write_punct(gen, ") {\n");
+                codegen_increase_indent(gen);
+                codegen_write_indent(gen);
+                codegen_write_punct(gen, "if (");
+                codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+                codegen_write(gen, "(");
+                codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+                codegen_write_punct(gen, ")) ");
+                codegen_write_lazy_skip(gen, take_depths, i, depth, nested);
+                codegen_write_indent(gen);
+                codegen_write_lazy_temp(gen, "__lazy_dropping", "$w", i);
+                codegen_write_punct(gen, " = false;\n");
+                codegen_decrease_indent(gen);
+                codegen_write_line(gen, "}");
+                break;
+            case LAZY_FLAT_MAP:
+                codegen_write_punct(gen, "for (");
+                codegen_write(gen, "const ");
+                codegen_write_lazy_temp(gen, "__lazy", "$v", i);
+                codegen_write(gen, " of ");
+                codegen_write_lazy_temp(gen, "__lazy_arg", "$a", i * 2);
+                codegen_write(gen, "(");
+                codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+                codegen_write_punct(gen, ")) {\n");
+                codegen_increase_indent(gen);
+                current = i;
+                depth++;
+                break;
+            default:
+                break;
+        }
     }
     
-    codegen_write_line(gen, "} else {");
-    codegen_increase_indent(gen);
-    codegen_write_line(gen, "throw new Error(\"Non-exhaustive match\");");
-    codegen_decrease_indent(gen);
-    codegen_write_line(gen, "}");
+    // What happens to each value that made it through
+    codegen_write_indent(gen);
+    switch (terminal) {
+        case LAZY_TO_ARRAY:
+            codegen_write_lazy_temp(gen, "__lazy_result", "$r", -1);
+            codegen_write(gen, ".push(");
+            codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            codegen_write_punct(gen, ");\n");
+            break;
+        case LAZY_COUNT:
+            codegen_write_lazy_temp(gen, "__lazy_result", "$r", -1);
+            codegen_write_punct(gen, "++;\n");
+            break;
+        case LAZY_REDUCE:
+            codegen_write_lazy_temp(gen, "__lazy_result", "$r", -1);
+            codegen_write_punct(gen, " = ");
+            codegen_write_lazy_temp(gen, "__lazy_arg", "$a", (count - 1) * 2);
+            codegen_write(gen, "(");
+            codegen_write_lazy_temp(gen, "__lazy_result", "$r", -1);
+            codegen_write_punct(gen, ", ");
+            codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            codegen_write_punct(gen, ");\n");
+            break;
+        case LAZY_FOR_EACH:
+            codegen_write_lazy_temp(gen, "__lazy_arg", "$a", (count - 1) * 2);
+            codegen_write(gen, "(");
+            codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            codegen_write_punct(gen, ");\n");
+            break;
+        case LAZY_FIRST:
+            codegen_write(gen, "return ");
+            codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            codegen_write_punct(gen, ";\n");
+            break;
+        case LAZY_FIND:
+        case LAZY_SOME:
+        case LAZY_EVERY:
+            codegen_write_punct(gen, terminal == LAZY_EVERY ? "if (!" : "if (");
+            codegen_write_lazy_temp(gen, "__lazy_arg", "$a", (count - 1) * 2);
+            codegen_write(gen, "(");
+            codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            codegen_write_punct(gen, ")) ");
+            codegen_write(gen, "return ");
+            if (terminal == LAZY_FIND) {
+                codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            } else {
+                codegen_write(gen, terminal == LAZY_SOME ? "true" : "false");
+            }
+            codegen_write_punct(gen, ";\n");
+            break;
+        default:
+            codegen_write(gen, "yield ");
+            codegen_write_lazy_temp(gen, current < 0 ? "__lazy_value" : "__lazy", "$v", current);
+            codegen_write_punct(gen, ";\n");
+            break;
+    }
+    for (int innermost = depth; depth >= 0; depth--) {
+        // A first() has already returned
+        if (terminal != LAZY_FIRST || depth != innermost) {
+            codegen_write_lazy_done_checks(gen, take_depths, count, depth, nested);
+        }
+        codegen_decrease_indent(gen);
+        codegen_write_line(gen, "}");
+    }
     
+    if (terminal == LAZY_TO_ARRAY || terminal == LAZY_COUNT || terminal == LAZY_REDUCE ||
+        terminal == LAZY_SOME || terminal == LAZY_EVERY) {
+        codegen_write_indent(gen);
+        codegen_write_lazy_return(gen, terminal);
+    }
     codegen_decrease_indent(gen);
-    codegen_write(gen, "})()");
-}
-
-void codegen_generate_pipe_expr(CodeGenerator* gen, ASTNode* node) {
-    if (node->type != AST_PIPE_EXPR) return;
+    codegen_write_indent(gen);
+    codegen_write(gen, "})(");
     
-    // Handle method chaining for built-in methods
-    if (node->pipe_expr.right->type == AST_IDENTIFIER) {
-        char* method_name = node->pipe_expr.right->identifier.name;
-        
-        // Check if it's a built-in string/array method
-        if (strcmp(method_name, "trim") == 0 || 
-            strcmp(method_name, "toUpperCase") == 0 ||
-            strcmp(method_name, "toLowerCase") == 0 ||
-            strcmp(method_name, "length") == 0) {
-            
-            codegen_generate_expression(gen, node->pipe_expr.left);
-            codegen_write(gen, ".");
-            codegen_write(gen, method_name);
-            if (strcmp(method_name, "length") != 0) {
-                codegen_write(gen, "()");
+    // The source, then the operands in the order of the parameters above
+    codegen_generate_expression(gen, source);
+    for (int i = 0; i < count; i++) {
+        ASTNode* impl = NULL;
+        if (kinds[i] == LAZY_APPLY && !codegen_resolve_static_method(gen, stages[i], &impl)) {
+            codegen_write_punct(gen, ", ");
+            if (stages[i]->type == AST_FUNCTION_DECL) {
+                codegen_write(gen, "(");
+                codegen_generate_expression(gen, stages[i]);
+                codegen_write(gen, ")");
+            } else {
+                codegen_generate_expression(gen, stages[i]);
+            }
+        } else if (kinds[i] != LAZY_APPLY && kinds[i] != LAZY_METHOD && stages[i]->type == AST_CALL_EXPR) {
+            for (int j = 0; j < stages[i]->call_expr.args->count; j++) {
+                codegen_write_punct(gen, ", ");
+                codegen_generate_expression(gen, stages[i]->call_expr.args->nodes[j]);
             }
-            return;
         }
     }
-    
-    // Default function call transformation: value |> func => func(value)
-    codegen_generate_expression(gen, node->pipe_expr.right);
-    codegen_write(gen, "(");
-    codegen_generate_expression(gen, node->pipe_expr.left);
     codegen_write(gen, ")");
+    
+    free(stages);
+    free(kinds);
+    free(take_depths);
+}
+
+// name must be interned, as every AST name is
+int codegen_is_builtin_method(const char* name) {
+    return name == intern_trim ||
+           name == intern_to_upper_case ||
+           name == intern_to_lower_case ||
+           name == intern_length;
 }
 
 void codegen_generate_identifier(CodeGenerator* gen, ASTNode* node) {
     if (node->type != AST_IDENTIFIER) return;
     codegen_write(gen, node->identifier.name);
+    if (node->identifier.lazy) {
+        codegen_write(gen, "()");
+    }
 }
 
 void codegen_generate_literal(CodeGenerator* gen, ASTNode* node) {
@@ -343,35 +2500,304 @@ void codegen_generate_literal(CodeGenerator* gen, ASTNode* node) {
         case AST_NUMBER_LITERAL:
             codegen_write(gen, node->number_literal.value);
             break;
-        case AST_STRING_LITERAL: {
-            char* escaped = codegen_escape_string(node->string_literal.value);
+        case AST_STRING_LITERAL:
             codegen_write(gen, "\"");
-            codegen_write(gen, escaped);
+            codegen_write_escaped(gen, node->string_literal.value);
             codegen_write(gen, "\"");
-            free(escaped);
             break;
-        }
-        case AST_ATOM_LITERAL: {
-            char* symbol = codegen_atom_to_symbol(node->atom_literal.value);
-            codegen_write(gen, symbol);
-            free(symbol);
+        case AST_ATOM_LITERAL:
+            codegen_write_atom(gen, node->atom_literal.value);
             break;
+        default:
+            break;
+    }
+}
+
+static long* codegen_json_length_slot(CodegenJsonLengths* lengths, ASTNode* node) {
+    uintptr_t slot = ((uintptr_t)node >> 3) & (lengths->capacity - 1);
+    while (lengths->nodes[slot] && lengths->nodes[slot] != node) {
+        slot = (slot + 1) & (lengths->capacity - 1);
+    }
+    return lengths->nodes[slot] ? &lengths->lengths[slot] : NULL;
+}
+
+static void codegen_json_length_insert(CodegenJsonLengths* lengths, ASTNode* node, long length) {
+    uintptr_t slot = ((uintptr_t)node >> 3) & (lengths->capacity - 1);
+    while (lengths->nodes[slot]) {
+        slot = (slot + 1) & (lengths->capacity - 1);
+    }
+    lengths->nodes[slot] = node;
+    lengths->lengths[slot] = length;
+}
+
+static void codegen_json_length_add(CodegenJsonLengths* lengths, ASTNode* node, long length) {
+    if ((lengths->count + 1) * 2 > lengths->capacity) {
+        CodegenJsonLengths old = *lengths;
+        
+        lengths->capacity = old.capacity == 0 ? 64 : old.capacity * 2;
+        lengths->nodes = calloc(lengths->capacity, sizeof(ASTNode*));
+        lengths->lengths = malloc(lengths->capacity * sizeof(long));
+        for (int i = 0; i < old.capacity; i++) {
+            if (old.nodes[i]) {
+                codegen_json_length_insert(lengths, old.nodes[i], old.lengths[i]);
+            }
+        }
+        free(old.nodes);
+        free(old.lengths);
+    }
+    
+    codegen_json_length_insert(lengths, node, length);
+    lengths->count++;
+}
+
+static long codegen_json_length(CodeGenerator* gen, ASTNode* node);
+
+static int codegen_is_json_collection(ASTNode* node) {
+    return node->type == AST_ARRAY_LITERAL || node->type == AST_OBJECT_LITERAL;
+}
+
+static ASTList* codegen_json_items(ASTNode* node) {
+    return node->type == AST_ARRAY_LITERAL ? node->array_literal.elements : node->object_literal.properties;
+}
+
+static ASTNode* codegen_json_item_value(ASTNode* collection, ASTNode* item) {
+    return collection->type == AST_ARRAY_LITERAL ? item : item->property.value;
+}
+
+// One collection whose items are all measured already
+static long codegen_json_collection_length(CodeGenerator* gen, ASTNode* node) {
+    ASTList* items = codegen_json_items(node);
+    long length = 2;
+    for (int i = 0; i < items->count && length >= 0; i++) {
+        ASTNode* item = items->nodes[i];
+        if (node->type == AST_OBJECT_LITERAL) {
+            // A literal __proto__ sets the prototype; JSON.parse would make it a property
+            if (strcmp(item->property.key, "__proto__") == 0) {
+                return -1;
+            }
+            length += strlen(item->property.key) + 3;
+        }
+        
+        long item_length = codegen_json_length(gen, codegen_json_item_value(node, item));
+        length = item_length < 0 ? -1 : length + item_length + 1;
+    }
+    return length;
+}
+
+// Length of node as JSON, leaving out escapes, or -1 unless it is built only
+// from numbers, strings, true, false and null. Collections are measured
+// once, bottom up, and remembered in gen->json_lengths.
+static long codegen_json_length(CodeGenerator* gen, ASTNode* node) {
+    switch (node->type) {
+        case AST_NUMBER_LITERAL: {
+            // JSON has no leading zeros
+            const char* digits = node->number_literal.value;
+            if (digits[0] == '-') digits++;
+            if (digits[0] == '0' && isdigit((unsigned char)digits[1])) return -1;
+            return strlen(node->number_literal.value);
+        }
+        case AST_STRING_LITERAL:
+            return strlen(node->string_literal.value) + 2;
+        case AST_IDENTIFIER: {
+            const char* name = node->identifier.name;
+            if (strcmp(name, "true") == 0 || strcmp(name, "false") == 0 || strcmp(name, "null") == 0) {
+                return strlen(name);
+            }
+            return -1;
+        }
+        case AST_ARRAY_LITERAL:
+        case AST_OBJECT_LITERAL: {
+            CodegenJsonLengths* lengths = gen->json_lengths;
+            long* known = lengths->capacity > 0 ? codegen_json_length_slot(lengths, node) : NULL;
+            if (known) return *known;
+            
+            // The unmeasured collections within node in preorder; measured in
+            // reverse, each finds its nested collections already remembered
+            int count = 0;
+            int capacity = 16;
+            ASTNode** pending = malloc(capacity * sizeof(ASTNode*));
+            pending[count++] = node;
+            for (int next = 0; next < count; next++) {
+                ASTNode* collection = pending[next];
+                ASTList* items = codegen_json_items(collection);
+                for (int i = 0; i < items->count; i++) {
+                    ASTNode* value = codegen_json_item_value(collection, items->nodes[i]);
+                    if (!codegen_is_json_collection(value) ||
+                        (lengths->capacity > 0 && codegen_json_length_slot(lengths, value))) {
+                        continue;
+                    }
+                    if (count >= capacity) {
+                        capacity *= 2;
+                        pending = realloc(pending, capacity * sizeof(ASTNode*));
+                    }
+                    pending[count++] = value;
+                }
+            }
+            
+            for (int i = count - 1; i >= 0; i--) {
+                codegen_json_length_add(lengths, pending[i], codegen_json_collection_length(gen, pending[i]));
+            }
+            free(pending);
+            return *codegen_json_length_slot(lengths, node);
         }
+        default:
+            return -1;
+    }
+}
+
+static void codegen_sink(void* context, const char* data, int length) {
+    codegen_write_raw(context, data, length);
+}
+
+static void codegen_write_json_scalar(CodeGenerator* gen, ASTNode* node) {
+    switch (node->type) {
+        case AST_STRING_LITERAL:
+            json_quote(node->string_literal.value, codegen_sink, gen);
+            break;
+        case AST_NUMBER_LITERAL:
+            codegen_write(gen, node->number_literal.value);
+            break;
+        case AST_IDENTIFIER:
+            codegen_write(gen, node->identifier.name);
+            break;
         default:
             break;
     }
 }
 
+typedef struct {
+    ASTNode* collection;
+    int next;               // Index of the next item to write
+} CodegenJsonFrame;
+
+// Only for literals codegen_json_length accepts. Collections are written
+// from an explicit stack of open ones, so nesting depth does not grow the
+// C stack.
+static void codegen_write_json(CodeGenerator* gen, ASTNode* node) {
+    if (!codegen_is_json_collection(node)) {
+        codegen_write_json_scalar(gen, node);
+        return;
+    }
+    
+    int count = 0;
+    int capacity = 16;
+    CodegenJsonFrame* frames = malloc(capacity * sizeof(CodegenJsonFrame));
+    frames[count++] = (CodegenJsonFrame){ node, 0 };
+    codegen_write(gen, node->type == AST_ARRAY_LITERAL ? "[" : "{");
+    
+    while (count > 0) {
+        CodegenJsonFrame* frame = &frames[count - 1];
+        ASTList* items = codegen_json_items(frame->collection);
+        if (frame->next == items->count) {
+            codegen_write(gen, frame->collection->type == AST_ARRAY_LITERAL ? "]" : "}");
+            count--;
+            continue;
+        }
+        
+        ASTNode* item = items->nodes[frame->next];
+        if (frame->next++ > 0) codegen_write(gen, ",");
+        if (frame->collection->type == AST_OBJECT_LITERAL) {
+            json_quote(item->property.key, codegen_sink, gen);
+            codegen_write(gen, ":");
+        }
+        
+        ASTNode* value = codegen_json_item_value(frame->collection, item);
+        if (!codegen_is_json_collection(value)) {
+            codegen_write_json_scalar(gen, value);
+            continue;
+        }
+        
+        if (count >= capacity) {
+            capacity *= 2;
+            frames = realloc(frames, capacity * sizeof(CodegenJsonFrame));
+        }
+        frames[count++] = (CodegenJsonFrame){ value, 0 };
+        codegen_write(gen, value->type == AST_ARRAY_LITERAL ? "[" : "{");
+    }
+    
+    free(frames);
+}
+
+static int codegen_is_identifier_name(const char* name) {
+    if (!isalpha((unsigned char)name[0]) && name[0] != '_' && name[0] != '$') return 0;
+    for (const char* p = name + 1; *p; p++) {
+        if (!codegen_is_identifier_char(*p)) return 0;
+    }
+    return 1;
+}
+
+static void codegen_generate_collection(CodeGenerator* gen, ASTNode* node) {
+    if (codegen_json_length(gen, node) >= CODEGEN_JSON_PARSE_MIN_LENGTH) {
+        // JSON.parse('...'): the JSON text, escaped for a single-quoted string
+        CodeGenerator* json = codegen_new();
+        codegen_write_json(json, node);
+        
+        codegen_write(gen, "JSON.parse('");
+        const char* run = json->buffer;
+        for (const char* p = json->buffer; *p; p++) {
+            if (*p != '\'' && *p != '\\') continue;
+            codegen_write_raw(gen, run, p - run);
+            codegen_write_raw(gen, "\\", 1);
+            run = p;
+        }
+        codegen_write_raw(gen, run, json->buffer + json->length - run);
+        codegen_write(gen, "')");
+        codegen_free(json);
+        return;
+    }
+    
+    if (node->type == AST_ARRAY_LITERAL) {
+        codegen_write(gen, "[");
+        for (int i = 0; i < node->array_literal.elements->count; i++) {
+            if (i > 0) codegen_write_punct(gen, ", ");
+            codegen_generate_expression(gen, node->array_literal.elements->nodes[i]);
+        }
+        codegen_write(gen, "]");
+        return;
+    }
+    
+    codegen_write_punct(gen, "{ ");
+    for (int i = 0; i < node->object_literal.properties->count; i++) {
+        ASTNode* property = node->object_literal.properties->nodes[i];
+        if (i > 0) codegen_write_punct(gen, ", ");
+        if (codegen_is_identifier_name(property->property.key)) {
+            codegen_write(gen, property->property.key);
+        } else {
+            codegen_write(gen, "\"");
+            codegen_write_escaped(gen, property->property.key);
+            codegen_write(gen, "\"");
+        }
+        codegen_write_punct(gen, ": ");
+        codegen_generate_expression(gen, property->property.value);
+    }
+    codegen_write_punct(gen, " }");
+}
+
+void codegen_generate_collection_literal(CodeGenerator* gen, ASTNode* node) {
+    if (gen->json_lengths) {
+        codegen_generate_collection(gen, node);
+        return;
+    }
+    
+    // The outermost literal holds the lengths for the ones nested in it
+    CodegenJsonLengths lengths = { NULL, NULL, 0, 0 };
+    gen->json_lengths = &lengths;
+    codegen_generate_collection(gen, node);
+    gen->json_lengths = NULL;
+    free(lengths.nodes);
+    free(lengths.lengths);
+}
+
 void codegen_generate_block(CodeGenerator* gen, ASTNode* node) {
     if (node->type != AST_BLOCK) return;
     
-    codegen_write(gen, "{\n");
+    codegen_write_punct(gen, "{\n");
     codegen_increase_indent(gen);
     
     for (int i = 0; i < node->block.statements->count; i++) {
         codegen_write_indent(gen);
         codegen_generate_expression(gen, node->block.statements->nodes[i]);
-        codegen_write(gen, ";\n");
+        codegen_write_punct(gen, ";\n");
     }
     
     codegen_decrease_indent(gen);
@@ -387,7 +2813,7 @@ void codegen_generate_type_annotation(CodeGenerator* gen, ASTNode* node) {
     if (node->type_annotation.generic_args && node->type_annotation.generic_args->count > 0) {
         codegen_write(gen, "<");
         for (int i = 0; i < node->type_annotation.generic_args->count; i++) {
-            if (i > 0) codegen_write(gen, ", ");
+            if (i > 0) codegen_write_punct(gen, ", ");
             codegen_generate_type_annotation(gen, node->type_annotation.generic_args->nodes[i]);
         }
         codegen_write(gen, ">");
@@ -399,15 +2825,19 @@ void codegen_generate_field_decl(CodeGenerator* gen, ASTNode* node) {
     
     codegen_write_indent(gen);
     codegen_write(gen, node->field_decl.name);
-    codegen_write(gen, ": ");
+    codegen_write_punct(gen, ": ");
     codegen_generate_type_annotation(gen, node->field_decl.type_annotation);
-    codegen_write(gen, ";\n");
+    codegen_write_punct(gen, ";\n");
 }
 
 void codegen_generate_method_decl(CodeGenerator* gen, ASTNode* node) {
     if (node->type != AST_METHOD_DECL) return;
     
+    int async = codegen_contains_await(gen, node->method_decl.body);
     codegen_write_indent(gen);
+    if (async) {
+        codegen_write(gen, "async ");
+    }
     codegen_write(gen, node->method_decl.name);
     codegen_write(gen, "(");
     
@@ -417,12 +2847,12 @@ void codegen_generate_method_decl(CodeGenerator* gen, ASTNode* node) {
     
     codegen_write(gen, ")");
     
-    if (node->method_decl.return_type) {
-        codegen_write(gen, ": ");
-        codegen_generate_type_annotation(gen, node->method_decl.return_type);
+    if (node->method_decl.return_type && !gen->options.emit_js) {
+        codegen_write_punct(gen, ": ");
+        codegen_generate_return_type(gen, node->method_decl.return_type, async);
     }
     
-    codegen_write(gen, " ");
+    codegen_write_punct(gen, " ");
     
     if (node->method_decl.body) {
         codegen_generate_block(gen, node->method_decl.body);
@@ -430,27 +2860,33 @@ void codegen_generate_method_decl(CodeGenerator* gen, ASTNode* node) {
         codegen_write(gen, "{}");
     }
     
-    codegen_write(gen, "\n");
+    codegen_write_punct(gen, "\n");
 }
 
 void codegen_generate_call_expr(CodeGenerator* gen, ASTNode* node) {
     if (node->type != AST_CALL_EXPR) return;
     
     // Generate the function name/expression
-    codegen_generate_expression(gen, node->call_expr.function);
+    ASTNode* impl = NULL;
+    ASTNode* method = codegen_resolve_static_method(gen, node->call_expr.function, &impl);
+    if (method) {
+        codegen_write_dispatch_name(gen, impl, method);
+    } else {
+        codegen_generate_expression(gen, node->call_expr.function);
+    }
     
     // Generate the argument list
     codegen_write(gen, "(");
     if (node->call_expr.args && node->call_expr.args->count > 0) {
         for (int i = 0; i < node->call_expr.args->count; i++) {
-            if (i > 0) codegen_write(gen, ", ");
+            if (i > 0) codegen_write_punct(gen, ", ");
             codegen_generate_expression(gen, node->call_expr.args->nodes[i]);
         }
     }
     codegen_write(gen, ")");
 }
 
-void codegen_generate_expression(CodeGenerator* gen, ASTNode* node) {
+static void codegen_generate_expression_node(CodeGenerator* gen, ASTNode* node) {
     switch (node->type) {
         case AST_IDENTIFIER:
             codegen_generate_identifier(gen, node);
@@ -463,6 +2899,21 @@ void codegen_generate_expression(CodeGenerator* gen, ASTNode* node) {
         case AST_PIPE_EXPR:
             codegen_generate_pipe_expr(gen, node);
             break;
+        case AST_LAZY_PIPE_EXPR:
+            codegen_generate_lazy_pipe_expr(gen, node);
+            break;
+        case AST_ARRAY_LITERAL:
+        case AST_OBJECT_LITERAL:
+            codegen_generate_collection_literal(gen, node);
+            break;
+        case AST_AWAIT_EXPR:
+            codegen_write(gen, "await ");
+            codegen_generate_expression(gen, node->await_expr.argument);
+            break;
+        case AST_LAZY_EXPR:
+            // A lazy let that lazy_mark left eager
+            codegen_generate_expression(gen, node->lazy_expr.value);
+            break;
         case AST_MATCH_EXPR:
             codegen_generate_match_expr(gen, node);
             break;
@@ -472,6 +2923,31 @@ void codegen_generate_expression(CodeGenerator* gen, ASTNode* node) {
         case AST_CALL_EXPR:
             codegen_generate_call_expr(gen, node);
             break;
+        case AST_FUNCTION_DECL:
+            codegen_generate_lambda(gen, node);
+            break;
+        case AST_MEMBER_ACCESS: {
+            // Also left-nested: find the base object, then write members outward
+            int depth = 0;
+            for (ASTNode* access = node; access->type == AST_MEMBER_ACCESS; access = access->member_access.object) {
+                depth++;
+            }
+            
+            ASTNode** accesses = malloc(depth * sizeof(ASTNode*));
+            ASTNode* object = node;
+            for (int i = 0; i < depth; i++, object = object->member_access.object) {
+                accesses[i] = object;
+            }
+            
+            codegen_generate_expression(gen, object);
+            for (int i = depth - 1; i >= 0; i--) {
+                codegen_write(gen, ".");
+                codegen_write(gen, accesses[i]->member_access.member);
+            }
+            
+            free(accesses);
+            break;
+        }
         default:
             break;
     }
@@ -482,7 +2958,7 @@ void codegen_generate_generic_params(CodeGenerator* gen, ASTList* params) {
     
     codegen_write(gen, "<");
     for (int i = 0; i < params->count; i++) {
-        if (i > 0) codegen_write(gen, ", ");
+        if (i > 0) codegen_write_punct(gen, ", ");
         codegen_write(gen, params->nodes[i]->identifier.name);
     }
     codegen_write(gen, ">");
@@ -492,64 +2968,62 @@ void codegen_generate_parameter_list(CodeGenerator* gen, ASTList* params) {
     if (!params) return;
     
     for (int i = 0; i < params->count; i++) {
-        if (i > 0) codegen_write(gen, ", ");
+        if (i > 0) codegen_write_punct(gen, ", ");
         
         ASTNode* param = params->nodes[i];
         codegen_write(gen, param->param_decl.name);
         
-        if (param->param_decl.type_annotation) {
-            codegen_write(gen, ": ");
+        if (param->param_decl.type_annotation && !gen->options.emit_js) {
+            codegen_write_punct(gen, ": ");
             codegen_generate_type_annotation(gen, param->param_decl.type_annotation);
         }
     }
 }
 
-char* codegen_escape_string(const char* str) {
-    if (!str) return NULL;
+// Write str as the body of a double-quoted string literal. Runs of characters
+// that need no escaping are copied in one go.
+void codegen_write_escaped(CodeGenerator* gen, const char* str) {
+    static const char hex[] = "0123456789abcdef";
+    if (!str) return;
     
-    int len = strlen(str);
-    char* escaped = malloc(len * 2 + 1); // Worst case: every char is escaped
-    int j = 0;
-    
-    for (int i = 0; i < len; i++) {
-        switch (str[i]) {
-            case '"':
-                escaped[j++] = '\\';
-                escaped[j++] = '"';
-                break;
-            case '\\':
-                escaped[j++] = '\\';
-                escaped[j++] = '\\';
-                break;
-            case '\n':
-                escaped[j++] = '\\';
-                escaped[j++] = 'n';
-                break;
-            case '\t':
-                escaped[j++] = '\\';
-                escaped[j++] = 't';
-                break;
-            case '\r':
-                escaped[j++] = '\\';
-                escaped[j++] = 'r';
+    const char* run = str;
+    const unsigned char* p = (const unsigned char*)str;
+    for (; *p; p++) {
+        unsigned char c = *p;
+        if (c >= 0x20 && c != '"' && c != '\\' && c != 0x7F && c != 0xE2) continue;
+        
+        // Other UTF-8 passes through; U+2028 and U+2029 end a line in older engines
+        if (c == 0xE2 && !(p[1] == 0x80 && (p[2] == 0xA8 || p[2] == 0xA9))) continue;
+        
+        codegen_write_raw(gen, run, (const char*)p - run);
+        switch (c) {
+            case '"':  codegen_write_raw(gen, "\\\"", 2); break;
+            case '\\': codegen_write_raw(gen, "\\\\", 2); break;
+            case '\n': codegen_write_raw(gen, "\\n", 2); break;
+            case '\t': codegen_write_raw(gen, "\\t", 2); break;
+            case '\r': codegen_write_raw(gen, "\\r", 2); break;
+            case '\b': codegen_write_raw(gen, "\\b", 2); break;
+            case '\f': codegen_write_raw(gen, "\\f", 2); break;
+            case 0xE2:
+                codegen_write_raw(gen, p[2] == 0xA8 ? "\\u2028" : "\\u2029", 6);
+                p += 2;
                 break;
-            default:
-                escaped[j++] = str[i];
+            default: {
+                char escape[4] = { '\\', 'x', hex[c >> 4], hex[c & 0xF] };
+                codegen_write_raw(gen, escape, 4);
                 break;
+            }
         }
+        run = (const char*)p + 1;
     }
-    
-    escaped[j] = '\0';
-    return escaped;
+    codegen_write_raw(gen, run, (const char*)p - run);
 }
 
-char* codegen_atom_to_symbol(const char* atom) {
-    if (!atom || atom[0] != ':') return NULL;
-    
-    int len = strlen(atom);
-    char* symbol = malloc(len + 20); // Extra space for Symbol.for("...")
-    
-    sprintf(symbol, "Symbol.for(\"%s\")", atom + 1); // Skip the ':'
+// :name is emitted as Symbol.for("name")
+void codegen_write_atom(CodeGenerator* gen, const char* atom) {
+    if (!atom || atom[0] != ':') return;
     
-    return symbol;
+    codegen_write(gen, "Symbol.for(\"");
+    codegen_write_escaped(gen, atom + 1);
+    codegen_write(gen, "\")");
 }
\ No newline at end of file
@@ -2,15 +2,74 @@
 #define CODEGEN_H
 
 #include "ast.h"
+#include "profile.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// Pipe tracing keeps the last CAPACITY timings (a power of two) and times one
+// stage call in SAMPLE_RATE
+#define CODEGEN_PIPE_TRACE_CAPACITY 4096
+#define CODEGEN_PIPE_SAMPLE_RATE 64
+
+// Deeper code is indented no further
+#define CODEGEN_MAX_INDENT 64
+
+// Constant array and object literals with at least this much JSON text are
+// emitted as JSON.parse('...'), which engines parse faster than literal source
+#define CODEGEN_JSON_PARSE_MIN_LENGTH 10240
+
+typedef struct {
+    int emit_js;            // Emit plain JavaScript: no types, interfaces or annotations
+    int minify;             // No insignificant whitespace, short compiler temporaries
+    int struct_factories;   // Emit a shape-stable factory function for every struct
+    int static_dispatch;    // Emit trait methods as top-level functions and call them directly
+    int threads;            // Worker threads for large programs (<= 1: generate serially)
+    const char* instrument; // Count match arm hits and write them to this file at exit
+    int trace_pipes;        // Time sampled pipe stage calls into the shared pipe trace ring
+    const char* source_file;    // Reported as the file of traced pipe stages
+} CodegenOptions;
+
+// Trait methods by impl object name (type then trait name, interned) and
+// method name, for static dispatch; open addressing on the two pointers
+typedef struct {
+    const char* object;
+    const char* method;
+    ASTNode* impl;
+    ASTNode* decl;
+} CodegenDispatchEntry;
+
+typedef struct {
+    CodegenDispatchEntry* entries;
+    int count;
+    int capacity;
+} CodegenDispatchIndex;
+
+// JSON lengths of the collection literals measured while generating the
+// outermost one, by node, so nested literals are measured once
+typedef struct {
+    ASTNode** nodes;
+    long* lengths;
+    int count;
+    int capacity;
+} CodegenJsonLengths;
+
 typedef struct {
     char* buffer;
     int capacity;
     int length;
     int indent_level;
+    int depth;              // Nesting of the expression being generated
+    CodegenOptions options;
+    CodegenDispatchIndex* dispatch;     // Trait methods of the program, with static dispatch
+    const ProfileSites* profile_arms;   // Counter slots of an instrumented program
+    const ProfileSites* pipe_sites;     // Trace sites of pipe stages
+    ASTNode* tail_function; // Looping lambda whose tail the arms of the match being generated are in
+    int awaits;             // The program has await expressions
+    int map_async;          // mapAsync(...) stages use the runtime helper: the program does not bind the name
+    int exporting;          // Generating an exported declaration
+    int match_labels;       // Labels taken by the decision trees being generated
+    CodegenJsonLengths* json_lengths;   // While generating a collection literal
 } CodeGenerator;
 
 // Code generator creation and cleanup
@@ -19,36 +78,45 @@ void codegen_free(CodeGenerator* codegen);
 
 // Main code generation function
 char* codegen_generate(ASTNode* ast);
+char* codegen_generate_with_options(ASTNode* ast, const CodegenOptions* options);
+char* codegen_generate_declaration_file(ASTNode* ast, const CodegenOptions* options);
 
 // Internal functions
 void codegen_write(CodeGenerator* gen, const char* str);
+void codegen_write_punct(CodeGenerator* gen, const char* str);
 void codegen_write_line(CodeGenerator* gen, const char* str);
 void codegen_write_indent(CodeGenerator* gen);
 void codegen_increase_indent(CodeGenerator* gen);
 void codegen_decrease_indent(CodeGenerator* gen);
+const char* codegen_temp_name(CodeGenerator* gen, const char* name, const char* short_name);
 
 // AST node generation functions
 void codegen_generate_program(CodeGenerator* gen, ASTNode* node);
+void codegen_generate_declaration(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_struct_decl(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_trait_decl(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_impl_block(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_let_binding(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_match_expr(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_pipe_expr(CodeGenerator* gen, ASTNode* node);
+void codegen_generate_lazy_pipe_expr(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_identifier(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_literal(CodeGenerator* gen, ASTNode* node);
+void codegen_generate_collection_literal(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_block(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_type_annotation(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_field_decl(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_method_decl(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_match_arm(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_call_expr(CodeGenerator* gen, ASTNode* node);
+void codegen_generate_lambda(CodeGenerator* gen, ASTNode* node);
 void codegen_generate_expression(CodeGenerator* gen, ASTNode* node);
 
 // Helper functions
 void codegen_generate_generic_params(CodeGenerator* gen, ASTList* params);
 void codegen_generate_parameter_list(CodeGenerator* gen, ASTList* params);
-char* codegen_escape_string(const char* str);
-char* codegen_atom_to_symbol(const char* atom);
+void codegen_write_escaped(CodeGenerator* gen, const char* str);
+void codegen_write_atom(CodeGenerator* gen, const char* atom);
+int codegen_is_builtin_method(const char* name);
 
 #endif
\ No newline at end of file
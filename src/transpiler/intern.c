@@ -0,0 +1,157 @@
+#include "intern.h"
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define INTERN_CHUNK_SIZE (64 * 1024)
+
+const char intern_underscore[] = "_";
+const char intern_length[] = "length";
+const char intern_trim[] = "trim";
+const char intern_to_upper_case[] = "toUpperCase";
+const char intern_to_lower_case[] = "toLowerCase";
+const char intern_map_async[] = "mapAsync";
+
+static const char* const intern_well_known[] = {
+    intern_underscore,
+    intern_length,
+    intern_trim,
+    intern_to_upper_case,
+    intern_to_lower_case,
+    intern_map_async,
+    NULL
+};
+
+typedef struct InternChunk {
+    struct InternChunk* next;
+    size_t used;
+    size_t size;
+    char data[];
+} InternChunk;
+
+typedef struct {
+    pthread_mutex_t lock;
+    const char** strings;   // Open-addressing table of canonical copies
+    uint32_t* hashes;
+    int count;
+    int capacity;
+    InternChunk* chunks;    // Arena; the head chunk is the one being filled
+} InternStripe;
+
+static InternStripe intern_stripes[INTERN_STRIPES];
+static pthread_once_t intern_once = PTHREAD_ONCE_INIT;
+
+static uint32_t intern_hash(const char* str, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)str[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static char* intern_alloc(InternStripe* stripe, size_t size) {
+    InternChunk* chunk = stripe->chunks;
+    if (!chunk || chunk->used + size > chunk->size) {
+        // Oversized strings get a chunk of their own behind the current one
+        size_t chunk_size = size > INTERN_CHUNK_SIZE / 4 ? size : INTERN_CHUNK_SIZE;
+        InternChunk* fresh = malloc(sizeof(InternChunk) + chunk_size);
+        fresh->used = 0;
+        fresh->size = chunk_size;
+
+        if (chunk && chunk_size != INTERN_CHUNK_SIZE) {
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        } else {
+            fresh->next = chunk;
+            stripe->chunks = fresh;
+        }
+        chunk = fresh;
+    }
+
+    char* data = chunk->data + chunk->used;
+    chunk->used += size;
+    return data;
+}
+
+static void intern_grow(InternStripe* stripe) {
+    int capacity = stripe->capacity ? stripe->capacity * 2 : 256;
+    const char** strings = calloc(capacity, sizeof(char*));
+    uint32_t* hashes = malloc(capacity * sizeof(uint32_t));
+
+    for (int i = 0; i < stripe->capacity; i++) {
+        if (!stripe->strings[i]) continue;
+
+        uint32_t slot = stripe->hashes[i] & (capacity - 1);
+        while (strings[slot]) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        strings[slot] = stripe->strings[i];
+        hashes[slot] = stripe->hashes[i];
+    }
+
+    free(stripe->strings);
+    free(stripe->hashes);
+    stripe->strings = strings;
+    stripe->hashes = hashes;
+    stripe->capacity = capacity;
+}
+
+// Look up str[0, length), adding it if absent; with copy == 0 str itself is stored
+static const char* intern_insert(const char* str, int length, int copy) {
+    // Stripes are picked by the high bits of the hash, slots by the low bits
+    uint32_t hash = intern_hash(str, length);
+    InternStripe* stripe = &intern_stripes[(hash >> 24) % INTERN_STRIPES];
+
+    pthread_mutex_lock(&stripe->lock);
+
+    if ((stripe->count + 1) * 4 > stripe->capacity * 3) {
+        intern_grow(stripe);
+    }
+
+    uint32_t slot = hash & (stripe->capacity - 1);
+    while (stripe->strings[slot]) {
+        const char* existing = stripe->strings[slot];
+        if (stripe->hashes[slot] == hash && strncmp(existing, str, length) == 0 && existing[length] == '\0') {
+            pthread_mutex_unlock(&stripe->lock);
+            return existing;
+        }
+        slot = (slot + 1) & (stripe->capacity - 1);
+    }
+
+    const char* result = str;
+    if (copy) {
+        char* data = intern_alloc(stripe, length + 1);
+        memcpy(data, str, length);
+        data[length] = '\0';
+        result = data;
+    }
+
+    stripe->strings[slot] = result;
+    stripe->hashes[slot] = hash;
+    stripe->count++;
+
+    pthread_mutex_unlock(&stripe->lock);
+    return result;
+}
+
+static void intern_init(void) {
+    for (int i = 0; i < INTERN_STRIPES; i++) {
+        pthread_mutex_init(&intern_stripes[i].lock, NULL);
+    }
+
+    // The well-known names are their own canonical copies
+    for (int i = 0; intern_well_known[i]; i++) {
+        intern_insert(intern_well_known[i], strlen(intern_well_known[i]), 0);
+    }
+}
+
+const char* intern_range(const char* str, int length) {
+    pthread_once(&intern_once, intern_init);
+    return intern_insert(str, length, 1);
+}
+
+const char* intern(const char* str) {
+    return intern_range(str, strlen(str));
+}
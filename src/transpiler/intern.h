@@ -0,0 +1,26 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+// Process-wide string interning
+//
+// Every distinct string is stored once, in arenas that live until the process
+// exits, so two interned strings are equal exactly when their pointers are.
+// The table is split into stripes, each with its own lock, hash table and
+// arena, so lexers running on several threads rarely contend.
+
+#define INTERN_STRIPES 16
+
+// Returns the canonical copy of str; never NULL
+const char* intern(const char* str);
+const char* intern_range(const char* str, int length);
+
+// Well-known names, interned before any other string so codegen and
+// dead code elimination can compare against them by pointer
+extern const char intern_underscore[];
+extern const char intern_length[];
+extern const char intern_trim[];
+extern const char intern_to_upper_case[];
+extern const char intern_to_lower_case[];
+extern const char intern_map_async[];
+
+#endif
@@ -0,0 +1,281 @@
+#include "json.h"
+#include "lexer.h"
+
+JsonWriter* json_writer_new(FILE* out) {
+    JsonWriter* writer = malloc(sizeof(JsonWriter));
+    writer->out = out;
+    writer->length = 0;
+    writer->needs_comma = 0;
+    return writer;
+}
+
+void json_writer_free(JsonWriter* writer) {
+    if (writer) {
+        json_flush(writer);
+        free(writer);
+    }
+}
+
+void json_flush(JsonWriter* writer) {
+    if (writer->length > 0) {
+        fwrite(writer->buffer, 1, writer->length, writer->out);
+        writer->length = 0;
+    }
+}
+
+static void json_write_raw(JsonWriter* writer, const char* data, int length) {
+    while (length > 0) {
+        if (writer->length == JSON_BUFFER_SIZE) {
+            json_flush(writer);
+        }
+
+        int chunk = JSON_BUFFER_SIZE - writer->length;
+        if (chunk > length) chunk = length;
+
+        memcpy(writer->buffer + writer->length, data, chunk);
+        writer->length += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+static void json_write_char(JsonWriter* writer, char c) {
+    if (writer->length == JSON_BUFFER_SIZE) {
+        json_flush(writer);
+    }
+    writer->buffer[writer->length++] = c;
+}
+
+// Separate a new value from the previous one at the same level
+static void json_begin_value(JsonWriter* writer) {
+    if (writer->needs_comma) {
+        json_write_char(writer, ',');
+    }
+}
+
+void json_begin_object(JsonWriter* writer) {
+    json_begin_value(writer);
+    json_write_char(writer, '{');
+    writer->needs_comma = 0;
+}
+
+void json_end_object(JsonWriter* writer) {
+    json_write_char(writer, '}');
+    writer->needs_comma = 1;
+}
+
+void json_begin_array(JsonWriter* writer) {
+    json_begin_value(writer);
+    json_write_char(writer, '[');
+    writer->needs_comma = 0;
+}
+
+void json_end_array(JsonWriter* writer) {
+    json_write_char(writer, ']');
+    writer->needs_comma = 1;
+}
+
+void json_quote(const char* str, JsonSink sink, void* context) {
+    static const char hex[] = "0123456789abcdef";
+
+    sink(context, "\"", 1);
+
+    // Pass runs of plain characters on in one go
+    const char* run = str;
+    const char* p = str;
+    for (; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        int separator = c == 0xE2 && (unsigned char)p[1] == 0x80 &&
+                        ((unsigned char)p[2] == 0xA8 || (unsigned char)p[2] == 0xA9);
+        if (c >= 0x20 && c != '"' && c != '\\' && !separator) continue;
+
+        sink(context, run, p - run);
+
+        switch (c) {
+            case '"':  sink(context, "\\\"", 2); break;
+            case '\\': sink(context, "\\\\", 2); break;
+            case '\n': sink(context, "\\n", 2); break;
+            case '\r': sink(context, "\\r", 2); break;
+            case '\t': sink(context, "\\t", 2); break;
+            default:
+                if (separator) {
+                    sink(context, (unsigned char)p[2] == 0xA8 ? "\\u2028" : "\\u2029", 6);
+                    p += 2;
+                } else {
+                    char escape[6] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+                    sink(context, escape, 6);
+                }
+                break;
+        }
+        run = p + 1;
+    }
+    sink(context, run, p - run);
+
+    sink(context, "\"", 1);
+}
+
+static void json_writer_sink(void* context, const char* data, int length) {
+    json_write_raw(context, data, length);
+}
+
+static void json_write_quoted(JsonWriter* writer, const char* str) {
+    json_quote(str, json_writer_sink, writer);
+}
+
+void json_key(JsonWriter* writer, const char* key) {
+    json_begin_value(writer);
+    json_write_quoted(writer, key);
+    json_write_char(writer, ':');
+    writer->needs_comma = 0;
+}
+
+void json_string(JsonWriter* writer, const char* value) {
+    if (!value) {
+        json_null(writer);
+        return;
+    }
+
+    json_begin_value(writer);
+    json_write_quoted(writer, value);
+    writer->needs_comma = 1;
+}
+
+void json_int(JsonWriter* writer, long value) {
+    char digits[32];
+    int length = snprintf(digits, sizeof(digits), "%ld", value);
+
+    json_begin_value(writer);
+    json_write_raw(writer, digits, length);
+    writer->needs_comma = 1;
+}
+
+void json_bool(JsonWriter* writer, int value) {
+    json_begin_value(writer);
+    if (value) {
+        json_write_raw(writer, "true", 4);
+    } else {
+        json_write_raw(writer, "false", 5);
+    }
+    writer->needs_comma = 1;
+}
+
+void json_null(JsonWriter* writer) {
+    json_begin_value(writer);
+    json_write_raw(writer, "null", 4);
+    writer->needs_comma = 1;
+}
+
+// One object per token, in source order, ending with EOF
+void json_write_tokens(JsonWriter* writer, const char* source) {
+    Lexer* lexer = lexer_new(source);
+    Token token;
+
+    json_begin_array(writer);
+    do {
+        token = lexer_next_token(lexer);
+
+        json_begin_object(writer);
+        json_key(writer, "type");
+        json_string(writer, token_type_to_string(token.type));
+        json_key(writer, "value");
+        json_string(writer, token.value);
+        json_key(writer, "line");
+        json_int(writer, token.line);
+        json_key(writer, "column");
+        json_int(writer, token.column);
+        json_end_object(writer);
+
+        token_free(&token);
+    } while (token.type != TOKEN_EOF);
+    json_end_array(writer);
+
+    lexer_free(lexer);
+}
+
+// Explicit work stack, one frame per open node, so deep pipe chains cannot exhaust the C stack
+typedef struct {
+    ASTNode* node;
+    ASTField fields[AST_MAX_FIELDS];
+    int field_count;
+    int field;              // Next field to write
+    int item;               // Next list item of the current field, -1 before the list is opened
+} JsonAstFrame;
+
+// Write a node's header and open its frame, or write null for an absent node
+static void json_open_node(JsonWriter* writer, JsonAstFrame** stack, int* count, int* capacity, ASTNode* node) {
+    if (!node) {
+        json_null(writer);
+        return;
+    }
+
+    json_begin_object(writer);
+    json_key(writer, "type");
+    json_string(writer, ast_node_type_to_string(node->type));
+    json_key(writer, "line");
+    json_int(writer, node->line);
+    json_key(writer, "column");
+    json_int(writer, node->column);
+
+    if (*count >= *capacity) {
+        *capacity *= 2;
+        *stack = realloc(*stack, *capacity * sizeof(JsonAstFrame));
+    }
+
+    JsonAstFrame* frame = &(*stack)[(*count)++];
+    frame->node = node;
+    frame->field_count = ast_node_fields(node, frame->fields);
+    frame->field = 0;
+    frame->item = -1;
+}
+
+// {"type": ..., "line": ..., "column": ..., <every field of the node>}
+void json_write_ast(JsonWriter* writer, ASTNode* node) {
+    int capacity = 64;
+    int count = 0;
+    JsonAstFrame* stack = malloc(capacity * sizeof(JsonAstFrame));
+    json_open_node(writer, &stack, &count, &capacity, node);
+
+    while (count > 0) {
+        JsonAstFrame* frame = &stack[count - 1];
+
+        if (frame->field >= frame->field_count) {
+            json_end_object(writer);
+            count--;
+            continue;
+        }
+
+        ASTField* field = &frame->fields[frame->field];
+        if (field->string) {
+            json_key(writer, field->name);
+            json_string(writer, *field->string);
+            frame->field++;
+        } else if (field->node) {
+            json_key(writer, field->name);
+            frame->field++;
+            json_open_node(writer, &stack, &count, &capacity, *field->node);
+        } else {
+            ASTList* list = *field->list;
+            if (frame->item < 0) {
+                json_key(writer, field->name);
+                if (!list) {
+                    json_null(writer);
+                    frame->field++;
+                    continue;
+                }
+                json_begin_array(writer);
+                frame->item = 0;
+            }
+
+            if (frame->item < list->count) {
+                ASTNode* item = list->nodes[frame->item++];
+                json_open_node(writer, &stack, &count, &capacity, item);
+            } else {
+                json_end_array(writer);
+                frame->item = -1;
+                frame->field++;
+            }
+        }
+    }
+
+    free(stack);
+}
@@ -0,0 +1,45 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include "ast.h"
+#include <stdio.h>
+
+#define JSON_BUFFER_SIZE (64 * 1024)
+
+// Streaming JSON writer: output is buffered and flushed in large writes,
+// so documents of any size are produced in constant memory
+typedef struct {
+    FILE* out;
+    char buffer[JSON_BUFFER_SIZE];
+    int length;
+    int needs_comma;        // A value was just completed at the current nesting level
+} JsonWriter;
+
+// Writer creation and cleanup (free flushes)
+JsonWriter* json_writer_new(FILE* out);
+void json_writer_free(JsonWriter* writer);
+void json_flush(JsonWriter* writer);
+
+// Structure
+void json_begin_object(JsonWriter* writer);
+void json_end_object(JsonWriter* writer);
+void json_begin_array(JsonWriter* writer);
+void json_end_array(JsonWriter* writer);
+void json_key(JsonWriter* writer, const char* key);
+
+// Values
+void json_string(JsonWriter* writer, const char* value);
+void json_int(JsonWriter* writer, long value);
+void json_bool(JsonWriter* writer, int value);
+void json_null(JsonWriter* writer);
+
+// str as a quoted JSON string, passed to sink in runs. U+2028 and U+2029 are
+// escaped too, so the text can also be embedded in JavaScript source.
+typedef void (*JsonSink)(void* context, const char* data, int length);
+void json_quote(const char* str, JsonSink sink, void* context);
+
+// Zenoscript structures
+void json_write_tokens(JsonWriter* writer, const char* source);
+void json_write_ast(JsonWriter* writer, ASTNode* node);
+
+#endif
@@ -0,0 +1,186 @@
+#include "lazy.h"
+#include "intern.h"
+#include <stdint.h>
+
+typedef struct {
+    const char* name;
+    ASTNode* let;
+    int rebound;            // Also bound somewhere else, so reads may not mean this let
+} LazyBinding;
+
+// Lazy top-level lets by name, open addressing on the interned pointer
+typedef struct {
+    LazyBinding* bindings;
+    int capacity;
+} LazyScope;
+
+static LazyBinding* lazy_scope_find(LazyScope* scope, const char* name) {
+    if (scope->capacity == 0) return NULL;
+
+    uintptr_t slot = ((uintptr_t)name >> 3) & (scope->capacity - 1);
+    while (scope->bindings[slot].name) {
+        if (scope->bindings[slot].name == name) {
+            return &scope->bindings[slot];
+        }
+        slot = (slot + 1) & (scope->capacity - 1);
+    }
+    return NULL;
+}
+
+static void lazy_mark_rebound(LazyScope* scope, const char* name) {
+    LazyBinding* binding = name ? lazy_scope_find(scope, name) : NULL;
+    if (binding) {
+        binding->rebound = 1;
+    }
+}
+
+static void lazy_mark_pattern_rebound(LazyScope* scope, ASTNode* pattern) {
+    if (!pattern) return;
+
+    switch (pattern->type) {
+        case AST_IDENTIFIER:
+            if (pattern->identifier.name != intern_underscore) {
+                lazy_mark_rebound(scope, pattern->identifier.name);
+            }
+            break;
+        case AST_ARRAY_PATTERN:
+            for (int i = 0; i < pattern->array_pattern.elements->count; i++) {
+                lazy_mark_pattern_rebound(scope, pattern->array_pattern.elements->nodes[i]);
+            }
+            lazy_mark_rebound(scope, pattern->array_pattern.rest);
+            break;
+        case AST_OBJECT_PATTERN:
+            for (int i = 0; i < pattern->object_pattern.fields->count; i++) {
+                lazy_mark_pattern_rebound(scope, pattern->object_pattern.fields->nodes[i]->field_pattern.pattern);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void lazy_find_rebound(ASTNode* node, void* context) {
+    LazyScope* scope = context;
+
+    switch (node->type) {
+        case AST_PARAM_DECL:
+            lazy_mark_rebound(scope, node->param_decl.name);
+            break;
+        case AST_ASSIGNMENT:
+            lazy_mark_rebound(scope, node->assignment.target);
+            break;
+        case AST_MATCH_ARM:
+            lazy_mark_pattern_rebound(scope, node->match_arm.pattern);
+            break;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statements->count; i++) {
+                ASTNode* statement = node->block.statements->nodes[i];
+                if (statement && statement->type == AST_LET_BINDING) {
+                    lazy_mark_rebound(scope, statement->let_binding.name);
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static void lazy_find_await(ASTNode* node, void* context) {
+    if (node->type == AST_AWAIT_EXPR) {
+        *(int*)context = 1;
+    }
+}
+
+static void lazy_mark_reads(ASTNode* node, void* context) {
+    if (node->type != AST_IDENTIFIER) return;
+
+    LazyBinding* binding = lazy_scope_find(context, node->identifier.name);
+    node->identifier.lazy = binding && binding->let->let_binding.value->lazy_expr.deferred;
+}
+
+int lazy_mark(ASTNode* program) {
+    ASTList* declarations = program->program.declarations;
+
+    int count = 0;
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* decl = ast_unwrap_export(declarations->nodes[i]);
+        if (decl->type != AST_LET_BINDING || !decl->let_binding.value ||
+            decl->let_binding.value->type != AST_LAZY_EXPR) {
+            continue;
+        }
+
+        decl->let_binding.value->lazy_expr.deferred = 0;
+        if (decl != declarations->nodes[i]) {
+            // Importing modules would read the accessor, not the value
+            fprintf(stderr, "Warning: lazy let '%s' at line %d is exported, evaluating it eagerly\n",
+                    decl->let_binding.name, decl->line);
+            continue;
+        }
+        count++;
+    }
+    if (count == 0) return 0;
+
+    LazyScope scope = { NULL, 16 };
+    while (scope.capacity < count * 2) {
+        scope.capacity *= 2;
+    }
+    scope.bindings = calloc(scope.capacity, sizeof(LazyBinding));
+
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* decl = declarations->nodes[i];
+        if (decl->type != AST_LET_BINDING || !decl->let_binding.value ||
+            decl->let_binding.value->type != AST_LAZY_EXPR ||
+            lazy_scope_find(&scope, decl->let_binding.name)) {
+            continue;
+        }
+
+        uintptr_t slot = ((uintptr_t)decl->let_binding.name >> 3) & (scope.capacity - 1);
+        while (scope.bindings[slot].name) {
+            slot = (slot + 1) & (scope.capacity - 1);
+        }
+        scope.bindings[slot].name = decl->let_binding.name;
+        scope.bindings[slot].let = decl;
+    }
+
+    // Declared twice, lazily or not
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* decl = ast_unwrap_export(declarations->nodes[i]);
+        if (decl->type != AST_LET_BINDING) continue;
+
+        LazyBinding* binding = lazy_scope_find(&scope, decl->let_binding.name);
+        if (binding && binding->let != decl) {
+            binding->rebound = 1;
+        }
+    }
+
+    ast_walk(program, lazy_find_rebound, &scope);
+
+    int deferred = 0;
+    // In program order, so warnings are too
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* let = declarations->nodes[i];
+        if (let->type != AST_LET_BINDING) continue;
+
+        LazyBinding* binding = lazy_scope_find(&scope, let->let_binding.name);
+        if (!binding || binding->let != let) continue;
+
+        int awaits = 0;
+        ast_walk(let->let_binding.value, lazy_find_await, &awaits);
+
+        if (binding->rebound) {
+            fprintf(stderr, "Warning: lazy let '%s' at line %d is bound again elsewhere, evaluating it eagerly\n",
+                    binding->name, let->line);
+        } else if (awaits) {
+            fprintf(stderr, "Warning: lazy let '%s' at line %d awaits, evaluating it eagerly\n",
+                    binding->name, let->line);
+        } else {
+            let->let_binding.value->lazy_expr.deferred = 1;
+            deferred++;
+        }
+    }
+
+    ast_walk(program, lazy_mark_reads, &scope);
+
+    free(scope.bindings);
+    return deferred;
+}
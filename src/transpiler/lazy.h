@@ -0,0 +1,20 @@
+#ifndef LAZY_H
+#define LAZY_H
+
+#include "ast.h"
+
+// Lazy top-level bindings
+//
+// `lazy let name = value` defers value until name is first read. Codegen
+// emits the binding as an accessor that evaluates value, replaces itself
+// with one returning the result, and returns it; every read of name becomes
+// a call. This pass marks the bindings that can be deferred
+// (lazy_expr.deferred) and the identifiers reading them (identifier.lazy).
+// A lazy let whose name is also bound by a parameter, pattern, nested let,
+// assignment or second top-level let, whose value awaits, or which is
+// exported, is evaluated eagerly instead and reported on stderr.
+
+// Returns the number of bindings deferred
+int lazy_mark(ASTNode* program);
+
+#endif
@@ -1,4 +1,5 @@
 #include "lexer.h"
+#include "intern.h"
 
 // Keyword mapping
 static struct {
@@ -13,6 +14,9 @@ static struct {
     {"match", TOKEN_MATCH},
     {"when", TOKEN_WHEN},
     {"return", TOKEN_RETURN},
+    {"await", TOKEN_AWAIT},
+    {"import", TOKEN_IMPORT},
+    {"export", TOKEN_EXPORT},
     {NULL, TOKEN_IDENTIFIER}
 };
 
@@ -26,6 +30,17 @@ Lexer* lexer_new(const char* source) {
     return lexer;
 }
 
+// Lex only source[start, end), reporting positions as if the whole source were lexed
+Lexer* lexer_new_range(const char* source, int start, int end, int line) {
+    Lexer* lexer = malloc(sizeof(Lexer));
+    lexer->source = source;
+    lexer->pos = start;
+    lexer->line = line;
+    lexer->column = 1;
+    lexer->length = end;
+    return lexer;
+}
+
 void lexer_free(Lexer* lexer) {
     if (lexer) {
         free(lexer);
@@ -34,7 +49,9 @@ void lexer_free(Lexer* lexer) {
 
 void token_free(Token* token) {
     if (token && token->value) {
-        free(token->value);
+        if (!token->interned) {
+            free(token->value);
+        }
         token->value = NULL;
     }
 }
@@ -75,10 +92,24 @@ static void lexer_skip_whitespace(Lexer* lexer) {
     }
 }
 
+// Takes ownership of value; used for number and string literals, which are rarely repeated
+static Token lexer_make_owned_token(TokenType type, char* value, int line, int column) {
+    Token token;
+    token.type = type;
+    token.value = value;
+    token.interned = 0;
+    token.line = line;
+    token.column = column;
+    token.length = value ? strlen(value) : 0;
+    return token;
+}
+
+// Identifiers, keywords, atoms and punctuation share interned values
 static Token lexer_make_token(TokenType type, const char* value, int line, int column) {
     Token token;
     token.type = type;
-    token.value = value ? strdup(value) : NULL;
+    token.value = value ? (char*)intern(value) : NULL;
+    token.interned = value != NULL;
     token.line = line;
     token.column = column;
     token.length = value ? strlen(value) : 0;
@@ -95,21 +126,24 @@ static Token lexer_read_identifier(Lexer* lexer) {
     }
     
     int length = lexer->pos - start_pos;
-    char* value = malloc(length + 1);
-    strncpy(value, lexer->source + start_pos, length);
-    value[length] = '\0';
+    char* value = (char*)intern_range(lexer->source + start_pos, length);
     
     // Check if it's a keyword
+    TokenType type = TOKEN_IDENTIFIER;
     for (int i = 0; keywords[i].keyword != NULL; i++) {
         if (strcmp(value, keywords[i].keyword) == 0) {
-            Token token = lexer_make_token(keywords[i].type, value, line, column);
-            free(value);
-            return token;
+            type = keywords[i].type;
+            break;
         }
     }
     
-    Token token = lexer_make_token(TOKEN_IDENTIFIER, value, line, column);
-    free(value);
+    Token token;
+    token.type = type;
+    token.value = value;
+    token.interned = 1;
+    token.line = line;
+    token.column = column;
+    token.length = length;
     return token;
 }
 
@@ -118,6 +152,9 @@ static Token lexer_read_number(Lexer* lexer) {
     int line = lexer->line;
     int column = lexer->column;
     
+    if (lexer_peek(lexer) == '-') {
+        lexer_advance(lexer);
+    }
     while (lexer_peek(lexer) && isdigit(lexer_peek(lexer))) {
         lexer_advance(lexer);
     }
@@ -135,9 +172,7 @@ static Token lexer_read_number(Lexer* lexer) {
     strncpy(value, lexer->source + start_pos, length);
     value[length] = '\0';
     
-    Token token = lexer_make_token(TOKEN_NUMBER, value, line, column);
-    free(value);
-    return token;
+    return lexer_make_owned_token(TOKEN_NUMBER, value, line, column);
 }
 
 static Token lexer_read_string(Lexer* lexer) {
@@ -183,9 +218,7 @@ static Token lexer_read_string(Lexer* lexer) {
     }
     
     value[length] = '\0';
-    Token token = lexer_make_token(TOKEN_STRING, value, line, column);
-    free(value);
-    return token;
+    return lexer_make_owned_token(TOKEN_STRING, value, line, column);
 }
 
 static Token lexer_read_atom(Lexer* lexer) {
@@ -203,14 +236,14 @@ static Token lexer_read_atom(Lexer* lexer) {
         lexer_advance(lexer);
     }
     
-    int length = lexer->pos - start_pos + 1; // +1 for the ':'
-    char* value = malloc(length + 1);
-    value[0] = ':';
-    strncpy(value + 1, lexer->source + start_pos, length - 1);
-    value[length] = '\0';
-    
-    Token token = lexer_make_token(TOKEN_ATOM, value, line, column);
-    free(value);
+    // The atom's value includes the ':' just before start_pos
+    Token token;
+    token.type = TOKEN_ATOM;
+    token.length = lexer->pos - start_pos + 1;
+    token.value = (char*)intern_range(lexer->source + start_pos - 1, token.length);
+    token.interned = 1;
+    token.line = line;
+    token.column = column;
     return token;
 }
 
@@ -271,6 +304,10 @@ Token lexer_next_token(Lexer* lexer) {
             lexer_advance(lexer);
             return lexer_make_token(TOKEN_COMMA, ",", line, column);
             
+        case '*':
+            lexer_advance(lexer);
+            return lexer_make_token(TOKEN_STAR, "*", line, column);
+            
         case '.':
             lexer_advance(lexer);
             return lexer_make_token(TOKEN_DOT, ".", line, column);
@@ -293,6 +330,10 @@ Token lexer_next_token(Lexer* lexer) {
     if (c == '|' && lexer_peek_ahead(lexer, 1) == '>') {
         lexer_advance(lexer);
         lexer_advance(lexer);
+        if (lexer_peek(lexer) == '>') {
+            lexer_advance(lexer);
+            return lexer_make_token(TOKEN_LAZY_PIPE, "|>>", line, column);
+        }
         return lexer_make_token(TOKEN_PIPE, "|>", line, column);
     }
     
@@ -312,8 +353,8 @@ Token lexer_next_token(Lexer* lexer) {
         return lexer_read_identifier(lexer);
     }
     
-    // Numbers
-    if (isdigit(c)) {
+    // Numbers, negative ones included
+    if (isdigit(c) || (c == '-' && isdigit(lexer_peek_ahead(lexer, 1)))) {
         return lexer_read_number(lexer);
     }
     
@@ -322,9 +363,7 @@ Token lexer_next_token(Lexer* lexer) {
     char* error_value = malloc(2);
     error_value[0] = c;
     error_value[1] = '\0';
-    Token token = lexer_make_token(TOKEN_ERROR, error_value, line, column);
-    free(error_value);
-    return token;
+    return lexer_make_owned_token(TOKEN_ERROR, error_value, line, column);
 }
 
 const char* token_type_to_string(TokenType type) {
@@ -342,7 +381,11 @@ const char* token_type_to_string(TokenType type) {
         case TOKEN_MATCH: return "MATCH";
         case TOKEN_WHEN: return "WHEN";
         case TOKEN_RETURN: return "RETURN";
+        case TOKEN_AWAIT: return "AWAIT";
+        case TOKEN_IMPORT: return "IMPORT";
+        case TOKEN_EXPORT: return "EXPORT";
         case TOKEN_PIPE: return "PIPE";
+        case TOKEN_LAZY_PIPE: return "LAZY_PIPE";
         case TOKEN_ARROW: return "ARROW";
         case TOKEN_ASSIGN: return "ASSIGN";
         case TOKEN_COLON: return "COLON";
@@ -358,6 +401,7 @@ const char* token_type_to_string(TokenType type) {
         case TOKEN_RBRACKET: return "RBRACKET";
         case TOKEN_SEMICOLON: return "SEMICOLON";
         case TOKEN_COMMA: return "COMMA";
+        case TOKEN_STAR: return "STAR";
         case TOKEN_NEWLINE: return "NEWLINE";
         case TOKEN_COMMENT: return "COMMENT";
         case TOKEN_ERROR: return "ERROR";
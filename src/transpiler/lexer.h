@@ -23,9 +23,13 @@ typedef enum {
     TOKEN_MATCH,
     TOKEN_WHEN,
     TOKEN_RETURN,
+    TOKEN_AWAIT,
+    TOKEN_IMPORT,
+    TOKEN_EXPORT,
     
     // Operators
     TOKEN_PIPE,           // |>
+    TOKEN_LAZY_PIPE,      // |>>
     TOKEN_ARROW,          // =>
     TOKEN_ASSIGN,         // =
     TOKEN_COLON,          // :
@@ -43,6 +47,7 @@ typedef enum {
     TOKEN_RBRACKET,       // ]
     TOKEN_SEMICOLON,      // ;
     TOKEN_COMMA,          // ,
+    TOKEN_STAR,           // * (in import * as name)
     
     // Whitespace and comments
     TOKEN_NEWLINE,
@@ -52,7 +57,8 @@ typedef enum {
 
 typedef struct {
     TokenType type;
-    char* value;
+    char* value;            // Owned by the token unless interned
+    int interned;           // value came from intern() and must not be freed
     int line;
     int column;
     int length;
@@ -68,6 +74,7 @@ typedef struct {
 
 // Function prototypes
 Lexer* lexer_new(const char* source);
+Lexer* lexer_new_range(const char* source, int start, int end, int line);
 void lexer_free(Lexer* lexer);
 Token lexer_next_token(Lexer* lexer);
 void token_free(Token* token);
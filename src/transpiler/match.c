@@ -0,0 +1,978 @@
+#include "match.h"
+#include "intern.h"
+#include "parallel.h"
+#include <stdint.h>
+
+// The atoms an expression can evaluate to; NULL where that is unknown
+typedef struct {
+    const char** atoms;     // Interned, with the leading ':'
+    int count;
+    int capacity;
+} MatchAtoms;
+
+typedef struct {
+    const char* name;
+    MatchAtoms* atoms;
+    int rebound;            // Also bound somewhere else, so uses may not see this let
+} MatchBinding;
+
+// Top-level lets by name, open addressing on the interned pointer
+typedef struct {
+    MatchBinding* bindings;
+    int count;
+    int capacity;
+} MatchScope;
+
+static MatchAtoms* match_atoms_new(void) {
+    MatchAtoms* atoms = malloc(sizeof(MatchAtoms));
+    atoms->atoms = NULL;
+    atoms->count = 0;
+    atoms->capacity = 0;
+    return atoms;
+}
+
+static void match_atoms_free(MatchAtoms* atoms) {
+    if (!atoms) return;
+
+    free(atoms->atoms);
+    free(atoms);
+}
+
+static int match_atoms_index(const MatchAtoms* atoms, const char* atom) {
+    for (int i = 0; i < atoms->count; i++) {
+        if (atoms->atoms[i] == atom) return i;
+    }
+    return -1;
+}
+
+static void match_atoms_add(MatchAtoms* atoms, const char* atom) {
+    if (match_atoms_index(atoms, atom) >= 0) return;
+
+    if (atoms->count >= atoms->capacity) {
+        atoms->capacity = atoms->capacity == 0 ? 4 : atoms->capacity * 2;
+        atoms->atoms = realloc(atoms->atoms, atoms->capacity * sizeof(const char*));
+    }
+    atoms->atoms[atoms->count++] = atom;
+}
+
+static MatchBinding* match_scope_find(MatchScope* scope, const char* name) {
+    if (scope->capacity == 0) return NULL;
+
+    uintptr_t slot = ((uintptr_t)name >> 3) & (scope->capacity - 1);
+    while (scope->bindings[slot].name) {
+        if (scope->bindings[slot].name == name) {
+            return &scope->bindings[slot];
+        }
+        slot = (slot + 1) & (scope->capacity - 1);
+    }
+    return NULL;
+}
+
+static MatchBinding* match_scope_add(MatchScope* scope, const char* name) {
+    MatchBinding* binding = match_scope_find(scope, name);
+    if (binding) return binding;
+
+    if ((scope->count + 1) * 2 > scope->capacity) {
+        MatchBinding* old = scope->bindings;
+        int old_capacity = scope->capacity;
+
+        scope->capacity = old_capacity == 0 ? 64 : old_capacity * 2;
+        scope->bindings = calloc(scope->capacity, sizeof(MatchBinding));
+        for (int i = 0; i < old_capacity; i++) {
+            if (!old[i].name) continue;
+
+            uintptr_t slot = ((uintptr_t)old[i].name >> 3) & (scope->capacity - 1);
+            while (scope->bindings[slot].name) {
+                slot = (slot + 1) & (scope->capacity - 1);
+            }
+            scope->bindings[slot] = old[i];
+        }
+        free(old);
+    }
+
+    uintptr_t slot = ((uintptr_t)name >> 3) & (scope->capacity - 1);
+    while (scope->bindings[slot].name) {
+        slot = (slot + 1) & (scope->capacity - 1);
+    }
+    scope->bindings[slot].name = name;
+    scope->count++;
+    return &scope->bindings[slot];
+}
+
+// true, false, null and undefined compare like literals; any other name binds
+static int match_is_keyword(const char* name) {
+    return strcmp(name, "true") == 0 || strcmp(name, "false") == 0 ||
+           strcmp(name, "null") == 0 || strcmp(name, "undefined") == 0;
+}
+
+// `_` or a binding
+static int match_is_wildcard(ASTNode* pattern) {
+    return pattern->type == AST_IDENTIFIER && !match_is_keyword(pattern->identifier.name);
+}
+
+static void match_mark_pattern_rebound(MatchScope* scope, ASTNode* pattern) {
+    if (!pattern) return;
+
+    switch (pattern->type) {
+        case AST_IDENTIFIER:
+            if (pattern->identifier.name != intern_underscore && !match_is_keyword(pattern->identifier.name)) {
+                match_scope_add(scope, pattern->identifier.name)->rebound = 1;
+            }
+            break;
+        case AST_ARRAY_PATTERN:
+            for (int i = 0; i < pattern->array_pattern.elements->count; i++) {
+                match_mark_pattern_rebound(scope, pattern->array_pattern.elements->nodes[i]);
+            }
+            if (pattern->array_pattern.rest) {
+                match_scope_add(scope, pattern->array_pattern.rest)->rebound = 1;
+            }
+            break;
+        case AST_OBJECT_PATTERN:
+            for (int i = 0; i < pattern->object_pattern.fields->count; i++) {
+                match_mark_pattern_rebound(scope, pattern->object_pattern.fields->nodes[i]->field_pattern.pattern);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+// Parameters, nested lets, pattern bindings and assignments can shadow or
+// change a top-level let; those lets are left unknown rather than resolving
+// names by scope
+static void match_mark_rebound(ASTNode* node, void* context) {
+    MatchScope* scope = context;
+    const char* name = NULL;
+
+    switch (node->type) {
+        case AST_PARAM_DECL:
+            name = node->param_decl.name;
+            break;
+        case AST_ASSIGNMENT:
+            name = node->assignment.target;
+            break;
+        case AST_MATCH_ARM:
+            match_mark_pattern_rebound(scope, node->match_arm.pattern);
+            return;
+        case AST_BLOCK:
+            for (int i = 0; i < node->block.statements->count; i++) {
+                ASTNode* statement = node->block.statements->nodes[i];
+                if (statement && statement->type == AST_LET_BINDING) {
+                    match_scope_add(scope, statement->let_binding.name)->rebound = 1;
+                }
+            }
+            return;
+        default:
+            return;
+    }
+
+    if (name) {
+        match_scope_add(scope, name)->rebound = 1;
+    }
+}
+
+static MatchAtoms* match_infer_at(MatchScope* scope, ASTNode* expr, int depth);
+
+typedef struct {
+    MatchScope* scope;
+    ASTNode* expr;
+    int depth;
+    MatchAtoms* result;
+} MatchInference;
+
+static void match_infer_run(void* context) {
+    MatchInference* inference = context;
+    inference->result = match_infer_at(inference->scope, inference->expr, inference->depth);
+}
+
+// Infer expr one level deeper, on a fresh stack every PARALLEL_STACK_DEPTH levels
+static MatchAtoms* match_infer_nested(MatchScope* scope, ASTNode* expr, int depth) {
+    MatchInference inference = { scope, expr, depth + 1, NULL };
+    if (inference.depth % PARALLEL_STACK_DEPTH == 0) {
+        parallel_call_on_new_stack(match_infer_run, &inference);
+    } else {
+        match_infer_run(&inference);
+    }
+    return inference.result;
+}
+
+static MatchAtoms* match_infer_at(MatchScope* scope, ASTNode* expr, int depth) {
+    if (!expr) return NULL;
+
+    switch (expr->type) {
+        case AST_ATOM_LITERAL: {
+            MatchAtoms* atoms = match_atoms_new();
+            match_atoms_add(atoms, expr->atom_literal.value);
+            return atoms;
+        }
+        case AST_IDENTIFIER: {
+            MatchBinding* binding = match_scope_find(scope, expr->identifier.name);
+            if (!binding || binding->rebound || !binding->atoms) return NULL;
+
+            MatchAtoms* atoms = match_atoms_new();
+            for (int i = 0; i < binding->atoms->count; i++) {
+                match_atoms_add(atoms, binding->atoms->atoms[i]);
+            }
+            return atoms;
+        }
+        case AST_LAZY_EXPR:
+            // Deferred or not, the binding ends up holding the value
+            return match_infer_nested(scope, expr->lazy_expr.value, depth);
+        case AST_MATCH_EXPR: {
+            // A match produces one of its arms' values or throws
+            ASTList* arms = expr->match_expr.arms;
+            if (arms->count == 0) return NULL;
+
+            MatchAtoms* atoms = match_atoms_new();
+            for (int i = 0; i < arms->count; i++) {
+                MatchAtoms* arm = match_infer_nested(scope, arms->nodes[i]->match_arm.body, depth);
+                if (!arm) {
+                    match_atoms_free(atoms);
+                    return NULL;
+                }
+                for (int j = 0; j < arm->count; j++) {
+                    match_atoms_add(atoms, arm->atoms[j]);
+                }
+                match_atoms_free(arm);
+            }
+            return atoms;
+        }
+        default:
+            return NULL;
+    }
+}
+
+static MatchAtoms* match_infer(MatchScope* scope, ASTNode* expr) {
+    return match_infer_at(scope, expr, 0);
+}
+
+typedef struct {
+    MatchScope* scope;
+    int reported;
+} MatchCheck;
+
+static void match_check_node(ASTNode* node, void* context) {
+    MatchCheck* check = context;
+    if (node->type != AST_MATCH_EXPR) return;
+
+    ASTList* arms = node->match_expr.arms;
+    MatchAtoms* atoms = match_infer(check->scope, node->match_expr.expr);
+    char* covered = atoms ? calloc(atoms->count, 1) : NULL;
+    int remaining = atoms ? atoms->count : -1;
+
+    node->match_expr.exhaustive_arms = 0;
+    for (int i = 0; i < arms->count; i++) {
+        ASTNode* arm = arms->nodes[i];
+        ASTNode* pattern = arm->match_arm.pattern;
+        if (arm->match_arm.guard || !pattern) continue;
+
+        if (match_is_wildcard(pattern)) {
+            node->match_expr.exhaustive_arms = i + 1;
+            break;
+        }
+
+        if (atoms && pattern->type == AST_ATOM_LITERAL) {
+            int index = match_atoms_index(atoms, pattern->atom_literal.value);
+            if (index >= 0 && !covered[index]) {
+                covered[index] = 1;
+                if (--remaining == 0) {
+                    node->match_expr.exhaustive_arms = i + 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    if (atoms && node->match_expr.exhaustive_arms == 0) {
+        fprintf(stderr, "Warning: Non-exhaustive match at line %d, column %d, missing", node->line, node->column);
+        const char* separator = " ";
+        for (int i = 0; i < atoms->count; i++) {
+            if (covered[i]) continue;
+            fprintf(stderr, "%s%s", separator, atoms->atoms[i]);
+            separator = ", ";
+        }
+        fprintf(stderr, "\n");
+        check->reported++;
+    }
+
+    free(covered);
+    match_atoms_free(atoms);
+}
+
+int match_check_exhaustive(ASTNode* program) {
+    if (!program || program->type != AST_PROGRAM) return 0;
+
+    MatchScope scope = { NULL, 0, 0 };
+    ast_walk(program, match_mark_rebound, &scope);
+
+    // Lets are constants; each one sees the lets before it
+    ASTList* declarations = program->program.declarations;
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* decl = ast_unwrap_export(declarations->nodes[i]);
+        if (decl->type != AST_LET_BINDING) continue;
+
+        MatchBinding* binding = match_scope_find(&scope, decl->let_binding.name);
+        if (binding) {
+            // Declared twice
+            binding->rebound = 1;
+            continue;
+        }
+        binding = match_scope_add(&scope, decl->let_binding.name);
+        binding->atoms = match_infer(&scope, decl->let_binding.value);
+    }
+
+    MatchCheck check = { &scope, 0 };
+    ast_walk(program, match_check_node, &check);
+
+    for (int i = 0; i < scope.capacity; i++) {
+        match_atoms_free(scope.bindings[i].atoms);
+    }
+    free(scope.bindings);
+    return check.reported;
+}
+
+// Decision trees
+
+typedef enum {
+    MATCH_NEED_PATTERN,     // A literal, array or object pattern
+    MATCH_NEED_LENGTH,
+    MATCH_NEED_MIN_LENGTH
+} MatchNeedKind;
+
+// A test an arm still needs to pass, on one occurrence
+typedef struct {
+    MatchNeedKind kind;
+    int occurrence;
+    ASTNode* pattern;
+    int count;
+} MatchNeed;
+
+// An arm that is still possible, with what is left to test and what it binds
+typedef struct {
+    ASTNode* arm;
+    MatchNeed* needs;
+    int need_count;
+    int need_capacity;
+    MatchBind* binds;
+    int bind_count;
+    int bind_capacity;
+} MatchRow;
+
+// What a test outcome means for one need of a row
+typedef enum {
+    MATCH_KEEP,             // Still to be tested
+    MATCH_DONE,             // Passed
+    MATCH_DROP,             // Failed, so the row cannot match
+    MATCH_EXPAND            // Structure confirmed, its parts are now to be tested
+} MatchOutcome;
+
+int match_needs_tree(ASTNode* match) {
+    ASTList* arms = match->match_expr.arms;
+    for (int i = 0; i < arms->count; i++) {
+        ASTNode* pattern = arms->nodes[i]->match_arm.pattern;
+        if (!pattern) continue;
+
+        if (pattern->type == AST_ARRAY_PATTERN || pattern->type == AST_OBJECT_PATTERN) return 1;
+        if (match_is_wildcard(pattern) && pattern->identifier.name != intern_underscore) return 1;
+    }
+    return 0;
+}
+
+static int match_occurrence(MatchTree* tree, int parent, MatchAccess access, const char* key, int index) {
+    for (int i = 0; i < tree->occurrence_count; i++) {
+        MatchOccurrence* occurrence = &tree->occurrences[i];
+        if (occurrence->parent == parent && occurrence->access == access &&
+            occurrence->key == key && occurrence->index == index) {
+            return i;
+        }
+    }
+
+    if (tree->occurrence_count >= tree->occurrence_capacity) {
+        tree->occurrence_capacity = tree->occurrence_capacity == 0 ? 8 : tree->occurrence_capacity * 2;
+        tree->occurrences = realloc(tree->occurrences, tree->occurrence_capacity * sizeof(MatchOccurrence));
+    }
+
+    MatchOccurrence* occurrence = &tree->occurrences[tree->occurrence_count];
+    occurrence->parent = parent;
+    occurrence->access = access;
+    occurrence->key = key;
+    occurrence->index = index;
+    return tree->occurrence_count++;
+}
+
+static void match_row_need(MatchRow* row, MatchNeedKind kind, int occurrence, ASTNode* pattern, int count) {
+    if (row->need_count >= row->need_capacity) {
+        row->need_capacity = row->need_capacity == 0 ? 4 : row->need_capacity * 2;
+        row->needs = realloc(row->needs, row->need_capacity * sizeof(MatchNeed));
+    }
+
+    MatchNeed* need = &row->needs[row->need_count++];
+    need->kind = kind;
+    need->occurrence = occurrence;
+    need->pattern = pattern;
+    need->count = count;
+}
+
+static void match_row_bind(MatchRow* row, const char* name, int occurrence, int rest_from) {
+    if (row->bind_count >= row->bind_capacity) {
+        row->bind_capacity = row->bind_capacity == 0 ? 4 : row->bind_capacity * 2;
+        row->binds = realloc(row->binds, row->bind_capacity * sizeof(MatchBind));
+    }
+
+    MatchBind* bind = &row->binds[row->bind_count++];
+    bind->name = name;
+    bind->occurrence = occurrence;
+    bind->rest_from = rest_from;
+}
+
+// Wildcards vanish and bindings are recorded; anything else is a need
+static void match_row_add_pattern(MatchRow* row, int occurrence, ASTNode* pattern) {
+    if (!pattern) return;
+
+    if (match_is_wildcard(pattern)) {
+        if (pattern->identifier.name != intern_underscore) {
+            match_row_bind(row, pattern->identifier.name, occurrence, -1);
+        }
+        return;
+    }
+    match_row_need(row, MATCH_NEED_PATTERN, occurrence, pattern, 0);
+}
+
+static void match_row_expand(MatchTree* tree, MatchRow* row, int occurrence, ASTNode* pattern) {
+    if (pattern->type == AST_ARRAY_PATTERN) {
+        ASTList* elements = pattern->array_pattern.elements;
+        const char* rest = pattern->array_pattern.rest;
+
+        int length = match_occurrence(tree, occurrence, MATCH_LENGTH, NULL, 0);
+        match_row_need(row, rest ? MATCH_NEED_MIN_LENGTH : MATCH_NEED_LENGTH, length, NULL, elements->count);
+        for (int i = 0; i < elements->count; i++) {
+            match_row_add_pattern(row, match_occurrence(tree, occurrence, MATCH_INDEX, NULL, i), elements->nodes[i]);
+        }
+        if (rest && rest != intern_underscore) {
+            match_row_bind(row, rest, occurrence, elements->count);
+        }
+    } else {
+        ASTList* fields = pattern->object_pattern.fields;
+        for (int i = 0; i < fields->count; i++) {
+            ASTNode* field = fields->nodes[i];
+            int child = match_occurrence(tree, occurrence, MATCH_FIELD, field->field_pattern.key, 0);
+            match_row_add_pattern(row, child, field->field_pattern.pattern);
+        }
+    }
+}
+
+// Literal patterns are numbers, strings, atoms and keyword names
+static int match_is_literal(ASTNode* pattern) {
+    return pattern->type == AST_NUMBER_LITERAL || pattern->type == AST_STRING_LITERAL ||
+           pattern->type == AST_ATOM_LITERAL || pattern->type == AST_IDENTIFIER;
+}
+
+static int match_literals_equal(ASTNode* a, ASTNode* b) {
+    if (a->type != b->type) return 0;
+
+    switch (a->type) {
+        case AST_NUMBER_LITERAL:
+            return strtod(a->number_literal.value, NULL) == strtod(b->number_literal.value, NULL);
+        case AST_STRING_LITERAL:
+            return a->string_literal.value == b->string_literal.value;
+        case AST_ATOM_LITERAL:
+            return a->atom_literal.value == b->atom_literal.value;
+        default:
+            return a->identifier.name == b->identifier.name;
+    }
+}
+
+static MatchOutcome match_outcome(const MatchNode* test, const MatchNeed* need, int passed) {
+    if (need->occurrence != test->occurrence) return MATCH_KEEP;
+
+    ASTNode* pattern = need->pattern;
+    switch (test->test) {
+        case MATCH_TEST_EQUALS:
+            if (match_is_literal(pattern)) {
+                int same = match_literals_equal(test->value, pattern);
+                if (passed) return same ? MATCH_DONE : MATCH_DROP;
+                return same ? MATCH_DROP : MATCH_KEEP;
+            }
+            // A literal is never an array or object
+            return passed ? MATCH_DROP : MATCH_KEEP;
+
+        case MATCH_TEST_ARRAY:
+            if (pattern->type == AST_ARRAY_PATTERN) return passed ? MATCH_EXPAND : MATCH_DROP;
+            // Arrays are objects, so their fields can be read straight away
+            if (pattern->type == AST_OBJECT_PATTERN) return passed ? MATCH_EXPAND : MATCH_KEEP;
+            return passed ? MATCH_DROP : MATCH_KEEP;
+
+        case MATCH_TEST_OBJECT:
+            if (pattern->type == AST_OBJECT_PATTERN) return passed ? MATCH_EXPAND : MATCH_DROP;
+            if (pattern->type == AST_ARRAY_PATTERN) return passed ? MATCH_KEEP : MATCH_DROP;
+            return passed ? MATCH_DROP : MATCH_KEEP;
+
+        case MATCH_TEST_LENGTH:
+            if (need->kind == MATCH_NEED_LENGTH) {
+                if (passed) return need->count == test->count ? MATCH_DONE : MATCH_DROP;
+                return need->count == test->count ? MATCH_DROP : MATCH_KEEP;
+            }
+            if (passed) return test->count >= need->count ? MATCH_DONE : MATCH_DROP;
+            return MATCH_KEEP;
+
+        case MATCH_TEST_MIN_LENGTH:
+            if (need->kind == MATCH_NEED_MIN_LENGTH) {
+                if (passed) return need->count <= test->count ? MATCH_DONE : MATCH_KEEP;
+                return need->count >= test->count ? MATCH_DROP : MATCH_KEEP;
+            }
+            if (passed) return need->count < test->count ? MATCH_DROP : MATCH_KEEP;
+            return need->count >= test->count ? MATCH_DROP : MATCH_KEEP;
+    }
+    return MATCH_KEEP;
+}
+
+static void match_row_free(MatchRow* row) {
+    free(row->needs);
+    free(row->binds);
+}
+
+// The rows that can still match once test has the given outcome
+static MatchRow* match_specialize(MatchTree* tree, MatchRow* rows, int count, const MatchNode* test, int passed, int* result_count) {
+    MatchRow* result = malloc((count > 0 ? count : 1) * sizeof(MatchRow));
+    *result_count = 0;
+
+    for (int i = 0; i < count; i++) {
+        MatchRow row;
+        memset(&row, 0, sizeof(MatchRow));
+        row.arm = rows[i].arm;
+        for (int j = 0; j < rows[i].bind_count; j++) {
+            MatchBind* bind = &rows[i].binds[j];
+            match_row_bind(&row, bind->name, bind->occurrence, bind->rest_from);
+        }
+
+        int dropped = 0;
+        for (int j = 0; j < rows[i].need_count && !dropped; j++) {
+            MatchNeed* need = &rows[i].needs[j];
+            switch (match_outcome(test, need, passed)) {
+                case MATCH_KEEP:
+                    match_row_need(&row, need->kind, need->occurrence, need->pattern, need->count);
+                    break;
+                case MATCH_DONE:
+                    break;
+                case MATCH_DROP:
+                    dropped = 1;
+                    break;
+                case MATCH_EXPAND:
+                    match_row_expand(tree, &row, need->occurrence, need->pattern);
+                    break;
+            }
+        }
+
+        if (dropped) {
+            match_row_free(&row);
+        } else {
+            result[(*result_count)++] = row;
+        }
+    }
+
+    return result;
+}
+
+static void match_free_rows(MatchRow* rows, int count) {
+    for (int i = 0; i < count; i++) {
+        match_row_free(&rows[i]);
+    }
+    free(rows);
+}
+
+// Test first the occurrence of the first row that the most rows need
+static const MatchNeed* match_choose_need(const MatchRow* rows, int count) {
+    const MatchNeed* best = NULL;
+    int best_score = -1;
+
+    for (int i = 0; i < rows[0].need_count; i++) {
+        const MatchNeed* need = &rows[0].needs[i];
+        int score = 0;
+        for (int j = 0; j < count; j++) {
+            for (int k = 0; k < rows[j].need_count; k++) {
+                if (rows[j].needs[k].occurrence == need->occurrence) {
+                    score++;
+                    break;
+                }
+            }
+        }
+        if (score > best_score) {
+            best = need;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+// Builds a tree, sharing the node of each set of rows seen before
+typedef struct {
+    MatchRow* rows;         // Copies owned by the builder
+    int count;
+    unsigned hash;
+    MatchNode* node;
+} MatchMemo;
+
+typedef struct {
+    MatchTree* tree;
+    MatchNode* fail;        // Where paths with no row left go
+    MatchNode** nodes;      // Every node created, reachable or not
+    int node_count;
+    int node_capacity;
+    int budget;             // Nodes that may still be created, -1 without a limit
+    MatchMemo* memo;        // Open addressing on the rows' hash; NULL when not sharing
+    int memo_count;
+    int memo_capacity;
+} MatchBuilder;
+
+static MatchNode* match_node_new(MatchBuilder* builder, MatchNodeKind kind) {
+    MatchNode* node = calloc(1, sizeof(MatchNode));
+    node->kind = kind;
+    node->order = -1;
+
+    if (builder->node_count >= builder->node_capacity) {
+        builder->node_capacity = builder->node_capacity == 0 ? 64 : builder->node_capacity * 2;
+        builder->nodes = realloc(builder->nodes, builder->node_capacity * sizeof(MatchNode*));
+    }
+    builder->nodes[builder->node_count++] = node;
+    if (builder->budget > 0) {
+        builder->budget--;
+    }
+    return node;
+}
+
+static unsigned match_rows_hash(const MatchRow* rows, int count) {
+    uintptr_t hash = count;
+    for (int i = 0; i < count; i++) {
+        hash = hash * 31 + ((uintptr_t)rows[i].arm >> 3);
+        for (int j = 0; j < rows[i].need_count; j++) {
+            const MatchNeed* need = &rows[i].needs[j];
+            hash = hash * 31 + need->kind;
+            hash = hash * 31 + need->occurrence;
+            hash = hash * 31 + ((uintptr_t)need->pattern >> 3);
+            hash = hash * 31 + need->count;
+        }
+        for (int j = 0; j < rows[i].bind_count; j++) {
+            const MatchBind* bind = &rows[i].binds[j];
+            hash = hash * 31 + ((uintptr_t)bind->name >> 3);
+            hash = hash * 31 + bind->occurrence;
+            hash = hash * 31 + bind->rest_from;
+        }
+    }
+    return (unsigned)(hash ^ (hash >> 16));
+}
+
+static int match_rows_equal(const MatchRow* a, const MatchRow* b, int count) {
+    for (int i = 0; i < count; i++) {
+        if (a[i].arm != b[i].arm || a[i].need_count != b[i].need_count || a[i].bind_count != b[i].bind_count) {
+            return 0;
+        }
+        for (int j = 0; j < a[i].need_count; j++) {
+            const MatchNeed* x = &a[i].needs[j];
+            const MatchNeed* y = &b[i].needs[j];
+            if (x->kind != y->kind || x->occurrence != y->occurrence ||
+                x->pattern != y->pattern || x->count != y->count) {
+                return 0;
+            }
+        }
+        for (int j = 0; j < a[i].bind_count; j++) {
+            const MatchBind* x = &a[i].binds[j];
+            const MatchBind* y = &b[i].binds[j];
+            if (x->name != y->name || x->occurrence != y->occurrence || x->rest_from != y->rest_from) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static MatchMemo* match_memo_find(MatchBuilder* builder, const MatchRow* rows, int count, unsigned hash) {
+    unsigned slot = hash & (builder->memo_capacity - 1);
+    while (builder->memo[slot].node) {
+        MatchMemo* entry = &builder->memo[slot];
+        if (entry->hash == hash && entry->count == count && match_rows_equal(entry->rows, rows, count)) {
+            return entry;
+        }
+        slot = (slot + 1) & (builder->memo_capacity - 1);
+    }
+    return NULL;
+}
+
+static void match_memo_add(MatchBuilder* builder, const MatchRow* rows, int count, unsigned hash, MatchNode* node) {
+    if ((builder->memo_count + 1) * 2 > builder->memo_capacity) {
+        MatchMemo* old = builder->memo;
+        int old_capacity = builder->memo_capacity;
+
+        builder->memo_capacity *= 2;
+        builder->memo = calloc(builder->memo_capacity, sizeof(MatchMemo));
+        for (int i = 0; i < old_capacity; i++) {
+            if (!old[i].node) continue;
+
+            unsigned slot = old[i].hash & (builder->memo_capacity - 1);
+            while (builder->memo[slot].node) {
+                slot = (slot + 1) & (builder->memo_capacity - 1);
+            }
+            builder->memo[slot] = old[i];
+        }
+        free(old);
+    }
+
+    unsigned slot = hash & (builder->memo_capacity - 1);
+    while (builder->memo[slot].node) {
+        slot = (slot + 1) & (builder->memo_capacity - 1);
+    }
+
+    MatchMemo* entry = &builder->memo[slot];
+    entry->rows = malloc(count * sizeof(MatchRow));
+    for (int i = 0; i < count; i++) {
+        MatchRow* row = &entry->rows[i];
+        memset(row, 0, sizeof(MatchRow));
+        row->arm = rows[i].arm;
+        for (int j = 0; j < rows[i].need_count; j++) {
+            const MatchNeed* need = &rows[i].needs[j];
+            match_row_need(row, need->kind, need->occurrence, need->pattern, need->count);
+        }
+        for (int j = 0; j < rows[i].bind_count; j++) {
+            const MatchBind* bind = &rows[i].binds[j];
+            match_row_bind(row, bind->name, bind->occurrence, bind->rest_from);
+        }
+    }
+    entry->count = count;
+    entry->hash = hash;
+    entry->node = node;
+    builder->memo_count++;
+}
+
+static void match_memo_free(MatchBuilder* builder) {
+    for (int i = 0; i < builder->memo_capacity; i++) {
+        if (builder->memo[i].node) {
+            match_free_rows(builder->memo[i].rows, builder->memo[i].count);
+        }
+    }
+    free(builder->memo);
+    builder->memo = NULL;
+    builder->memo_count = 0;
+    builder->memo_capacity = 0;
+}
+
+static MatchNode* match_build(MatchBuilder* builder, MatchRow* rows, int count) {
+    // Out of budget: the caller gives up on this tree
+    if (count == 0 || builder->budget == 0) return builder->fail;
+
+    unsigned hash = 0;
+    if (builder->memo) {
+        hash = match_rows_hash(rows, count);
+        MatchMemo* seen = match_memo_find(builder, rows, count, hash);
+        if (seen) return seen->node;
+    }
+
+    MatchNode* node;
+
+    // Nothing left to test: the first row matches, unless its guard fails
+    if (rows[0].need_count == 0) {
+        node = match_node_new(builder, MATCH_NODE_LEAF);
+        node->arm = rows[0].arm;
+        node->bind_count = rows[0].bind_count;
+        node->binds = malloc((rows[0].bind_count > 0 ? rows[0].bind_count : 1) * sizeof(MatchBind));
+        if (rows[0].bind_count > 0) {
+            memcpy(node->binds, rows[0].binds, rows[0].bind_count * sizeof(MatchBind));
+        }
+        if (rows[0].arm->match_arm.guard) {
+            node->next = match_build(builder, rows + 1, count - 1);
+        }
+    } else {
+        const MatchNeed* need = match_choose_need(rows, count);
+        node = match_node_new(builder, MATCH_NODE_TEST);
+        node->occurrence = need->occurrence;
+        switch (need->kind) {
+            case MATCH_NEED_LENGTH:
+                node->test = MATCH_TEST_LENGTH;
+                node->count = need->count;
+                break;
+            case MATCH_NEED_MIN_LENGTH:
+                node->test = MATCH_TEST_MIN_LENGTH;
+                node->count = need->count;
+                break;
+            case MATCH_NEED_PATTERN:
+                if (need->pattern->type == AST_ARRAY_PATTERN) {
+                    node->test = MATCH_TEST_ARRAY;
+                } else if (need->pattern->type == AST_OBJECT_PATTERN) {
+                    node->test = MATCH_TEST_OBJECT;
+                } else {
+                    node->test = MATCH_TEST_EQUALS;
+                    node->value = need->pattern;
+                }
+                break;
+        }
+
+        int then_count;
+        MatchRow* then_rows = match_specialize(builder->tree, rows, count, node, 1, &then_count);
+        node->then_branch = match_build(builder, then_rows, then_count);
+        match_free_rows(then_rows, then_count);
+
+        int else_count;
+        MatchRow* else_rows = match_specialize(builder->tree, rows, count, node, 0, &else_count);
+        node->else_branch = match_build(builder, else_rows, else_count);
+        match_free_rows(else_rows, else_count);
+    }
+
+    if (builder->memo) {
+        match_memo_add(builder, rows, count, hash, node);
+    }
+    return node;
+}
+
+// Postorder from node, counting the branches into each node reached
+static void match_postorder(MatchTree* tree, MatchNode* node) {
+    node->order = 0;
+
+    MatchNode* children[3] = { node->then_branch, node->else_branch, node->next };
+    for (int i = 0; i < 3; i++) {
+        MatchNode* child = children[i];
+        if (!child) continue;
+
+        child->refs++;
+        if (child->order < 0) {
+            match_postorder(tree, child);
+        }
+    }
+    tree->nodes[tree->node_count++] = node;
+}
+
+static MatchNode* match_common_owner(MatchNode* a, MatchNode* b) {
+    while (a != b) {
+        while (a->order > b->order) a = a->owner;
+        while (b->order > a->order) b = b->owner;
+    }
+    return a;
+}
+
+// Orders the reachable nodes and gives each shared one its owner
+static void match_tree_link(MatchTree* tree, MatchBuilder* builder) {
+    tree->nodes = malloc(builder->node_count * sizeof(MatchNode*));
+    tree->node_count = 0;
+    match_postorder(tree, tree->root);
+
+    for (int i = 0, j = tree->node_count - 1; i < j; i++, j--) {
+        MatchNode* node = tree->nodes[i];
+        tree->nodes[i] = tree->nodes[j];
+        tree->nodes[j] = node;
+    }
+    for (int i = 0; i < tree->node_count; i++) {
+        tree->nodes[i]->order = i;
+    }
+
+    // In reverse postorder every branch into a node is seen before the node
+    for (int i = 0; i < tree->node_count; i++) {
+        MatchNode* node = tree->nodes[i];
+        MatchNode* children[3] = { node->then_branch, node->else_branch, node->next };
+        for (int j = 0; j < 3; j++) {
+            MatchNode* child = children[j];
+            if (child) {
+                child->owner = child->owner ? match_common_owner(child->owner, node) : node;
+            }
+        }
+    }
+
+    // Later nodes can break to earlier ones' blocks, so they go outside them.
+    // An unguarded leaf returning a literal or name is cheaper repeated.
+    for (int i = 0; i < tree->node_count; i++) {
+        MatchNode* node = tree->nodes[i];
+        if (node->refs < 2 || node->kind == MATCH_NODE_FAIL) continue;
+        if (node->kind == MATCH_NODE_LEAF && !node->arm->match_arm.guard &&
+            match_is_literal(node->arm->match_arm.body)) {
+            continue;
+        }
+
+        node->shared = 1;
+        node->owned_next = node->owner->owned;
+        node->owner->owned = node;
+        tree->shared = 1;
+    }
+    tree->can_fail = builder->fail->order >= 0;
+}
+
+static int match_pattern_size(ASTNode* pattern) {
+    if (!pattern) return 0;
+
+    int size = 1;
+    if (pattern->type == AST_ARRAY_PATTERN) {
+        for (int i = 0; i < pattern->array_pattern.elements->count; i++) {
+            size += match_pattern_size(pattern->array_pattern.elements->nodes[i]);
+        }
+    } else if (pattern->type == AST_OBJECT_PATTERN) {
+        for (int i = 0; i < pattern->object_pattern.fields->count; i++) {
+            size += match_pattern_size(pattern->object_pattern.fields->nodes[i]->field_pattern.pattern);
+        }
+    }
+    return size;
+}
+
+MatchTree* match_tree_build(ASTNode* match) {
+    MatchTree* tree = malloc(sizeof(MatchTree));
+    memset(tree, 0, sizeof(MatchTree));
+    int root = match_occurrence(tree, -1, MATCH_ROOT, NULL, 0);
+
+    // Arms past a proven-exhaustive one are unreachable
+    ASTList* arms = match->match_expr.arms;
+    int arm_count = arms->count;
+    if (match->match_expr.exhaustive_arms > 0 && match->match_expr.exhaustive_arms < arm_count) {
+        arm_count = match->match_expr.exhaustive_arms;
+    }
+
+    MatchRow* rows = malloc((arm_count > 0 ? arm_count : 1) * sizeof(MatchRow));
+    int row_count = 0;
+    int size = 0;
+    for (int i = 0; i < arm_count; i++) {
+        if (!arms->nodes[i]->match_arm.pattern) continue;
+
+        MatchRow* row = &rows[row_count++];
+        memset(row, 0, sizeof(MatchRow));
+        row->arm = arms->nodes[i];
+        match_row_add_pattern(row, root, row->arm->match_arm.pattern);
+        size += match_pattern_size(row->arm->match_arm.pattern);
+    }
+
+    MatchBuilder builder;
+    memset(&builder, 0, sizeof(MatchBuilder));
+    builder.tree = tree;
+    builder.fail = match_node_new(&builder, MATCH_NODE_FAIL);
+    builder.budget = MATCH_TREE_BUDGET * size + 1;
+    builder.memo_capacity = 64;
+    builder.memo = calloc(builder.memo_capacity, sizeof(MatchMemo));
+
+    tree->root = match_build(&builder, rows, row_count);
+    match_memo_free(&builder);
+
+    if (builder.budget == 0) {
+        // Too big: test the arms one after another, each failing into the next
+        builder.budget = -1;
+        for (int i = row_count - 1; i >= 0; i--) {
+            builder.fail = match_build(&builder, rows + i, 1);
+        }
+        tree->root = builder.fail;
+        builder.fail = builder.nodes[0];
+    }
+    match_free_rows(rows, row_count);
+
+    match_tree_link(tree, &builder);
+    for (int i = 0; i < builder.node_count; i++) {
+        if (builder.nodes[i]->order < 0) {
+            free(builder.nodes[i]->binds);
+            free(builder.nodes[i]);
+        }
+    }
+    free(builder.nodes);
+    return tree;
+}
+
+void match_tree_free(MatchTree* tree) {
+    if (!tree) return;
+
+    for (int i = 0; i < tree->node_count; i++) {
+        free(tree->nodes[i]->binds);
+        free(tree->nodes[i]);
+    }
+    free(tree->nodes);
+    free(tree->occurrences);
+    free(tree);
+}
@@ -0,0 +1,110 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include "ast.h"
+
+// Match exhaustiveness
+//
+// Atoms are open-ended, but a let binding can only hold the atoms its value
+// can produce: `let s = :ok` holds exactly :ok, and a let bound to a match
+// holds whatever its arms produce. For each match this pass records how many
+// arms are needed before one must match (match_expr.exhaustive_arms), either
+// because an unguarded arm covers the scrutinee's whole atom set or because
+// it is a wildcard. Codegen then makes that arm unconditional and drops the
+// runtime fallback. A match on a known atom set that misses some of its
+// atoms is reported on stderr.
+
+// Returns the number of non-exhaustive matches reported
+int match_check_exhaustive(ASTNode* program);
+
+// Decision trees
+//
+// Matches with array, object or binding patterns are compiled into a tree of
+// tests. Each test is on one occurrence (the scrutinee or a part of it), and
+// every arm still possible after its outcome is carried into the branch, so
+// along any path each field is read and each test made at most once.
+//
+// Branches left with the same arms and tests share one node, making the tree
+// a DAG: a shared node is generated once, after a labelled block owned by
+// the node every path to it passes through, and its references break out of
+// that block. Past MATCH_TREE_BUDGET nodes per pattern node the arms are
+// tested one after another instead, each failing into the next.
+
+typedef enum {
+    MATCH_ROOT,             // The scrutinee
+    MATCH_FIELD,            // parent.key
+    MATCH_INDEX,            // parent[index]
+    MATCH_LENGTH            // parent.length
+} MatchAccess;
+
+typedef struct {
+    int parent;             // -1 for the scrutinee
+    MatchAccess access;
+    const char* key;
+    int index;
+} MatchOccurrence;
+
+typedef enum {
+    MATCH_TEST_EQUALS,      // occurrence === value
+    MATCH_TEST_ARRAY,       // Array.isArray(occurrence)
+    MATCH_TEST_OBJECT,      // occurrence is a non-null object
+    MATCH_TEST_LENGTH,      // occurrence (a length) === count
+    MATCH_TEST_MIN_LENGTH   // occurrence (a length) >= count
+} MatchTest;
+
+typedef struct {
+    const char* name;
+    int occurrence;
+    int rest_from;          // >= 0: binds occurrence.slice(rest_from)
+} MatchBind;
+
+typedef enum {
+    MATCH_NODE_FAIL,        // No arm matches
+    MATCH_NODE_TEST,
+    MATCH_NODE_LEAF
+} MatchNodeKind;
+
+typedef struct MatchNode MatchNode;
+struct MatchNode {
+    MatchNodeKind kind;
+    
+    MatchTest test;
+    int occurrence;
+    ASTNode* value;         // MATCH_TEST_EQUALS
+    int count;              // MATCH_TEST_LENGTH, MATCH_TEST_MIN_LENGTH
+    MatchNode* then_branch;
+    MatchNode* else_branch;
+    
+    ASTNode* arm;
+    MatchBind* binds;
+    int bind_count;
+    MatchNode* next;        // Tried when the arm's guard fails
+    
+    int refs;               // Branches leading here
+    int shared;             // Generated once and branched to, rather than at each branch
+    int order;              // Index in reverse postorder from the root
+    MatchNode* owner;       // Immediate dominator: every path here passes through it
+    MatchNode* owned;       // Shared nodes this one owns, outermost block first
+    MatchNode* owned_next;
+};
+
+typedef struct {
+    MatchOccurrence* occurrences;
+    int occurrence_count;
+    int occurrence_capacity;
+    MatchNode* root;
+    MatchNode** nodes;      // Every node once, by order
+    int node_count;
+    int can_fail;           // Some path reaches MATCH_NODE_FAIL
+    int shared;             // Some node is shared
+} MatchTree;
+
+#define MATCH_TREE_BUDGET 8
+
+// Whether a match has patterns that need a decision tree; literal, atom and
+// wildcard arms are lowered as a chain of comparisons instead
+int match_needs_tree(ASTNode* match);
+MatchTree* match_tree_build(ASTNode* match);
+void match_tree_free(MatchTree* tree);
+
+#endif
@@ -0,0 +1,258 @@
+#include "parallel.h"
+#include "parser.h"
+#include "trace.h"
+#include <pthread.h>
+#include <unistd.h>
+
+int parallel_default_threads(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+typedef struct {
+    pthread_mutex_t lock;
+    int next;
+    int count;
+    ParallelTask task;
+    void* context;
+} ParallelJob;
+
+static void* parallel_worker(void* arg) {
+    ParallelJob* job = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job->lock);
+        int index = job->next++;
+        pthread_mutex_unlock(&job->lock);
+
+        if (index >= job->count) break;
+        job->task(job->context, index);
+    }
+
+    return NULL;
+}
+
+void parallel_for(int count, int thread_count, ParallelTask task, void* context) {
+    if (thread_count > count) {
+        thread_count = count;
+    }
+
+    if (thread_count <= 1) {
+        for (int i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+
+    ParallelJob job;
+    pthread_mutex_init(&job.lock, NULL);
+    job.next = 0;
+    job.count = count;
+    job.task = task;
+    job.context = context;
+
+    // The calling thread is one of the workers
+    pthread_t* threads = malloc((thread_count - 1) * sizeof(pthread_t));
+    int started = 0;
+    for (int i = 0; i < thread_count - 1; i++) {
+        if (pthread_create(&threads[started], NULL, parallel_worker, &job) == 0) {
+            started++;
+        }
+    }
+
+    parallel_worker(&job);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    free(threads);
+    pthread_mutex_destroy(&job.lock);
+}
+
+typedef struct {
+    ParallelCall call;
+    void* context;
+} ParallelContinuation;
+
+static void* parallel_continue(void* arg) {
+    ParallelContinuation* continuation = arg;
+    continuation->call(continuation->context);
+    return NULL;
+}
+
+void parallel_call_on_new_stack(ParallelCall call, void* context) {
+    ParallelContinuation continuation = { call, context };
+    pthread_attr_t attributes;
+    pthread_t thread;
+
+    pthread_attr_init(&attributes);
+    pthread_attr_setstacksize(&attributes, PARALLEL_STACK_SIZE);
+    int started = pthread_create(&thread, &attributes, parallel_continue, &continuation) == 0;
+    pthread_attr_destroy(&attributes);
+
+    if (started) {
+        pthread_join(thread, NULL);
+    } else {
+        call(context);
+    }
+}
+
+static int parallel_starts_declaration(const char* source, int pos, int length) {
+    static const char* keywords[] = { "struct", "trait", "impl", "let", "import", "export", NULL };
+
+    for (int i = 0; keywords[i]; i++) {
+        int keyword_length = strlen(keywords[i]);
+        if (pos + keyword_length < length &&
+            strncmp(source + pos, keywords[i], keyword_length) == 0 &&
+            (source[pos + keyword_length] == ' ' || source[pos + keyword_length] == '\t')) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+SourceChunk* parallel_split_declarations(const char* source, int length, int max_chunks, int* chunk_count) {
+    int target_size = max_chunks > 0 ? length / max_chunks : length;
+    int capacity = 16;
+    SourceChunk* chunks = malloc(capacity * sizeof(SourceChunk));
+
+    chunks[0].start = 0;
+    chunks[0].line = 1;
+    *chunk_count = 1;
+
+    int depth = 0;
+    int in_string = 0;
+    int line = 1;
+
+    for (int i = 0; i < length; i++) {
+        char c = source[i];
+
+        // A declaration keyword at the start of a line, outside any brackets or strings
+        if ((i == 0 || source[i - 1] == '\n') && depth == 0 && !in_string) {
+            int j = i;
+            while (j < length && (source[j] == ' ' || source[j] == '\t')) j++;
+
+            SourceChunk* current = &chunks[*chunk_count - 1];
+            if (i > current->start && i - current->start >= target_size &&
+                parallel_starts_declaration(source, j, length)) {
+                if (*chunk_count >= capacity) {
+                    capacity *= 2;
+                    chunks = realloc(chunks, capacity * sizeof(SourceChunk));
+                }
+                chunks[*chunk_count - 1].end = i;
+                chunks[*chunk_count].start = i;
+                chunks[*chunk_count].line = line;
+                (*chunk_count)++;
+            }
+        }
+
+        if (c == '\n') {
+            line++;
+        } else if (in_string) {
+            if (c == '\\' && i + 1 < length) {
+                if (source[i + 1] == '\n') line++;
+                i++;
+            } else if (c == '"') {
+                in_string = 0;
+            }
+        } else if (c == '"') {
+            in_string = 1;
+        } else if (c == '{' || c == '(' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ')' || c == ']') {
+            depth--;
+        }
+    }
+
+    chunks[*chunk_count - 1].end = length;
+    return chunks;
+}
+
+typedef struct {
+    const char* source;
+    SourceChunk* chunks;
+    ASTNode** programs;
+    SymbolTable** symbols;
+    int* failed;
+} ParseChunkJob;
+
+static void parallel_parse_chunk(void* context, int index) {
+    ParseChunkJob* job = context;
+    SourceChunk* chunk = &job->chunks[index];
+
+    TraceSpan span = trace_begin("lex");
+    Lexer* lexer = lexer_new_range(job->source, chunk->start, chunk->end, chunk->line);
+    TokenBuffer* buffer = token_buffer_lex(lexer);
+    trace_end(span, NULL);
+
+    span = trace_begin("parse");
+    Parser* parser = parser_new_buffered(buffer);
+    parser->silent = 1;
+
+    job->programs[index] = parser_parse(parser);
+    trace_end(span, NULL);
+    job->failed[index] = !job->programs[index] || parser_has_errors(parser);
+
+    // Keep the chunk's symbol table for merging
+    job->symbols[index] = parser->symbols;
+    parser->symbols = NULL;
+
+    parser_free(parser);
+    token_buffer_free(buffer);
+    lexer_free(lexer);
+}
+
+ASTNode* parallel_parse_program(const char* source, int thread_count, SymbolTable** symbols) {
+    int length = strlen(source);
+    int chunk_count = 0;
+    SourceChunk* chunks = parallel_split_declarations(source, length, thread_count * 4, &chunk_count);
+
+    if (chunk_count < 2) {
+        free(chunks);
+        return NULL;
+    }
+
+    ParseChunkJob job;
+    job.source = source;
+    job.chunks = chunks;
+    job.programs = calloc(chunk_count, sizeof(ASTNode*));
+    job.symbols = calloc(chunk_count, sizeof(SymbolTable*));
+    job.failed = calloc(chunk_count, sizeof(int));
+
+    parallel_for(chunk_count, thread_count, parallel_parse_chunk, &job);
+
+    int failed = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        failed |= job.failed[i];
+    }
+
+    ASTNode* program = NULL;
+    if (!failed) {
+        // Merge chunk ASTs and symbol tables in source order
+        ASTList* declarations = ast_list_new();
+        *symbols = symbols_new();
+
+        for (int i = 0; i < chunk_count; i++) {
+            ASTList* chunk_declarations = job.programs[i]->program.declarations;
+            for (int d = 0; d < chunk_declarations->count; d++) {
+                ast_list_add(declarations, chunk_declarations->nodes[d]);
+            }
+            chunk_declarations->count = 0;
+            symbols_append(*symbols, job.symbols[i]);
+        }
+
+        program = ast_create_program(declarations);
+    }
+
+    for (int i = 0; i < chunk_count; i++) {
+        ast_node_free(job.programs[i]);
+        symbols_free(job.symbols[i]);
+    }
+
+    free(job.failed);
+    free(job.symbols);
+    free(job.programs);
+    free(chunks);
+    return program;
+}
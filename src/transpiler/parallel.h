@@ -0,0 +1,48 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "ast.h"
+#include "symbols.h"
+
+// Sources smaller than this are always parsed on the calling thread
+#define PARALLEL_PARSE_MIN_SIZE (64 * 1024)
+
+// Programs with fewer top-level declarations are always generated on the calling thread
+#define PARALLEL_CODEGEN_MIN_DECLS 256
+
+// Recursive passes move to a fresh stack of PARALLEL_STACK_SIZE bytes every
+// PARALLEL_STACK_DEPTH levels, so nesting depth is bounded by memory rather
+// than by the calling thread's stack
+#define PARALLEL_STACK_DEPTH 256
+#define PARALLEL_STACK_SIZE (16 * 1024 * 1024)
+
+// Work item callback: invoked once for every index in [0, count)
+typedef void (*ParallelTask)(void* context, int index);
+
+// Continuation run by parallel_call_on_new_stack
+typedef void (*ParallelCall)(void* context);
+
+// A run of whole top-level declarations within the source
+typedef struct {
+    int start;
+    int end;
+    int line;
+} SourceChunk;
+
+// Thread pool helpers
+int parallel_default_threads(void);
+void parallel_for(int count, int thread_count, ParallelTask task, void* context);
+
+// Run call on a new thread with its own stack and wait for it to finish;
+// falls back to calling it directly if no thread can be started
+void parallel_call_on_new_stack(ParallelCall call, void* context);
+
+// Split source at top-level declaration boundaries into at most max_chunks chunks
+SourceChunk* parallel_split_declarations(const char* source, int length, int max_chunks, int* chunk_count);
+
+// Parse a whole program across threads. Returns NULL if the source does not split
+// or any chunk fails to parse; the caller then parses serially, which reports the
+// exact same diagnostics a serial run always would.
+ASTNode* parallel_parse_program(const char* source, int thread_count, SymbolTable** symbols);
+
+#endif
@@ -1,23 +1,65 @@
 #include "parser.h"
+#include "parallel.h"
+#include "types.h"
+#include "intern.h"
 
-Parser* parser_new(Lexer* lexer) {
+// Next token from whichever source the parser was created with
+static Token parser_next_raw(Parser* parser) {
+    if (parser->buffer) {
+        return token_buffer_next(parser->buffer);
+    }
+    if (parser->stream) {
+        return token_stream_next(parser->stream);
+    }
+    return lexer_next_token(parser->lexer);
+}
+
+static Parser* parser_init(Lexer* lexer, TokenBuffer* buffer, TokenStream* stream) {
     Parser* parser = malloc(sizeof(Parser));
     parser->lexer = lexer;
+    parser->buffer = buffer;
+    parser->stream = stream;
     parser->error_count = 0;
     parser->error_message = NULL;
+    parser->symbols = symbols_new();
+    parser->silent = 0;
+    parser->depth = 0;
+    parser->pattern_depth = 0;
+    parser->in_guard = 0;
+    parser->lookahead = NULL;
+    parser->lookahead_head = 0;
+    parser->lookahead_count = 0;
+    parser->lookahead_capacity = 0;
     
     // Initialize tokens
-    parser->current_token = lexer_next_token(lexer);
-    parser->peek_token = lexer_next_token(lexer);
+    parser->current_token = parser_next_raw(parser);
+    parser->peek_token = parser_next_raw(parser);
     
     return parser;
 }
 
+Parser* parser_new(Lexer* lexer) {
+    return parser_init(lexer, NULL, NULL);
+}
+
+Parser* parser_new_buffered(TokenBuffer* buffer) {
+    return parser_init(NULL, buffer, NULL);
+}
+
+Parser* parser_new_streamed(TokenStream* stream) {
+    return parser_init(NULL, NULL, stream);
+}
+
 void parser_free(Parser* parser) {
     if (parser) {
         token_free(&parser->current_token);
         token_free(&parser->peek_token);
+        for (int i = 0; i < parser->lookahead_count; i++) {
+            token_free(&parser->lookahead[(parser->lookahead_head + i) % parser->lookahead_capacity]);
+        }
+        free(parser->lookahead);
         free(parser->error_message);
+        symbols_free(parser->symbols);
         free(parser);
     }
 }
@@ -28,8 +70,10 @@ void parser_error(Parser* parser, const char* message) {
         free(parser->error_message);
     }
     parser->error_message = strdup(message);
-    printf("Parse error at line %d, column %d: %s\n", 
-           parser->current_token.line, parser->current_token.column, message);
+    if (!parser->silent) {
+        printf("Parse error at line %d, column %d: %s\n", 
+               parser->current_token.line, parser->current_token.column, message);
+    }
 }
 
 int parser_has_errors(Parser* parser) {
@@ -43,7 +87,44 @@ const char* parser_get_error(Parser* parser) {
 void parser_advance(Parser* parser) {
     token_free(&parser->current_token);
     parser->current_token = parser->peek_token;
-    parser->peek_token = lexer_next_token(parser->lexer);
+
+    if (parser->lookahead_count > 0) {
+        parser->peek_token = parser->lookahead[parser->lookahead_head];
+        parser->lookahead_head = (parser->lookahead_head + 1) % parser->lookahead_capacity;
+        parser->lookahead_count--;
+    } else {
+        parser->peek_token = parser_next_raw(parser);
+    }
+}
+
+// Token n positions ahead: 0 is current_token, 1 is peek_token
+const Token* parser_peek_nth(Parser* parser, int n) {
+    if (n == 0) return &parser->current_token;
+    if (n == 1) return &parser->peek_token;
+
+    int index = n - 2;
+    if (index >= parser->lookahead_capacity) {
+        // Grow the ring and unwrap it so queued tokens start at index 0
+        int capacity = parser->lookahead_capacity ? parser->lookahead_capacity : 8;
+        while (capacity <= index) capacity *= 2;
+
+        Token* lookahead = malloc(capacity * sizeof(Token));
+        for (int i = 0; i < parser->lookahead_count; i++) {
+            lookahead[i] = parser->lookahead[(parser->lookahead_head + i) % parser->lookahead_capacity];
+        }
+        free(parser->lookahead);
+        parser->lookahead = lookahead;
+        parser->lookahead_head = 0;
+        parser->lookahead_capacity = capacity;
+    }
+
+    while (parser->lookahead_count <= index) {
+        int tail = (parser->lookahead_head + parser->lookahead_count) % parser->lookahead_capacity;
+        parser->lookahead[tail] = parser_next_raw(parser);
+        parser->lookahead_count++;
+    }
+
+    return &parser->lookahead[(parser->lookahead_head + index) % parser->lookahead_capacity];
 }
 
 int parser_check(Parser* parser, TokenType type) {
@@ -69,6 +150,59 @@ void parser_expect(Parser* parser, TokenType type) {
     }
 }
 
+// Track recursive descent; on overflow the rest of the input is abandoned,
+// which stops every parse loop at EOF
+static int parser_enter_limited(Parser* parser, int* depth, int limit, const char* message) {
+    if (*depth >= limit) {
+        parser_error(parser, message);
+        while (!parser_check(parser, TOKEN_EOF)) {
+            parser_advance(parser);
+        }
+        return 0;
+    }
+    (*depth)++;
+    return 1;
+}
+
+static int parser_enter(Parser* parser) {
+    return parser_enter_limited(parser, &parser->depth, PARSER_MAX_DEPTH, "Expression nested too deeply");
+}
+
+typedef struct {
+    Parser* parser;
+    ASTNode* (*parse)(Parser* parser);
+    ASTNode* result;
+} ParserDescent;
+
+static void parser_descend_run(void* context) {
+    ParserDescent* descent = context;
+    descent->result = descent->parse(descent->parser);
+}
+
+// Parse one level deeper, continuing on a fresh stack every
+// PARALLEL_STACK_DEPTH levels
+static ASTNode* parser_descend(Parser* parser, ASTNode* (*parse)(Parser* parser)) {
+    if (!parser_enter(parser)) return NULL;
+    
+    ParserDescent descent = { parser, parse, NULL };
+    if (parser->depth % PARALLEL_STACK_DEPTH == 0) {
+        parallel_call_on_new_stack(parser_descend_run, &descent);
+    } else {
+        parser_descend_run(&descent);
+    }
+    parser->depth--;
+    return descent.result;
+}
+
+// Record where a node starts in the source, keeping any position it already has
+static ASTNode* parser_at(ASTNode* node, int line, int column) {
+    if (node && node->line == 0) {
+        node->line = line;
+        node->column = column;
+    }
+    return node;
+}
+
 // Skip newlines and comments
 static void parser_skip_noise(Parser* parser) {
     while (parser->current_token.type == TOKEN_NEWLINE || 
@@ -87,26 +221,58 @@ ASTNode* parser_parse_program(Parser* parser) {
     parser_skip_noise(parser);
     
     while (!parser_check(parser, TOKEN_EOF)) {
+        symbols_begin_decl(parser->symbols);
         ASTNode* decl = parser_parse_declaration(parser);
+        symbols_end_decl(parser->symbols, decl);
         if (decl) {
             ast_list_add(declarations, decl);
         }
         parser_skip_noise(parser);
+        
+        // A silent parse is only a fast path; the caller reparses to report errors
+        if (parser->silent && parser->error_count > 0) break;
     }
     
     return ast_create_program(declarations);
 }
 
+// A contextual keyword such as `from` or `as`, lexed as an identifier
+static int parser_check_word(Parser* parser, const char* word) {
+    return parser_check(parser, TOKEN_IDENTIFIER) && strcmp(parser->current_token.value, word) == 0;
+}
+
 ASTNode* parser_parse_declaration(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    
     switch (parser->current_token.type) {
         case TOKEN_STRUCT:
-            return parser_parse_struct_decl(parser);
+            return parser_at(parser_parse_struct_decl(parser), line, column);
         case TOKEN_TRAIT:
-            return parser_parse_trait_decl(parser);
+            return parser_at(parser_parse_trait_decl(parser), line, column);
         case TOKEN_IMPL:
-            return parser_parse_impl_block(parser);
+            return parser_at(parser_parse_impl_block(parser), line, column);
         case TOKEN_LET:
-            return parser_parse_let_binding(parser);
+            return parser_at(parser_parse_let_binding(parser), line, column);
+        case TOKEN_IMPORT:
+            // `import(...)` is an expression
+            if (parser->peek_token.type == TOKEN_LPAREN) {
+                return parser_parse_expression(parser);
+            }
+            return parser_at(parser_parse_import_decl(parser), line, column);
+        case TOKEN_EXPORT:
+            return parser_at(parser_parse_export_decl(parser), line, column);
+        case TOKEN_IDENTIFIER:
+            // `lazy` is only a keyword before a top-level let
+            if (parser_check_word(parser, "lazy") && parser->peek_token.type == TOKEN_LET) {
+                parser_advance(parser);
+                ASTNode* binding = parser_parse_let_binding(parser);
+                if (binding && binding->let_binding.value) {
+                    binding->let_binding.value = ast_create_lazy_expr(binding->let_binding.value);
+                }
+                return parser_at(binding, line, column);
+            }
+            return parser_parse_expression(parser);
         default:
             return parser_parse_expression(parser);
     }
@@ -120,7 +286,7 @@ ASTNode* parser_parse_struct_decl(Parser* parser) {
         return NULL;
     }
     
-    char* name = strdup(parser->current_token.value);
+    const char* name = parser->current_token.value;
     parser_advance(parser);
     
     ASTList* generic_params = NULL;
@@ -149,7 +315,7 @@ ASTNode* parser_parse_trait_decl(Parser* parser) {
         return NULL;
     }
     
-    char* name = strdup(parser->current_token.value);
+    const char* name = parser->current_token.value;
     parser_advance(parser);
     
     ASTList* generic_params = NULL;
@@ -164,7 +330,9 @@ ASTNode* parser_parse_trait_decl(Parser* parser) {
     parser_skip_noise(parser);
     while (!parser_check(parser, TOKEN_RBRACE) && !parser_check(parser, TOKEN_EOF)) {
         if (parser_check(parser, TOKEN_IDENTIFIER)) {
-            char* method_name = strdup(parser->current_token.value);
+            int line = parser->current_token.line;
+            int column = parser->current_token.column;
+            const char* method_name = parser->current_token.value;
             parser_advance(parser);
             
             parser_expect(parser, TOKEN_LPAREN);
@@ -178,10 +346,8 @@ ASTNode* parser_parse_trait_decl(Parser* parser) {
             
             parser_expect(parser, TOKEN_SEMICOLON);
             
-            ASTNode* method = ast_create_method_decl(method_name, params, return_type, NULL);
+            ASTNode* method = parser_at(ast_create_method_decl(method_name, params, return_type, NULL), line, column);
             ast_list_add(methods, method);
-            
-            free(method_name);
         } else {
             parser_error(parser, "Expected method declaration");
             break;
@@ -203,22 +369,22 @@ ASTNode* parser_parse_impl_block(Parser* parser) {
         parser_expect(parser, TOKEN_RANGLE);
     }
     
-    char* trait_name = NULL;
-    char* type_name = NULL;
+    const char* trait_name = NULL;
+    const char* type_name = NULL;
     
     if (parser_check(parser, TOKEN_IDENTIFIER)) {
-        char* first_name = strdup(parser->current_token.value);
+        const char* first_name = parser->current_token.value;
         parser_advance(parser);
         
         if (parser_match(parser, TOKEN_FOR)) {
             // impl TraitName for TypeName
             trait_name = first_name;
+            symbols_add_reference(parser->symbols, trait_name);
             if (parser_check(parser, TOKEN_IDENTIFIER)) {
-                type_name = strdup(parser->current_token.value);
+                type_name = parser->current_token.value;
                 parser_advance(parser);
             } else {
                 parser_error(parser, "Expected type name after 'for'");
-                free(first_name);
                 return NULL;
             }
         } else {
@@ -229,6 +395,7 @@ ASTNode* parser_parse_impl_block(Parser* parser) {
         parser_error(parser, "Expected identifier in impl block");
         return NULL;
     }
+    symbols_add_reference(parser->symbols, type_name);
     
     parser_expect(parser, TOKEN_LBRACE);
     ASTList* methods = ast_list_new();
@@ -236,7 +403,9 @@ ASTNode* parser_parse_impl_block(Parser* parser) {
     parser_skip_noise(parser);
     while (!parser_check(parser, TOKEN_RBRACE) && !parser_check(parser, TOKEN_EOF)) {
         if (parser_check(parser, TOKEN_IDENTIFIER)) {
-            char* method_name = strdup(parser->current_token.value);
+            int line = parser->current_token.line;
+            int column = parser->current_token.column;
+            const char* method_name = parser->current_token.value;
             parser_advance(parser);
             
             parser_expect(parser, TOKEN_LPAREN);
@@ -250,10 +419,8 @@ ASTNode* parser_parse_impl_block(Parser* parser) {
             
             ASTNode* body = parser_parse_block(parser);
             
-            ASTNode* method = ast_create_method_decl(method_name, params, return_type, body);
+            ASTNode* method = parser_at(ast_create_method_decl(method_name, params, return_type, body), line, column);
             ast_list_add(methods, method);
-            
-            free(method_name);
         } else {
             parser_error(parser, "Expected method declaration");
             break;
@@ -266,6 +433,97 @@ ASTNode* parser_parse_impl_block(Parser* parser) {
     return ast_create_impl_block(trait_name, type_name, generic_params, methods);
 }
 
+// import name, import * as name, import { a, b as c }, or a default
+// import followed by one of the other two, then from "source";
+// `import "source"` only runs the module
+ASTNode* parser_parse_import_decl(Parser* parser) {
+    parser_expect(parser, TOKEN_IMPORT);
+    ASTList* specifiers = ast_list_new();
+    
+    if (!parser_check(parser, TOKEN_STRING)) {
+        int more = 1;
+        if (parser_check(parser, TOKEN_IDENTIFIER)) {
+            ast_list_add(specifiers, ast_create_import_specifier("default", parser->current_token.value));
+            parser_advance(parser);
+            more = parser_match(parser, TOKEN_COMMA);
+        }
+        
+        if (more && parser_match(parser, TOKEN_STAR)) {
+            if (parser_check_word(parser, "as")) {
+                parser_advance(parser);
+            } else {
+                parser_error(parser, "Expected 'as' after '*'");
+            }
+            if (parser_check(parser, TOKEN_IDENTIFIER)) {
+                ast_list_add(specifiers, ast_create_import_specifier("*", parser->current_token.value));
+                parser_advance(parser);
+            } else {
+                parser_error(parser, "Expected namespace name");
+            }
+        } else if (more && parser_match(parser, TOKEN_LBRACE)) {
+            parser_skip_noise(parser);
+            while (parser_check(parser, TOKEN_IDENTIFIER)) {
+                const char* imported = parser->current_token.value;
+                const char* local = imported;
+                parser_advance(parser);
+                if (parser_check_word(parser, "as") && parser->peek_token.type == TOKEN_IDENTIFIER) {
+                    parser_advance(parser);
+                    local = parser->current_token.value;
+                    parser_advance(parser);
+                }
+                ast_list_add(specifiers, ast_create_import_specifier(imported, local));
+                
+                parser_skip_noise(parser);
+                if (!parser_match(parser, TOKEN_COMMA)) break;
+                parser_skip_noise(parser);
+            }
+            parser_expect(parser, TOKEN_RBRACE);
+        } else if (more) {
+            parser_error(parser, "Expected import specifiers");
+        }
+        
+        if (parser_check_word(parser, "from")) {
+            parser_advance(parser);
+        } else {
+            parser_error(parser, "Expected 'from'");
+        }
+    }
+    
+    // String values are freed on advance
+    const char* source = "";
+    if (parser_check(parser, TOKEN_STRING)) {
+        source = intern(parser->current_token.value);
+        parser_advance(parser);
+    } else {
+        parser_error(parser, "Expected module path");
+    }
+    
+    return ast_create_import_decl(source, specifiers);
+}
+
+// export followed by a let, lazy let, struct, trait or impl, or
+// export default followed by an expression
+ASTNode* parser_parse_export_decl(Parser* parser) {
+    parser_expect(parser, TOKEN_EXPORT);
+    
+    if (parser_check_word(parser, "default")) {
+        parser_advance(parser);
+        ASTNode* value = parser_parse_expression(parser);
+        return value ? ast_create_export_default(value) : NULL;
+    }
+    
+    int declaration = parser_check(parser, TOKEN_LET) || parser_check(parser, TOKEN_STRUCT) ||
+                      parser_check(parser, TOKEN_TRAIT) || parser_check(parser, TOKEN_IMPL) ||
+                      (parser_check_word(parser, "lazy") && parser->peek_token.type == TOKEN_LET);
+    if (!declaration) {
+        parser_error(parser, "Expected a declaration after 'export'");
+        return NULL;
+    }
+    
+    ASTNode* decl = parser_parse_declaration(parser);
+    return decl ? ast_create_export_decl(decl) : NULL;
+}
+
 ASTNode* parser_parse_let_binding(Parser* parser) {
     parser_expect(parser, TOKEN_LET);
     
@@ -274,7 +532,7 @@ ASTNode* parser_parse_let_binding(Parser* parser) {
         return NULL;
     }
     
-    char* name = strdup(parser->current_token.value);
+    const char* name = parser->current_token.value;
     parser_advance(parser);
     
     ASTNode* type_annotation = NULL;
@@ -289,32 +547,144 @@ ASTNode* parser_parse_let_binding(Parser* parser) {
 }
 
 ASTNode* parser_parse_expression(Parser* parser) {
-    return parser_parse_pipe_expression(parser);
+    return parser_descend(parser, parser_parse_pipe_expression);
 }
 
 ASTNode* parser_parse_pipe_expression(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
     ASTNode* expr = parser_parse_match_expression(parser);
     
-    while (parser_match(parser, TOKEN_PIPE)) {
+    while (parser_check(parser, TOKEN_PIPE) || parser_check(parser, TOKEN_LAZY_PIPE)) {
+        int lazy = parser_check(parser, TOKEN_LAZY_PIPE);
+        parser_advance(parser);
         ASTNode* right = parser_parse_match_expression(parser);
-        expr = ast_create_pipe_expr(expr, right);
+        if (lazy && right && right->type == AST_AWAIT_EXPR) {
+            // Lazy stages run inside a synchronous generator
+            parser_error(parser, "Cannot await a lazy pipe stage");
+        }
+        expr = parser_at(lazy ? ast_create_lazy_pipe_expr(expr, right) : ast_create_pipe_expr(expr, right), line, column);
     }
     
     return expr;
 }
 
 ASTNode* parser_parse_match_expression(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    
     if (parser_match(parser, TOKEN_MATCH)) {
         ASTNode* expr = parser_parse_primary(parser);
         parser_expect(parser, TOKEN_LBRACE);
         ASTList* arms = parser_parse_match_arms(parser);
         parser_expect(parser, TOKEN_RBRACE);
-        return ast_create_match_expr(expr, arms);
+        return parser_at(ast_create_match_expr(expr, arms), line, column);
     }
     
     return parser_parse_primary(parser);
 }
 
+// At `(`: a parameter list rather than a parenthesized expression. `()`,
+// `(a,` and `(a:` can only start one; `(a)` does when `=>` or a return type
+// follows, except in a guard, where `=>` ends the guard.
+static int parser_at_lambda(Parser* parser) {
+    const Token* first = parser_peek_nth(parser, 1);
+    if (first->type == TOKEN_RPAREN) return 1;
+    if (first->type != TOKEN_IDENTIFIER) return 0;
+    
+    TokenType second = parser_peek_nth(parser, 2)->type;
+    if (second == TOKEN_COMMA || second == TOKEN_COLON) return 1;
+    if (second != TOKEN_RPAREN || parser->in_guard) return 0;
+    
+    TokenType third = parser_peek_nth(parser, 3)->type;
+    return third == TOKEN_ARROW || third == TOKEN_COLON;
+}
+
+// At `{`: an object literal rather than a block, when it starts with
+// `key:` or `key,`. `{}` and `{ x }` stay blocks.
+static int parser_at_object_literal(Parser* parser) {
+    int n = 1;
+    while (parser_peek_nth(parser, n)->type == TOKEN_NEWLINE || parser_peek_nth(parser, n)->type == TOKEN_COMMENT) {
+        n++;
+    }
+    
+    TokenType key = parser_peek_nth(parser, n)->type;
+    if (key != TOKEN_IDENTIFIER && key != TOKEN_STRING) return 0;
+    
+    TokenType next = parser_peek_nth(parser, n + 1)->type;
+    return next == TOKEN_COLON || (next == TOKEN_COMMA && key == TOKEN_IDENTIFIER);
+}
+
+// [a, b] and { key: value, "key": value, key }; newlines and a trailing comma are allowed
+static ASTNode* parser_parse_collection_literal(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    int array = parser_check(parser, TOKEN_LBRACKET);
+    TokenType close = array ? TOKEN_RBRACKET : TOKEN_RBRACE;
+    parser_advance(parser);
+    
+    ASTList* items = ast_list_new();
+    parser_skip_noise(parser);
+    
+    while (!parser_check(parser, close) && !parser_check(parser, TOKEN_EOF)) {
+        ASTNode* item;
+        if (array) {
+            item = parser_parse_expression(parser);
+        } else {
+            int item_line = parser->current_token.line;
+            int item_column = parser->current_token.column;
+            if (!parser_check(parser, TOKEN_IDENTIFIER) && !parser_check(parser, TOKEN_STRING)) {
+                parser_error(parser, "Expected property name");
+                break;
+            }
+            // String token values are freed on advance
+            int shorthand = parser_check(parser, TOKEN_IDENTIFIER);
+            const char* key = intern(parser->current_token.value);
+            parser_advance(parser);
+            
+            ASTNode* value;
+            if (parser_match(parser, TOKEN_COLON)) {
+                value = parser_parse_expression(parser);
+            } else if (shorthand) {
+                value = parser_at(ast_create_identifier(key), item_line, item_column);
+                symbols_add_reference(parser->symbols, value->identifier.name);
+            } else {
+                parser_error(parser, "Expected ':' after property name");
+                break;
+            }
+            item = value ? parser_at(ast_create_property(key, value), item_line, item_column) : NULL;
+        }
+        if (!item) break;
+        ast_list_add(items, item);
+        
+        parser_skip_noise(parser);
+        if (!parser_match(parser, TOKEN_COMMA)) break;
+        parser_skip_noise(parser);
+    }
+    
+    parser_expect(parser, close);
+    ASTNode* literal = array ? ast_create_array_literal(items) : ast_create_object_literal(items);
+    return parser_at(literal, line, column);
+}
+
+// (a: A, b): R => body
+static ASTNode* parser_parse_lambda(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    parser_expect(parser, TOKEN_LPAREN);
+    ASTList* params = parser_parse_parameter_list(parser);
+    parser_expect(parser, TOKEN_RPAREN);
+    
+    ASTNode* return_type = NULL;
+    if (parser_match(parser, TOKEN_COLON)) {
+        return_type = parser_parse_type_annotation(parser);
+    }
+    
+    parser_expect(parser, TOKEN_ARROW);
+    ASTNode* body = parser_parse_expression(parser);
+    return parser_at(ast_create_function_decl(NULL, params, return_type, body), line, column);
+}
+
 ASTNode* parser_parse_primary(Parser* parser) {
     switch (parser->current_token.type) {
         case TOKEN_IDENTIFIER:
@@ -324,13 +694,37 @@ ASTNode* parser_parse_primary(Parser* parser) {
         case TOKEN_ATOM:
             return parser_parse_literal(parser);
         case TOKEN_LPAREN: {
+            if (parser_at_lambda(parser)) {
+                return parser_parse_lambda(parser);
+            }
             parser_advance(parser);
             ASTNode* expr = parser_parse_expression(parser);
             parser_expect(parser, TOKEN_RPAREN);
             return expr;
         }
         case TOKEN_LBRACE:
-            return parser_parse_block(parser);
+        case TOKEN_LBRACKET: {
+            if (parser_check(parser, TOKEN_LBRACE) && !parser_at_object_literal(parser)) {
+                return parser_parse_block(parser);
+            }
+            return parser_descend(parser, parser_parse_collection_literal);
+        }
+        case TOKEN_IMPORT:
+            // `import(...)` loads a module at runtime and is an ordinary call
+            if (parser->peek_token.type == TOKEN_LPAREN) {
+                parser->current_token.type = TOKEN_IDENTIFIER;
+                return parser_parse_identifier(parser);
+            }
+            parser_error(parser, "Unexpected token in expression");
+            return NULL;
+        case TOKEN_AWAIT: {
+            // await binds to one operand: `await f x |> g` is g(await f(x))
+            int line = parser->current_token.line;
+            int column = parser->current_token.column;
+            parser_advance(parser);
+            ASTNode* argument = parser_descend(parser, parser_parse_primary);
+            return parser_at(ast_create_await_expr(argument), line, column);
+        }
         default:
             parser_error(parser, "Unexpected token in expression");
             return NULL;
@@ -343,9 +737,19 @@ ASTNode* parser_parse_identifier(Parser* parser) {
         return NULL;
     }
     
-    char* name = strdup(parser->current_token.value);
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    const char* name = parser->current_token.value;
     parser_advance(parser);
-    ASTNode* identifier = ast_create_identifier(name);
+    ASTNode* identifier = parser_at(ast_create_identifier(name), line, column);
+    symbols_add_reference(parser->symbols, name);
+    
+    // Member access: object.member.member
+    while (parser_check(parser, TOKEN_DOT) && parser->peek_token.type == TOKEN_IDENTIFIER) {
+        parser_advance(parser); // consume '.'
+        identifier = parser_at(ast_create_member_access(identifier, parser->current_token.value), line, column);
+        parser_advance(parser);
+    }
     
     // Check for function call - either with parentheses or optional parentheses
     if (parser_check(parser, TOKEN_LPAREN)) {
@@ -363,7 +767,7 @@ ASTNode* parser_parse_identifier(Parser* parser) {
         }
         
         parser_expect(parser, TOKEN_RPAREN);
-        return ast_create_call_expr(identifier, args);
+        return parser_at(ast_create_call_expr(identifier, args), line, column);
     } else if (parser_check(parser, TOKEN_IDENTIFIER) || 
                parser_check(parser, TOKEN_NUMBER) || 
                parser_check(parser, TOKEN_STRING) ||
@@ -373,7 +777,6 @@ ASTNode* parser_parse_identifier(Parser* parser) {
         if (strcmp(name, "match") == 0 || strcmp(name, "let") == 0 || 
             strcmp(name, "struct") == 0 || strcmp(name, "trait") == 0 ||
             strcmp(name, "impl") == 0) {
-            free(name);
             return identifier;
         }
         
@@ -392,30 +795,31 @@ ASTNode* parser_parse_identifier(Parser* parser) {
             }
         }
         
-        free(name);
-        return ast_create_call_expr(identifier, args);
+        return parser_at(ast_create_call_expr(identifier, args), line, column);
     }
     
-    free(name);
     return identifier;
 }
 
 ASTNode* parser_parse_literal(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    
     switch (parser->current_token.type) {
         case TOKEN_NUMBER: {
-            char* value = strdup(parser->current_token.value);
+            ASTNode* node = ast_create_number_literal(parser->current_token.value);
             parser_advance(parser);
-            return ast_create_number_literal(value);
+            return parser_at(node, line, column);
         }
         case TOKEN_STRING: {
-            char* value = strdup(parser->current_token.value);
+            ASTNode* node = ast_create_string_literal(parser->current_token.value);
             parser_advance(parser);
-            return ast_create_string_literal(value);
+            return parser_at(node, line, column);
         }
         case TOKEN_ATOM: {
-            char* value = strdup(parser->current_token.value);
+            ASTNode* node = ast_create_atom_literal(parser->current_token.value);
             parser_advance(parser);
-            return ast_create_atom_literal(value);
+            return parser_at(node, line, column);
         }
         default:
             parser_error(parser, "Expected literal");
@@ -424,6 +828,8 @@ ASTNode* parser_parse_literal(Parser* parser) {
 }
 
 ASTNode* parser_parse_block(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
     parser_expect(parser, TOKEN_LBRACE);
     
     ASTList* statements = ast_list_new();
@@ -438,34 +844,35 @@ ASTNode* parser_parse_block(Parser* parser) {
     }
     
     parser_expect(parser, TOKEN_RBRACE);
-    return ast_create_block(statements);
+    return parser_at(ast_create_block(statements), line, column);
 }
 
+// Types are hash-consed: identical annotations return the same shared node
 ASTNode* parser_parse_type_annotation(Parser* parser) {
     if (!parser_check(parser, TOKEN_IDENTIFIER)) {
         parser_error(parser, "Expected type name");
         return NULL;
     }
     
-    ASTNode* node = ast_node_new(AST_TYPE_ANNOTATION);
-    node->type_annotation.type_name = strdup(parser->current_token.value);
+    const char* type_name = parser->current_token.value;
+    symbols_add_reference(parser->symbols, type_name);
     parser_advance(parser);
     
     // Handle generic arguments
+    ASTList* generic_args = NULL;
     if (parser_match(parser, TOKEN_LANGLE)) {
-        node->type_annotation.generic_args = ast_list_new();
-        
+        generic_args = ast_list_new();
         do {
-            ASTNode* arg = parser_parse_type_annotation(parser);
+            ASTNode* arg = parser_descend(parser, parser_parse_type_annotation);
             if (arg) {
-                ast_list_add(node->type_annotation.generic_args, arg);
+                ast_list_add(generic_args, arg);
             }
         } while (parser_match(parser, TOKEN_COMMA));
         
         parser_expect(parser, TOKEN_RANGLE);
     }
     
-    return node;
+    return types_get(type_name, generic_args);
 }
 
 ASTList* parser_parse_generic_params(Parser* parser) {
@@ -473,7 +880,8 @@ ASTList* parser_parse_generic_params(Parser* parser) {
     
     do {
         if (parser_check(parser, TOKEN_IDENTIFIER)) {
-            ASTNode* param = ast_create_identifier(parser->current_token.value);
+            ASTNode* param = parser_at(ast_create_identifier(parser->current_token.value),
+                                       parser->current_token.line, parser->current_token.column);
             ast_list_add(params, param);
             parser_advance(parser);
         } else {
@@ -495,7 +903,9 @@ ASTList* parser_parse_parameter_list(Parser* parser) {
     
     do {
         if (parser_check(parser, TOKEN_IDENTIFIER)) {
-            char* name = strdup(parser->current_token.value);
+            int line = parser->current_token.line;
+            int column = parser->current_token.column;
+            const char* name = parser->current_token.value;
             parser_advance(parser);
             
             ASTNode* type_annotation = NULL;
@@ -503,7 +913,7 @@ ASTList* parser_parse_parameter_list(Parser* parser) {
                 type_annotation = parser_parse_type_annotation(parser);
             }
             
-            ASTNode* param = ast_node_new(AST_PARAM_DECL);
+            ASTNode* param = parser_at(ast_node_new(AST_PARAM_DECL), line, column);
             param->param_decl.name = name;
             param->param_decl.type_annotation = type_annotation;
             
@@ -523,17 +933,17 @@ ASTList* parser_parse_field_list(Parser* parser) {
     parser_skip_noise(parser);
     while (!parser_check(parser, TOKEN_RBRACE) && !parser_check(parser, TOKEN_EOF)) {
         if (parser_check(parser, TOKEN_IDENTIFIER)) {
-            char* name = strdup(parser->current_token.value);
+            int line = parser->current_token.line;
+            int column = parser->current_token.column;
+            const char* name = parser->current_token.value;
             parser_advance(parser);
             
             parser_expect(parser, TOKEN_COLON);
             ASTNode* type_annotation = parser_parse_type_annotation(parser);
             parser_expect(parser, TOKEN_SEMICOLON);
             
-            ASTNode* field = ast_create_field_decl(name, type_annotation);
+            ASTNode* field = parser_at(ast_create_field_decl(name, type_annotation), line, column);
             ast_list_add(fields, field);
-            
-            free(name);
         } else {
             parser_error(parser, "Expected field name");
             break;
@@ -560,17 +970,21 @@ ASTList* parser_parse_match_arms(Parser* parser) {
 }
 
 ASTNode* parser_parse_match_arm(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
     ASTNode* pattern = parser_parse_pattern(parser);
     
     ASTNode* guard = NULL;
     if (parser_match(parser, TOKEN_WHEN)) {
+        parser->in_guard++;
         guard = parser_parse_expression(parser);
+        parser->in_guard--;
     }
     
     parser_expect(parser, TOKEN_ARROW);
     ASTNode* body = parser_parse_expression(parser);
     
-    ASTNode* arm = ast_node_new(AST_MATCH_ARM);
+    ASTNode* arm = parser_at(ast_node_new(AST_MATCH_ARM), line, column);
     arm->match_arm.pattern = pattern;
     arm->match_arm.guard = guard;
     arm->match_arm.body = body;
@@ -578,17 +992,115 @@ ASTNode* parser_parse_match_arm(Parser* parser) {
     return arm;
 }
 
+// [p, q, ...rest]
+static ASTNode* parser_parse_array_pattern(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    parser_expect(parser, TOKEN_LBRACKET);
+    
+    ASTList* elements = ast_list_new();
+    const char* rest = NULL;
+    parser_skip_noise(parser);
+    
+    while (!parser_check(parser, TOKEN_RBRACKET) && !parser_check(parser, TOKEN_EOF)) {
+        if (parser_check(parser, TOKEN_DOT)) {
+            // The rest binding takes whatever elements remain, so it comes last
+            for (int i = 0; i < 3; i++) {
+                parser_expect(parser, TOKEN_DOT);
+            }
+            if (parser_check(parser, TOKEN_IDENTIFIER) || parser_check(parser, TOKEN_UNDERSCORE)) {
+                rest = parser->current_token.value;
+                parser_advance(parser);
+            } else {
+                parser_error(parser, "Expected rest binding");
+            }
+            parser_skip_noise(parser);
+            break;
+        }
+        
+        ASTNode* element = parser_parse_pattern(parser);
+        if (!element) break;
+        ast_list_add(elements, element);
+        
+        parser_skip_noise(parser);
+        if (!parser_match(parser, TOKEN_COMMA)) break;
+        parser_skip_noise(parser);
+    }
+    
+    parser_expect(parser, TOKEN_RBRACKET);
+    return parser_at(ast_create_array_pattern(elements, rest), line, column);
+}
+
+// { key: p, key }
+static ASTNode* parser_parse_object_pattern(Parser* parser) {
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    parser_expect(parser, TOKEN_LBRACE);
+    
+    ASTList* fields = ast_list_new();
+    parser_skip_noise(parser);
+    
+    while (!parser_check(parser, TOKEN_RBRACE) && !parser_check(parser, TOKEN_EOF)) {
+        int field_line = parser->current_token.line;
+        int field_column = parser->current_token.column;
+        if (!parser_check(parser, TOKEN_IDENTIFIER)) {
+            parser_error(parser, "Expected field name");
+            break;
+        }
+        const char* key = parser->current_token.value;
+        parser_advance(parser);
+        
+        ASTNode* pattern;
+        if (parser_match(parser, TOKEN_COLON)) {
+            pattern = parser_parse_pattern(parser);
+        } else {
+            pattern = parser_at(ast_create_identifier(key), field_line, field_column);
+        }
+        if (!pattern) break;
+        ast_list_add(fields, parser_at(ast_create_field_pattern(key, pattern), field_line, field_column));
+        
+        parser_skip_noise(parser);
+        if (!parser_match(parser, TOKEN_COMMA)) break;
+        parser_skip_noise(parser);
+    }
+    
+    parser_expect(parser, TOKEN_RBRACE);
+    return parser_at(ast_create_object_pattern(fields), line, column);
+}
+
+// Literals and atoms compare, `_` matches anything, a name binds the value,
+// and array and object patterns match structure
 ASTNode* parser_parse_pattern(Parser* parser) {
-    // Simple pattern parsing - can be extended for more complex patterns
+    int line = parser->current_token.line;
+    int column = parser->current_token.column;
+    
     switch (parser->current_token.type) {
-        case TOKEN_UNDERSCORE:
+        case TOKEN_UNDERSCORE: {
+            ASTNode* wildcard = parser_at(ast_create_identifier("_"), line, column);
             parser_advance(parser);
-            return ast_create_identifier("_");
-        case TOKEN_IDENTIFIER:
+            return wildcard;
+        }
+        case TOKEN_IDENTIFIER: {
+            ASTNode* binding = parser_at(ast_create_identifier(parser->current_token.value), line, column);
+            parser_advance(parser);
+            return binding;
+        }
         case TOKEN_NUMBER:
         case TOKEN_STRING:
         case TOKEN_ATOM:
             return parser_parse_literal(parser);
+        case TOKEN_LBRACKET:
+        case TOKEN_LBRACE: {
+            if (!parser_enter_limited(parser, &parser->pattern_depth, PARSER_MAX_PATTERN_DEPTH,
+                                      "Pattern nested too deeply")) {
+                return NULL;
+            }
+            ASTNode* pattern = parser->current_token.type == TOKEN_LBRACKET
+                ? parser_parse_array_pattern(parser)
+                : parser_parse_object_pattern(parser);
+            parser->pattern_depth--;
+            return pattern;
+        }
         default:
             parser_error(parser, "Expected pattern");
             return NULL;
@@ -2,18 +2,43 @@
 #define PARSER_H
 
 #include "lexer.h"
+#include "tokens.h"
 #include "ast.h"
+#include "symbols.h"
+
+// Nesting limit for parenthesized expressions, blocks, match arms and generic
+// types, a guard against runaway input rather than the C stack, which deep
+// nesting outgrows onto fresh stacks (see PARALLEL_STACK_DEPTH). Pipe chains
+// and member accesses are parsed with loops and do not count.
+#define PARSER_MAX_DEPTH 1000000
+
+// Patterns are matched by recursive passes and stay within the C stack
+#define PARSER_MAX_PATTERN_DEPTH 1000
 
 typedef struct {
+    // Token source: exactly one of lexer, buffer or stream is used
     Lexer* lexer;
+    TokenBuffer* buffer;
+    TokenStream* stream;
     Token current_token;
     Token peek_token;
     int error_count;
     char* error_message;
+    SymbolTable* symbols;
+    int silent;             // Count errors without printing them
+    int depth;              // Current expression/type nesting
+    int pattern_depth;      // Current array/object pattern nesting
+    int in_guard;           // Parsing a match guard, whose `=>` starts the arm body
+    Token* lookahead;       // Tokens pulled past peek_token by parser_peek_nth
+    int lookahead_head;
+    int lookahead_count;
+    int lookahead_capacity;
 } Parser;
 
 // Parser creation and cleanup
 Parser* parser_new(Lexer* lexer);
+Parser* parser_new_buffered(TokenBuffer* buffer);
+Parser* parser_new_streamed(TokenStream* stream);
 void parser_free(Parser* parser);
 
 // Main parsing function
@@ -29,6 +54,7 @@ void parser_advance(Parser* parser);
 int parser_check(Parser* parser, TokenType type);
 int parser_match(Parser* parser, TokenType type);
 void parser_expect(Parser* parser, TokenType type);
+const Token* parser_peek_nth(Parser* parser, int n);
 
 // Parsing functions for different constructs
 ASTNode* parser_parse_program(Parser* parser);
@@ -37,6 +63,8 @@ ASTNode* parser_parse_struct_decl(Parser* parser);
 ASTNode* parser_parse_trait_decl(Parser* parser);
 ASTNode* parser_parse_impl_block(Parser* parser);
 ASTNode* parser_parse_let_binding(Parser* parser);
+ASTNode* parser_parse_import_decl(Parser* parser);
+ASTNode* parser_parse_export_decl(Parser* parser);
 ASTNode* parser_parse_expression(Parser* parser);
 ASTNode* parser_parse_pipe_expression(Parser* parser);
 ASTNode* parser_parse_match_expression(Parser* parser);
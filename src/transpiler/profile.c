@@ -0,0 +1,300 @@
+#include "profile.h"
+#include "intern.h"
+#include <ctype.h>
+#include <inttypes.h>
+
+static unsigned long profile_hash_pointer(const void* pointer) {
+    unsigned long hash = (unsigned long)(uintptr_t)pointer;
+    hash ^= hash >> 17;
+    hash *= 0x9E3779B1ul;
+    return hash ^ (hash >> 15);
+}
+
+typedef struct {
+    ProfileSites* sites;
+    ASTNodeType type;
+} ProfileCollect;
+
+static void profile_collect_site(ASTNode* node, void* context) {
+    ProfileCollect* collect = context;
+    ProfileSites* sites = collect->sites;
+    if (node->type != collect->type) return;
+
+    if (sites->count >= sites->capacity) {
+        sites->capacity = sites->capacity == 0 ? 64 : sites->capacity * 2;
+        sites->nodes = realloc(sites->nodes, sites->capacity * sizeof(ASTNode*));
+    }
+    sites->nodes[sites->count++] = node;
+}
+
+ProfileSites* profile_sites_collect(ASTNode* program, ASTNodeType type) {
+    ProfileSites* sites = malloc(sizeof(ProfileSites));
+    memset(sites, 0, sizeof(ProfileSites));
+    ProfileCollect collect = { sites, type };
+    ast_walk(program, profile_collect_site, &collect);
+
+    sites->key_capacity = 16;
+    while (sites->key_capacity < sites->count * 2) {
+        sites->key_capacity *= 2;
+    }
+    sites->keys = calloc(sites->key_capacity, sizeof(ASTNode*));
+    sites->slots = malloc(sites->key_capacity * sizeof(int));
+
+    for (int i = 0; i < sites->count; i++) {
+        unsigned long slot = profile_hash_pointer(sites->nodes[i]) & (sites->key_capacity - 1);
+        while (sites->keys[slot]) {
+            slot = (slot + 1) & (sites->key_capacity - 1);
+        }
+        sites->keys[slot] = sites->nodes[i];
+        sites->slots[slot] = i;
+    }
+
+    return sites;
+}
+
+// Counter slot of node, or -1 for a node outside the collected program
+int profile_site_slot(const ProfileSites* sites, ASTNode* node) {
+    unsigned long slot = profile_hash_pointer(node) & (sites->key_capacity - 1);
+    while (sites->keys[slot]) {
+        if (sites->keys[slot] == node) {
+            return sites->slots[slot];
+        }
+        slot = (slot + 1) & (sites->key_capacity - 1);
+    }
+    return -1;
+}
+
+void profile_sites_free(ProfileSites* sites) {
+    if (!sites) return;
+
+    free(sites->nodes);
+    free(sites->keys);
+    free(sites->slots);
+    free(sites);
+}
+
+static uint64_t profile_key(int line, int column) {
+    return ((uint64_t)(uint32_t)line << 32) | (uint32_t)column;
+}
+
+static unsigned long profile_hash_site(const char* file, uint64_t key) {
+    return profile_hash_pointer(file) ^ profile_hash_pointer((const void*)(uintptr_t)key);
+}
+
+// The slot of (file, key), or the empty slot where it would go
+static int profile_find(const Profile* profile, const char* file, uint64_t key) {
+    unsigned long slot = profile_hash_site(file, key) & (profile->capacity - 1);
+    while (profile->keys[slot] && (profile->keys[slot] != key || profile->files[slot] != file)) {
+        slot = (slot + 1) & (profile->capacity - 1);
+    }
+    return (int)slot;
+}
+
+static void profile_add(Profile* profile, const char* file, uint64_t key, uint64_t count) {
+    if ((profile->count + 1) * 2 > profile->capacity) {
+        const char** files = profile->files;
+        uint64_t* keys = profile->keys;
+        uint64_t* counts = profile->counts;
+        int capacity = profile->capacity;
+
+        profile->capacity = capacity == 0 ? 64 : capacity * 2;
+        profile->files = malloc(profile->capacity * sizeof(const char*));
+        profile->keys = calloc(profile->capacity, sizeof(uint64_t));
+        profile->counts = malloc(profile->capacity * sizeof(uint64_t));
+        for (int i = 0; i < capacity; i++) {
+            if (!keys[i]) continue;
+            int slot = profile_find(profile, files[i], keys[i]);
+            profile->files[slot] = files[i];
+            profile->keys[slot] = keys[i];
+            profile->counts[slot] = counts[i];
+        }
+        free(files);
+        free(keys);
+        free(counts);
+    }
+
+    // Repeated positions, e.g. from concatenated runs, add up
+    int slot = profile_find(profile, file, key);
+    if (profile->keys[slot]) {
+        profile->counts[slot] += count;
+    } else {
+        profile->files[slot] = file;
+        profile->keys[slot] = key;
+        profile->counts[slot] = count;
+        profile->count++;
+    }
+}
+
+// Splits "<file>:<line>:<column> <count>" from the right, so file names may
+// contain colons and spaces
+static int profile_parse_line(char* text, const char** file, int* line, int* column, uint64_t* count) {
+    char* end = text + strlen(text);
+    while (end > text && isspace((unsigned char)end[-1])) {
+        *--end = '\0';
+    }
+
+    char* space = strrchr(text, ' ');
+    if (!space) return 0;
+    *space = '\0';
+    char* column_text = strrchr(text, ':');
+    if (!column_text) return 0;
+    *column_text++ = '\0';
+    char* line_text = strrchr(text, ':');
+    if (!line_text || line_text == text) return 0;
+    *line_text++ = '\0';
+
+    char* rest;
+    *line = (int)strtol(line_text, &rest, 10);
+    if (rest == line_text || *rest || *line <= 0) return 0;
+    *column = (int)strtol(column_text, &rest, 10);
+    if (rest == column_text || *rest || *column <= 0) return 0;
+    *count = strtoull(space + 1, &rest, 10);
+    if (rest == space + 1 || *rest) return 0;
+
+    *file = intern(text);
+    return 1;
+}
+
+Profile* profile_load(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Error: Cannot open profile '%s'\n", filename);
+        return NULL;
+    }
+
+    Profile* profile = malloc(sizeof(Profile));
+    memset(profile, 0, sizeof(Profile));
+
+    char line[4096];
+    int line_number = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line_number++;
+        if (line[0] == '\n' || line[0] == '#') continue;
+
+        const char* arm_file;
+        int arm_line;
+        int arm_column;
+        uint64_t count;
+        if (!profile_parse_line(line, &arm_file, &arm_line, &arm_column, &count)) {
+            fprintf(stderr, "Error: Malformed profile '%s' at line %d\n", filename, line_number);
+            fclose(file);
+            profile_free(profile);
+            return NULL;
+        }
+        profile_add(profile, arm_file, profile_key(arm_line, arm_column), count);
+    }
+
+    fclose(file);
+    return profile;
+}
+
+// file must be interned
+uint64_t profile_count(const Profile* profile, const char* file, int line, int column) {
+    if (profile->capacity == 0) return 0;
+
+    int slot = profile_find(profile, file, profile_key(line, column));
+    return profile->keys[slot] ? profile->counts[slot] : 0;
+}
+
+void profile_free(Profile* profile) {
+    if (!profile) return;
+
+    free(profile->files);
+    free(profile->keys);
+    free(profile->counts);
+    free(profile);
+}
+
+// Literal patterns without guards are plain === tests that can match at most
+// one value, so a run of them with pairwise distinct values may be tested in
+// any order. Anything else (wildcards, guards, identifiers) stays in place.
+static int profile_arm_is_movable(ASTNode* arm) {
+    if (arm->match_arm.guard || !arm->match_arm.pattern) return 0;
+
+    switch (arm->match_arm.pattern->type) {
+        case AST_NUMBER_LITERAL:
+        case AST_STRING_LITERAL:
+        case AST_ATOM_LITERAL:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static int profile_patterns_equal(ASTNode* a, ASTNode* b) {
+    if (a->type != b->type) return 0;
+
+    switch (a->type) {
+        case AST_NUMBER_LITERAL:
+            // 1 and 1.0 are the same number
+            return strtod(a->number_literal.value, NULL) == strtod(b->number_literal.value, NULL);
+        case AST_STRING_LITERAL:
+            return a->string_literal.value == b->string_literal.value;
+        case AST_ATOM_LITERAL:
+            return a->atom_literal.value == b->atom_literal.value;
+        default:
+            return 1;
+    }
+}
+
+typedef struct {
+    const Profile* profile;
+    const char* file;
+    int changed;
+} ProfileReorder;
+
+static int profile_reorder_run(ASTNode** arms, int count, const Profile* profile, const char* file) {
+    for (int i = 0; i < count; i++) {
+        for (int j = i + 1; j < count; j++) {
+            if (profile_patterns_equal(arms[i]->match_arm.pattern, arms[j]->match_arm.pattern)) {
+                return 0;
+            }
+        }
+    }
+
+    // Stable insertion sort by descending count
+    int changed = 0;
+    for (int i = 1; i < count; i++) {
+        ASTNode* arm = arms[i];
+        uint64_t hits = profile_count(profile, file, arm->line, arm->column);
+
+        int j = i;
+        while (j > 0 && profile_count(profile, file, arms[j - 1]->line, arms[j - 1]->column) < hits) {
+            arms[j] = arms[j - 1];
+            j--;
+        }
+        arms[j] = arm;
+        changed |= j != i;
+    }
+    return changed;
+}
+
+static void profile_reorder_match(ASTNode* node, void* context) {
+    ProfileReorder* reorder = context;
+    if (node->type != AST_MATCH_EXPR) return;
+
+    ASTList* arms = node->match_expr.arms;
+    int changed = 0;
+    int start = 0;
+    while (start < arms->count) {
+        if (!profile_arm_is_movable(arms->nodes[start])) {
+            start++;
+            continue;
+        }
+
+        int end = start;
+        while (end < arms->count && profile_arm_is_movable(arms->nodes[end])) {
+            end++;
+        }
+        changed |= profile_reorder_run(arms->nodes + start, end - start, reorder->profile, reorder->file);
+        start = end;
+    }
+
+    reorder->changed += changed;
+}
+
+int profile_reorder_matches(ASTNode* program, const Profile* profile, const char* file) {
+    ProfileReorder reorder = { profile, intern(file), 0 };
+    ast_walk(program, profile_reorder_match, &reorder);
+    return reorder.changed;
+}
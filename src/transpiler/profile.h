@@ -0,0 +1,48 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "ast.h"
+#include <stdint.h>
+
+// Profile-guided match arm ordering
+//
+// An --instrument build counts how often each match arm is taken and, when
+// the program exits, writes one "<file>:<line>:<column> <count>" line per arm,
+// keyed by the arm's source file (as named on the command line, "<input>" for
+// stdin) and position. Modules instrumented into the same file share it.
+// --profile-use reads such a file back and moves hot arms ahead of cold ones
+// wherever that cannot change which arm matches.
+
+// Every node of one type in preorder, e.g. the match arms of a program; a
+// node's index is its counter slot in instrumented output
+typedef struct {
+    ASTNode** nodes;
+    int count;
+    int capacity;
+    ASTNode** keys;         // Open-addressing index from node to slot
+    int* slots;
+    int key_capacity;
+} ProfileSites;
+
+ProfileSites* profile_sites_collect(ASTNode* program, ASTNodeType type);
+int profile_site_slot(const ProfileSites* sites, ASTNode* node);
+void profile_sites_free(ProfileSites* sites);
+
+// Arm counts read back from an instrumented run
+typedef struct {
+    const char** files;     // Interned source file of each key
+    uint64_t* keys;         // line << 32 | column, 0 is empty
+    uint64_t* counts;
+    int count;
+    int capacity;
+} Profile;
+
+Profile* profile_load(const char* filename);
+uint64_t profile_count(const Profile* profile, const char* file, int line, int column);
+void profile_free(Profile* profile);
+
+// Reorder the arms of file's matches by descending count; returns the number
+// of matches changed
+int profile_reorder_matches(ASTNode* program, const Profile* profile, const char* file);
+
+#endif
@@ -0,0 +1,326 @@
+#include "symbols.h"
+#include "codegen.h"
+#include "intern.h"
+#include <stdint.h>
+
+SymbolTable* symbols_new(void) {
+    SymbolTable* table = malloc(sizeof(SymbolTable));
+    table->decls = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->current = -1;
+    return table;
+}
+
+static void symbols_free_decl(SymbolDecl* decl) {
+    free(decl->refs);
+}
+
+void symbols_free(SymbolTable* table) {
+    if (!table) return;
+
+    for (int i = 0; i < table->count; i++) {
+        symbols_free_decl(&table->decls[i]);
+    }
+
+    free(table->decls);
+    free(table);
+}
+
+// Moves every entry of src to the end of dest, leaving src empty
+void symbols_append(SymbolTable* dest, SymbolTable* src) {
+    if (!src || src->count == 0) return;
+
+    if (dest->count + src->count > dest->capacity) {
+        dest->capacity = dest->count + src->count;
+        dest->decls = realloc(dest->decls, dest->capacity * sizeof(SymbolDecl));
+    }
+
+    memcpy(dest->decls + dest->count, src->decls, src->count * sizeof(SymbolDecl));
+    dest->count += src->count;
+    src->count = 0;
+}
+
+void symbols_begin_decl(SymbolTable* table) {
+    if (table->count >= table->capacity) {
+        table->capacity = table->capacity == 0 ? 16 : table->capacity * 2;
+        table->decls = realloc(table->decls, table->capacity * sizeof(SymbolDecl));
+    }
+
+    SymbolDecl* decl = &table->decls[table->count];
+    memset(decl, 0, sizeof(SymbolDecl));
+    table->current = table->count++;
+}
+
+static const char* symbols_decl_name(ASTNode* decl) {
+    // Exported declarations bind the same name; being exported keeps them live
+    decl = ast_unwrap_export(decl);
+    switch (decl->type) {
+        case AST_STRUCT_DECL:
+            return decl->struct_decl.name;
+        case AST_TRAIT_DECL:
+            return decl->trait_decl.name;
+        case AST_IMPL_BLOCK: {
+            // Mirrors the names chosen by codegen_generate_impl_block
+            const char* type_name = decl->impl_block.type_name;
+            const char* suffix = decl->impl_block.trait_name ? decl->impl_block.trait_name : "Impl";
+            char* name = malloc(strlen(type_name) + strlen(suffix) + 1);
+            strcpy(name, type_name);
+            strcat(name, suffix);
+            const char* interned = intern(name);
+            free(name);
+            return interned;
+        }
+        case AST_LET_BINDING:
+            return decl->let_binding.name;
+        default:
+            return NULL;
+    }
+}
+
+void symbols_end_decl(SymbolTable* table, ASTNode* decl) {
+    if (table->current < 0) return;
+
+    if (!decl) {
+        // Nothing was added to the program, drop the entry to stay index-aligned
+        symbols_free_decl(&table->decls[table->current]);
+        table->count--;
+        table->current = -1;
+        return;
+    }
+
+    SymbolDecl* entry = &table->decls[table->current];
+    entry->name = symbols_decl_name(decl);
+
+    switch (decl->type) {
+        case AST_STRUCT_DECL:
+        case AST_TRAIT_DECL:
+        case AST_IMPL_BLOCK:
+            entry->has_side_effects = 0;
+            break;
+        case AST_LET_BINDING:
+            entry->has_side_effects = symbols_has_side_effects(decl->let_binding.value);
+            break;
+        default:
+            entry->has_side_effects = 1;
+            break;
+    }
+
+    table->current = -1;
+}
+
+void symbols_add_reference(SymbolTable* table, const char* name) {
+    if (!table || table->current < 0 || !name) return;
+
+    SymbolDecl* decl = &table->decls[table->current];
+    if (decl->ref_count >= decl->ref_capacity) {
+        decl->ref_capacity = decl->ref_capacity == 0 ? 8 : decl->ref_capacity * 2;
+        decl->refs = realloc(decl->refs, decl->ref_capacity * sizeof(char*));
+    }
+
+    decl->refs[decl->ref_count++] = name;
+}
+
+typedef struct {
+    ASTNode** nodes;
+    int count;
+    int capacity;
+} SymbolsWorklist;
+
+static void symbols_worklist_push(SymbolsWorklist* work, ASTNode* node) {
+    if (!node) return;
+
+    if (work->count >= work->capacity) {
+        work->capacity = work->capacity == 0 ? 64 : work->capacity * 2;
+        work->nodes = realloc(work->nodes, work->capacity * sizeof(ASTNode*));
+    }
+    work->nodes[work->count++] = node;
+}
+
+static void symbols_worklist_push_list(SymbolsWorklist* work, ASTList* list) {
+    if (!list) return;
+
+    for (int i = 0; i < list->count; i++) {
+        symbols_worklist_push(work, list->nodes[i]);
+    }
+}
+
+// Whether evaluating node, or any subexpression it evaluates, may have an
+// effect. Subexpressions are checked from an explicit worklist, so nesting
+// depth does not grow the C stack.
+static int symbols_node_has_side_effects(ASTNode* node, SymbolsWorklist* work) {
+    switch (node->type) {
+        case AST_IDENTIFIER:
+        case AST_NUMBER_LITERAL:
+        case AST_STRING_LITERAL:
+        case AST_ATOM_LITERAL:
+            return 0;
+
+        case AST_PIPE_EXPR:
+            // Built-in method stages lower to property reads/calls on the value itself
+            while (node->type == AST_PIPE_EXPR) {
+                ASTNode* right = node->pipe_expr.right;
+                if (!right || right->type != AST_IDENTIFIER || !codegen_is_builtin_method(right->identifier.name)) {
+                    return 1;
+                }
+                node = node->pipe_expr.left;
+                if (!node) return 0;
+            }
+            symbols_worklist_push(work, node);
+            return 0;
+
+        case AST_MATCH_EXPR: {
+            // A match without a catch-all arm may throw at runtime
+            int has_wildcard = 0;
+            symbols_worklist_push(work, node->match_expr.expr);
+
+            for (int i = 0; i < node->match_expr.arms->count; i++) {
+                ASTNode* arm = node->match_expr.arms->nodes[i];
+                ASTNode* pattern = arm->match_arm.pattern;
+
+                symbols_worklist_push(work, arm->match_arm.guard);
+                symbols_worklist_push(work, arm->match_arm.body);
+
+                if (!arm->match_arm.guard && pattern && pattern->type == AST_IDENTIFIER &&
+                    pattern->identifier.name == intern_underscore) {
+                    has_wildcard = 1;
+                }
+            }
+            return !has_wildcard;
+        }
+
+        case AST_BLOCK:
+            symbols_worklist_push_list(work, node->block.statements);
+            return 0;
+
+        case AST_ARRAY_LITERAL:
+            symbols_worklist_push_list(work, node->array_literal.elements);
+            return 0;
+
+        case AST_OBJECT_LITERAL:
+            symbols_worklist_push_list(work, node->object_literal.properties);
+            return 0;
+
+        case AST_PROPERTY:
+            symbols_worklist_push(work, node->property.value);
+            return 0;
+
+        case AST_FUNCTION_DECL:
+            // Creating a function runs none of its body
+            return 0;
+
+        case AST_LAZY_EXPR:
+            // Nothing runs until the binding is first read
+            return 0;
+
+        default:
+            return 1;
+    }
+}
+
+int symbols_has_side_effects(ASTNode* node) {
+    SymbolsWorklist work = { NULL, 0, 0 };
+    symbols_worklist_push(&work, node);
+
+    int effects = 0;
+    while (work.count > 0 && !effects) {
+        effects = symbols_node_has_side_effects(work.nodes[--work.count], &work);
+    }
+
+    free(work.nodes);
+    return effects;
+}
+
+// Open-addressing index from declaration name to the first declaration with that name
+typedef struct {
+    const char** keys;
+    int* values;
+    int capacity;
+} SymbolIndex;
+
+// Names are interned, so the pointer itself is the key
+static unsigned long symbols_hash(const char* name) {
+    unsigned long hash = (unsigned long)(uintptr_t)name;
+    hash ^= hash >> 17;
+    hash *= 0x9E3779B1ul;
+    return hash ^ (hash >> 15);
+}
+
+static int symbols_index_find(SymbolIndex* index, const char* name) {
+    unsigned long slot = symbols_hash(name) & (index->capacity - 1);
+
+    while (index->keys[slot]) {
+        if (index->keys[slot] == name) {
+            return (int)slot;
+        }
+        slot = (slot + 1) & (index->capacity - 1);
+    }
+    return -(int)slot - 1;
+}
+
+void symbols_mark_live(SymbolTable* table) {
+    if (!table || table->count == 0) return;
+
+    SymbolIndex index;
+    index.capacity = 16;
+    while (index.capacity < table->count * 2) {
+        index.capacity *= 2;
+    }
+    index.keys = calloc(index.capacity, sizeof(char*));
+    index.values = malloc(index.capacity * sizeof(int));
+
+    // Declarations sharing a name are chained through next_same
+    int* next_same = malloc(table->count * sizeof(int));
+    int* worklist = malloc(table->count * sizeof(int));
+    int pending = 0;
+
+    for (int i = 0; i < table->count; i++) {
+        SymbolDecl* decl = &table->decls[i];
+        next_same[i] = -1;
+        decl->live = 0;
+
+        if (decl->name) {
+            int slot = symbols_index_find(&index, decl->name);
+            if (slot < 0) {
+                slot = -slot - 1;
+                index.keys[slot] = decl->name;
+                index.values[slot] = i;
+            } else {
+                int last = index.values[slot];
+                while (next_same[last] >= 0) last = next_same[last];
+                next_same[last] = i;
+            }
+        }
+
+        if (decl->has_side_effects) {
+            decl->live = 1;
+            worklist[pending++] = i;
+        }
+    }
+
+    while (pending > 0) {
+        SymbolDecl* decl = &table->decls[worklist[--pending]];
+
+        for (int r = 0; r < decl->ref_count; r++) {
+            int slot = symbols_index_find(&index, decl->refs[r]);
+            if (slot < 0) continue;
+
+            for (int target = index.values[slot]; target >= 0; target = next_same[target]) {
+                if (!table->decls[target].live) {
+                    table->decls[target].live = 1;
+                    worklist[pending++] = target;
+                }
+            }
+        }
+    }
+
+    free(worklist);
+    free(next_same);
+    free(index.values);
+    free(index.keys);
+}
+
+int symbols_is_live(SymbolTable* table, int index) {
+    if (!table || index < 0 || index >= table->count) return 1;
+    return table->decls[index].live;
+}
@@ -0,0 +1,39 @@
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include "ast.h"
+
+// One entry per top-level declaration, in program order
+typedef struct {
+    const char* name;      // Binding introduced by the declaration (NULL for bare expressions)
+    const char** refs;     // Names referenced anywhere inside the declaration
+    int ref_count;
+    int ref_capacity;
+    int has_side_effects;  // Must be emitted even if nothing references it
+    int live;
+} SymbolDecl;
+
+typedef struct {
+    SymbolDecl* decls;
+    int count;
+    int capacity;
+    int current;           // Index of the declaration being parsed, -1 outside
+} SymbolTable;
+
+// Table creation and cleanup
+SymbolTable* symbols_new(void);
+void symbols_free(SymbolTable* table);
+void symbols_append(SymbolTable* dest, SymbolTable* src);
+
+// Recording (driven by the parser). Names are interned, so the table
+// stores and compares pointers and never copies strings.
+void symbols_begin_decl(SymbolTable* table);
+void symbols_end_decl(SymbolTable* table, ASTNode* decl);
+void symbols_add_reference(SymbolTable* table, const char* name);
+
+// Reachability analysis
+void symbols_mark_live(SymbolTable* table);
+int symbols_is_live(SymbolTable* table, int index);
+int symbols_has_side_effects(ASTNode* node);
+
+#endif
@@ -0,0 +1,148 @@
+#include "tailcall.h"
+
+// Whether a pattern binds name, shadowing the function inside its arm
+static int tailcall_pattern_binds(ASTNode* pattern, const char* name) {
+    if (!pattern) return 0;
+
+    switch (pattern->type) {
+        case AST_IDENTIFIER:
+            return pattern->identifier.name == name;
+        case AST_ARRAY_PATTERN:
+            if (pattern->array_pattern.rest == name) return 1;
+            for (int i = 0; i < pattern->array_pattern.elements->count; i++) {
+                if (tailcall_pattern_binds(pattern->array_pattern.elements->nodes[i], name)) return 1;
+            }
+            return 0;
+        case AST_OBJECT_PATTERN:
+            for (int i = 0; i < pattern->object_pattern.fields->count; i++) {
+                if (tailcall_pattern_binds(pattern->object_pattern.fields->nodes[i]->field_pattern.pattern, name)) return 1;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+// Marks the self calls in tail position of node, returning how many. Tail
+// positions are visited from an explicit worklist, so nested matches do not
+// grow the C stack.
+static int tailcall_mark_tail(ASTNode* node, const char* name, int arity) {
+    int marked = 0;
+    int count = 0;
+    int capacity = 16;
+    ASTNode** tails = malloc(capacity * sizeof(ASTNode*));
+    tails[count++] = node;
+
+    while (count > 0) {
+        node = tails[--count];
+
+        // Only the last statement of a block is in tail position
+        while (node && node->type == AST_BLOCK) {
+            ASTList* statements = node->block.statements;
+            node = statements->count > 0 ? statements->nodes[statements->count - 1] : NULL;
+        }
+        if (!node) continue;
+
+        switch (node->type) {
+            case AST_CALL_EXPR: {
+                ASTNode* function = node->call_expr.function;
+                int args = node->call_expr.args ? node->call_expr.args->count : 0;
+                if (function->type == AST_IDENTIFIER && function->identifier.name == name && args == arity) {
+                    node->call_expr.tail_call = 1;
+                    marked++;
+                }
+                break;
+            }
+            case AST_MATCH_EXPR:
+                for (int i = 0; i < node->match_expr.arms->count; i++) {
+                    ASTNode* arm = node->match_expr.arms->nodes[i];
+                    if (tailcall_pattern_binds(arm->match_arm.pattern, name)) continue;
+
+                    if (count >= capacity) {
+                        capacity *= 2;
+                        tails = realloc(tails, capacity * sizeof(ASTNode*));
+                    }
+                    tails[count++] = arm->match_arm.body;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+
+    free(tails);
+    return marked;
+}
+
+typedef struct {
+    ASTList* params;
+    int rejected;
+} TailcallCheck;
+
+static int tailcall_is_param(ASTList* params, const char* name) {
+    for (int i = 0; i < params->count; i++) {
+        if (params->nodes[i]->param_decl.name == name) return 1;
+    }
+    return 0;
+}
+
+static int tailcall_pattern_binds_param(ASTNode* pattern, ASTList* params) {
+    for (int i = 0; i < params->count; i++) {
+        if (tailcall_pattern_binds(pattern, params->nodes[i]->param_decl.name)) return 1;
+    }
+    return 0;
+}
+
+// Closures would observe the reassigned parameters, and a nested binding
+// shadowing a parameter would make its name mean something else at the self
+// call, so either rules the function out
+static void tailcall_find_rejected(ASTNode* node, void* context) {
+    TailcallCheck* check = context;
+
+    switch (node->type) {
+        case AST_FUNCTION_DECL:
+            check->rejected = 1;
+            break;
+        case AST_MATCH_ARM:
+            if (tailcall_pattern_binds_param(node->match_arm.pattern, check->params)) {
+                check->rejected = 1;
+            }
+            break;
+        case AST_LET_BINDING:
+            if (tailcall_is_param(check->params, node->let_binding.name)) {
+                check->rejected = 1;
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+static int tailcall_mark_function(const char* name, ASTNode* function) {
+    ASTList* params = function->function_decl.params;
+    if (tailcall_is_param(params, name)) return 0;
+
+    TailcallCheck check = { params, 0 };
+    ast_walk(function->function_decl.body, tailcall_find_rejected, &check);
+    if (check.rejected) return 0;
+
+    int marked = tailcall_mark_tail(function->function_decl.body, name, params->count);
+    function->function_decl.tail_loop = marked > 0;
+    return marked > 0;
+}
+
+int tailcall_mark(ASTNode* program) {
+    ASTList* declarations = program->program.declarations;
+    int marked = 0;
+
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* decl = ast_unwrap_export(declarations->nodes[i]);
+        if (decl->type != AST_LET_BINDING) continue;
+
+        ASTNode* value = decl->let_binding.value;
+        if (value && value->type == AST_FUNCTION_DECL && value->function_decl.body) {
+            marked += tailcall_mark_function(decl->let_binding.name, value);
+        }
+    }
+    return marked;
+}
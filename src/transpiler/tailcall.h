@@ -0,0 +1,19 @@
+#ifndef TAILCALL_H
+#define TAILCALL_H
+
+#include "ast.h"
+
+// Self tail call elimination
+//
+// A top-level `let f = (...) => body` whose body calls f in tail position is
+// marked for codegen to emit as a `while (true)` loop: each such call
+// (call_expr.tail_call) reassigns the parameters and continues instead of
+// growing the stack. Tail positions are the body, the last statement of a
+// block, and the arm bodies of a match in tail position. Functions whose
+// body creates closures, or rebinds a parameter's name in a pattern or let,
+// are left alone, so every parameter name in the body is that parameter.
+
+// Returns the number of functions marked (function_decl.tail_loop)
+int tailcall_mark(ASTNode* program);
+
+#endif
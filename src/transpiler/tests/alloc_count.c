@@ -0,0 +1,113 @@
+// Checks that writing string and atom literals allocates nothing: escaping
+// and Symbol.for(...) go straight into the generator's output buffer.
+//
+// Built by `make test`, which compiles every source with malloc, calloc,
+// realloc and strdup renamed to the counting wrappers below.
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../codegen.h"
+#include "../intern.h"
+
+static long allocations = 0;
+
+void* alloc_count_malloc(size_t size) {
+    allocations++;
+    return malloc(size);
+}
+
+void* alloc_count_calloc(size_t count, size_t size) {
+    allocations++;
+    return calloc(count, size);
+}
+
+void* alloc_count_realloc(void* pointer, size_t size) {
+    allocations++;
+    return realloc(pointer, size);
+}
+
+char* alloc_count_strdup(const char* str) {
+    allocations++;
+    return strdup(str);
+}
+
+typedef struct {
+    ASTNodeType type;
+    const char* value;
+    const char* expected;
+} AllocCase;
+
+static const AllocCase cases[] = {
+    { AST_STRING_LITERAL, "plain text without anything to escape, long enough to be one run",
+      "\"plain text without anything to escape, long enough to be one run\"" },
+    { AST_STRING_LITERAL, "quote \" backslash \\ newline \n tab \t return \r",
+      "\"quote \\\" backslash \\\\ newline \\n tab \\t return \\r\"" },
+    { AST_STRING_LITERAL, "\b\f\x01\x1f\x7f", "\"\\b\\f\\x01\\x1f\\x7f\"" },
+    { AST_STRING_LITERAL, "caf\xc3\xa9 \xe2\x80\xa8 \xe2\x80\xa9 \xe2\x82\xac",
+      "\"caf\xc3\xa9 \\u2028 \\u2029 \xe2\x82\xac\"" },
+    { AST_STRING_LITERAL, "", "\"\"" },
+    { AST_ATOM_LITERAL, ":ok", "Symbol.for(\"ok\")" },
+    { AST_ATOM_LITERAL, ":say \"hi\"\n", "Symbol.for(\"say \\\"hi\\\"\\n\")" },
+    { AST_NUMBER_LITERAL, "42", "42" },
+};
+
+int main(void) {
+    int count = sizeof(cases) / sizeof(cases[0]);
+    ASTNode** nodes = malloc(count * sizeof(ASTNode*));
+    for (int i = 0; i < count; i++) {
+        switch (cases[i].type) {
+            case AST_STRING_LITERAL:
+                nodes[i] = ast_create_string_literal(cases[i].value);
+                break;
+            case AST_ATOM_LITERAL:
+                nodes[i] = ast_create_atom_literal(cases[i].value);
+                break;
+            default:
+                nodes[i] = ast_create_number_literal(cases[i].value);
+                break;
+        }
+    }
+
+    // Grow the output buffer up front, so only the literals are measured
+    CodeGenerator* gen = codegen_new();
+    for (int i = 0; i < 64; i++) {
+        codegen_write(gen, "................................................................");
+    }
+
+    int failures = 0;
+    for (int i = 0; i < count; i++) {
+        gen->length = 0;
+        gen->buffer[0] = '\0';
+
+        long before = allocations;
+        codegen_generate_literal(gen, nodes[i]);
+        long made = allocations - before;
+
+        if (made != 0) {
+            fprintf(stderr, "Error: literal %d made %ld allocation%s\n", i, made, made == 1 ? "" : "s");
+            failures++;
+        }
+        if (strcmp(gen->buffer, cases[i].expected) != 0) {
+            fprintf(stderr, "Error: literal %d wrote %s, expected %s\n", i, gen->buffer, cases[i].expected);
+            failures++;
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        ast_node_free(nodes[i]);
+    }
+    free(nodes);
+    codegen_free(gen);
+
+    if (failures > 0) {
+        return 1;
+    }
+    printf("alloc_count: %d literals written without allocating\n", count);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "tokens.h"
+#include "trace.h"
+#include <pthread.h>
+
+TokenBuffer* token_buffer_lex(Lexer* lexer) {
+    TokenBuffer* buffer = malloc(sizeof(TokenBuffer));
+    // Roughly one token per four source bytes
+    buffer->capacity = (lexer->length - lexer->pos) / 4 + 16;
+    buffer->tokens = malloc(buffer->capacity * sizeof(Token));
+    buffer->count = 0;
+    buffer->next = 0;
+
+    Token token;
+    do {
+        token = lexer_next_token(lexer);
+        if (buffer->count >= buffer->capacity) {
+            buffer->capacity *= 2;
+            buffer->tokens = realloc(buffer->tokens, buffer->capacity * sizeof(Token));
+        }
+        buffer->tokens[buffer->count++] = token;
+    } while (token.type != TOKEN_EOF);
+
+    return buffer;
+}
+
+// Ownership of the returned token passes to the caller; EOF repeats once reached
+Token token_buffer_next(TokenBuffer* buffer) {
+    if (buffer->next < buffer->count - 1) {
+        return buffer->tokens[buffer->next++];
+    }
+    return buffer->tokens[buffer->count - 1];
+}
+
+void token_buffer_free(TokenBuffer* buffer) {
+    if (!buffer) return;
+
+    for (int i = buffer->next; i < buffer->count; i++) {
+        token_free(&buffer->tokens[i]);
+    }
+    free(buffer->tokens);
+    free(buffer);
+}
+
+struct TokenStream {
+    Lexer* lexer;
+    pthread_t thread;
+
+    // Shared ring, guarded by lock
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    Token ring[TOKEN_STREAM_CAPACITY];
+    int head;
+    int count;
+    int stopped;            // Consumer is gone; producer should exit
+
+    // Consumer-side batch, touched only by the parser thread
+    Token batch[TOKEN_STREAM_BATCH];
+    int batch_pos;
+    int batch_count;
+    Token eof;
+    int at_eof;
+};
+
+static void* token_stream_produce(void* arg) {
+    TokenStream* stream = arg;
+    Token batch[TOKEN_STREAM_BATCH];
+    int done = 0;
+    TraceSpan span = trace_begin("lex");
+
+    while (!done) {
+        int count = 0;
+        while (count < TOKEN_STREAM_BATCH && !done) {
+            batch[count] = lexer_next_token(stream->lexer);
+            done = batch[count].type == TOKEN_EOF;
+            count++;
+        }
+
+        pthread_mutex_lock(&stream->lock);
+        for (int i = 0; i < count; i++) {
+            while (stream->count == TOKEN_STREAM_CAPACITY && !stream->stopped) {
+                pthread_cond_wait(&stream->not_full, &stream->lock);
+            }
+            if (stream->stopped) {
+                for (int j = i; j < count; j++) {
+                    token_free(&batch[j]);
+                }
+                pthread_mutex_unlock(&stream->lock);
+                trace_end(span, NULL);
+                return NULL;
+            }
+
+            int tail = (stream->head + stream->count) % TOKEN_STREAM_CAPACITY;
+            stream->ring[tail] = batch[i];
+            stream->count++;
+        }
+        pthread_cond_signal(&stream->not_empty);
+        pthread_mutex_unlock(&stream->lock);
+    }
+
+    trace_end(span, NULL);
+    return NULL;
+}
+
+TokenStream* token_stream_start(Lexer* lexer) {
+    TokenStream* stream = malloc(sizeof(TokenStream));
+    stream->lexer = lexer;
+    stream->head = 0;
+    stream->count = 0;
+    stream->stopped = 0;
+    stream->batch_pos = 0;
+    stream->batch_count = 0;
+    stream->at_eof = 0;
+
+    pthread_mutex_init(&stream->lock, NULL);
+    pthread_cond_init(&stream->not_empty, NULL);
+    pthread_cond_init(&stream->not_full, NULL);
+
+    if (pthread_create(&stream->thread, NULL, token_stream_produce, stream) != 0) {
+        pthread_cond_destroy(&stream->not_full);
+        pthread_cond_destroy(&stream->not_empty);
+        pthread_mutex_destroy(&stream->lock);
+        free(stream);
+        return NULL;
+    }
+
+    return stream;
+}
+
+// Ownership of the returned token passes to the caller; EOF repeats once reached
+Token token_stream_next(TokenStream* stream) {
+    if (stream->at_eof) {
+        return stream->eof;
+    }
+
+    if (stream->batch_pos == stream->batch_count) {
+        pthread_mutex_lock(&stream->lock);
+        while (stream->count == 0) {
+            pthread_cond_wait(&stream->not_empty, &stream->lock);
+        }
+
+        int count = stream->count < TOKEN_STREAM_BATCH ? stream->count : TOKEN_STREAM_BATCH;
+        for (int i = 0; i < count; i++) {
+            stream->batch[i] = stream->ring[(stream->head + i) % TOKEN_STREAM_CAPACITY];
+        }
+        stream->head = (stream->head + count) % TOKEN_STREAM_CAPACITY;
+        stream->count -= count;
+
+        pthread_cond_signal(&stream->not_full);
+        pthread_mutex_unlock(&stream->lock);
+
+        stream->batch_pos = 0;
+        stream->batch_count = count;
+    }
+
+    Token token = stream->batch[stream->batch_pos++];
+    if (token.type == TOKEN_EOF) {
+        stream->eof = token;
+        stream->at_eof = 1;
+    }
+    return token;
+}
+
+void token_stream_free(TokenStream* stream) {
+    if (!stream) return;
+
+    // The parser may stop early; release a producer blocked on a full ring
+    pthread_mutex_lock(&stream->lock);
+    stream->stopped = 1;
+    pthread_cond_signal(&stream->not_full);
+    pthread_mutex_unlock(&stream->lock);
+
+    pthread_join(stream->thread, NULL);
+
+    for (int i = stream->batch_pos; i < stream->batch_count; i++) {
+        token_free(&stream->batch[i]);
+    }
+    for (int i = 0; i < stream->count; i++) {
+        token_free(&stream->ring[(stream->head + i) % TOKEN_STREAM_CAPACITY]);
+    }
+
+    pthread_cond_destroy(&stream->not_full);
+    pthread_cond_destroy(&stream->not_empty);
+    pthread_mutex_destroy(&stream->lock);
+    free(stream);
+}
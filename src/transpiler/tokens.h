@@ -0,0 +1,31 @@
+#ifndef TOKENS_H
+#define TOKENS_H
+
+#include "lexer.h"
+
+// Batch lexing: the whole input is lexed up front into one contiguous array
+typedef struct {
+    Token* tokens;
+    int count;
+    int capacity;
+    int next;               // Next token to hand out; earlier tokens belong to the consumer
+} TokenBuffer;
+
+TokenBuffer* token_buffer_lex(Lexer* lexer);
+Token token_buffer_next(TokenBuffer* buffer);
+void token_buffer_free(TokenBuffer* buffer);
+
+// Threaded lexing: a producer thread lexes into a bounded single-producer,
+// single-consumer ring while the parser consumes from the other end.
+// Tokens cross the ring in batches so the lock is taken once per batch.
+#define TOKEN_STREAM_CAPACITY 4096
+#define TOKEN_STREAM_BATCH 256
+
+typedef struct TokenStream TokenStream;
+
+// Returns NULL if the producer thread cannot be started
+TokenStream* token_stream_start(Lexer* lexer);
+Token token_stream_next(TokenStream* stream);
+void token_stream_free(TokenStream* stream);
+
+#endif
@@ -0,0 +1,191 @@
+#include "trace.h"
+#include "intern.h"
+#include "json.h"
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_MAX_THREADS 256
+
+typedef struct {
+    const char* name;
+    const char* file;       // Interned, or NULL
+    char phase;             // 'X' complete span, 'i' instant
+    int tid;
+    long start;
+    long duration;
+} TraceEvent;
+
+static struct {
+    int active;
+    FILE* out;
+    struct timespec origin;
+    pthread_mutex_t lock;
+    TraceEvent* events;
+    int count;
+    int capacity;
+    pthread_t threads[TRACE_MAX_THREADS];   // Index + 1 is the tid shown in the viewer
+    int thread_count;
+} trace = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static long trace_now(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - trace.origin.tv_sec) * 1000000L + (now.tv_nsec - trace.origin.tv_nsec) / 1000;
+}
+
+// Small, stable ids in order of first appearance; call with the lock held
+static int trace_thread_id(void) {
+    pthread_t self = pthread_self();
+    for (int i = 0; i < trace.thread_count; i++) {
+        if (pthread_equal(trace.threads[i], self)) return i + 1;
+    }
+
+    if (trace.thread_count == TRACE_MAX_THREADS) return TRACE_MAX_THREADS;
+    trace.threads[trace.thread_count++] = self;
+    return trace.thread_count;
+}
+
+static void trace_record(char phase, const char* name, const char* file, long start, long duration) {
+    pthread_mutex_lock(&trace.lock);
+
+    if (trace.count >= trace.capacity) {
+        trace.capacity = trace.capacity == 0 ? 1024 : trace.capacity * 2;
+        trace.events = realloc(trace.events, trace.capacity * sizeof(TraceEvent));
+    }
+
+    TraceEvent* event = &trace.events[trace.count++];
+    event->name = name;
+    event->file = file ? intern(file) : NULL;
+    event->phase = phase;
+    event->tid = trace_thread_id();
+    event->start = start;
+    event->duration = duration;
+
+    pthread_mutex_unlock(&trace.lock);
+}
+
+int trace_start(const char* filename) {
+    trace.out = fopen(filename, "w");
+    if (!trace.out) {
+        fprintf(stderr, "Error: Cannot write to file '%s'\n", filename);
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &trace.origin);
+    trace.count = 0;
+    trace.thread_count = 0;
+    trace.threads[trace.thread_count++] = pthread_self();
+    trace.active = 1;
+    return 1;
+}
+
+int trace_enabled(void) {
+    return trace.active;
+}
+
+TraceSpan trace_begin(const char* name) {
+    TraceSpan span;
+    span.name = name;
+    span.start = trace.active ? trace_now() : 0;
+    return span;
+}
+
+void trace_end(TraceSpan span, const char* file) {
+    if (!trace.active) return;
+    trace_record('X', span.name, file, span.start, trace_now() - span.start);
+}
+
+void trace_instant(const char* name, const char* file) {
+    if (!trace.active) return;
+    trace_record('i', name, file, trace_now(), 0);
+}
+
+// {"traceEvents": [...], "displayTimeUnit": "ms"}
+int trace_stop(void) {
+    if (!trace.active) return 1;
+    trace.active = 0;
+
+    long pid = (long)getpid();
+    JsonWriter* writer = json_writer_new(trace.out);
+    json_begin_object(writer);
+    json_key(writer, "traceEvents");
+    json_begin_array(writer);
+
+    // Name the threads so the viewer shows "main" and "worker N" lanes
+    for (int i = 0; i < trace.thread_count; i++) {
+        char name[32];
+        if (i == 0) {
+            snprintf(name, sizeof(name), "main");
+        } else {
+            snprintf(name, sizeof(name), "worker %d", i);
+        }
+
+        json_begin_object(writer);
+        json_key(writer, "name");
+        json_string(writer, "thread_name");
+        json_key(writer, "ph");
+        json_string(writer, "M");
+        json_key(writer, "pid");
+        json_int(writer, pid);
+        json_key(writer, "tid");
+        json_int(writer, i + 1);
+        json_key(writer, "args");
+        json_begin_object(writer);
+        json_key(writer, "name");
+        json_string(writer, name);
+        json_end_object(writer);
+        json_end_object(writer);
+    }
+
+    for (int i = 0; i < trace.count; i++) {
+        TraceEvent* event = &trace.events[i];
+        char phase[2] = { event->phase, '\0' };
+
+        json_begin_object(writer);
+        json_key(writer, "name");
+        json_string(writer, event->name);
+        json_key(writer, "cat");
+        json_string(writer, "zeno");
+        json_key(writer, "ph");
+        json_string(writer, phase);
+        json_key(writer, "ts");
+        json_int(writer, event->start);
+        if (event->phase == 'X') {
+            json_key(writer, "dur");
+            json_int(writer, event->duration);
+        } else {
+            json_key(writer, "s");
+            json_string(writer, "t");
+        }
+        json_key(writer, "pid");
+        json_int(writer, pid);
+        json_key(writer, "tid");
+        json_int(writer, event->tid);
+        if (event->file) {
+            json_key(writer, "args");
+            json_begin_object(writer);
+            json_key(writer, "file");
+            json_string(writer, event->file);
+            json_end_object(writer);
+        }
+        json_end_object(writer);
+    }
+
+    json_end_array(writer);
+    json_key(writer, "displayTimeUnit");
+    json_string(writer, "ms");
+    json_end_object(writer);
+    json_writer_free(writer);
+    fputc('\n', trace.out);
+
+    int success = !ferror(trace.out);
+    success = fclose(trace.out) == 0 && success;
+    trace.out = NULL;
+
+    free(trace.events);
+    trace.events = NULL;
+    trace.count = 0;
+    trace.capacity = 0;
+    return success;
+}
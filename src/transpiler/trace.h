@@ -0,0 +1,25 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Build tracing in the Chrome trace event format (chrome://tracing, Perfetto)
+//
+// While a trace is running, spans and instant events from any thread are
+// collected in memory and written as one JSON document when it stops.
+// With no trace running, trace_begin and trace_end cost a branch.
+
+typedef struct {
+    const char* name;
+    long start;             // Microseconds since trace_start
+} TraceSpan;
+
+// Returns 0 if the trace file cannot be created
+int trace_start(const char* filename);
+int trace_stop(void);
+int trace_enabled(void);
+
+// Spans nest by time on each thread; file may be NULL
+TraceSpan trace_begin(const char* name);
+void trace_end(TraceSpan span, const char* file);
+void trace_instant(const char* name, const char* file);
+
+#endif
@@ -0,0 +1,102 @@
+#include "types.h"
+#include "intern.h"
+#include <pthread.h>
+#include <stdint.h>
+
+// Open-addressing table of shared type nodes; parallel chunk parsers share it
+static struct {
+    pthread_mutex_t lock;
+    ASTNode** nodes;
+    uint32_t* hashes;
+    int count;
+    int capacity;
+} types_table = { PTHREAD_MUTEX_INITIALIZER, NULL, NULL, 0, 0 };
+
+// Names and arguments are canonical, so their pointers identify them
+static uint32_t types_hash(const char* type_name, ASTList* args) {
+    uint64_t hash = (uintptr_t)type_name;
+    hash = hash * 0x9E3779B97F4A7C15ull + (args != NULL);
+
+    if (args) {
+        for (int i = 0; i < args->count; i++) {
+            hash = (hash ^ (uintptr_t)args->nodes[i]) * 0x9E3779B97F4A7C15ull;
+        }
+    }
+    return (uint32_t)(hash ^ (hash >> 32));
+}
+
+static int types_match(ASTNode* node, const char* type_name, ASTList* args) {
+    ASTList* existing = node->type_annotation.generic_args;
+    if (node->type_annotation.type_name != type_name || (existing != NULL) != (args != NULL)) {
+        return 0;
+    }
+    if (!args) return 1;
+
+    if (existing->count != args->count) return 0;
+    for (int i = 0; i < args->count; i++) {
+        if (existing->nodes[i] != args->nodes[i]) return 0;
+    }
+    return 1;
+}
+
+static void types_grow(void) {
+    int capacity = types_table.capacity ? types_table.capacity * 2 : 256;
+    ASTNode** nodes = calloc(capacity, sizeof(ASTNode*));
+    uint32_t* hashes = malloc(capacity * sizeof(uint32_t));
+
+    for (int i = 0; i < types_table.capacity; i++) {
+        if (!types_table.nodes[i]) continue;
+
+        uint32_t slot = types_table.hashes[i] & (capacity - 1);
+        while (nodes[slot]) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        nodes[slot] = types_table.nodes[i];
+        hashes[slot] = types_table.hashes[i];
+    }
+
+    free(types_table.nodes);
+    free(types_table.hashes);
+    types_table.nodes = nodes;
+    types_table.hashes = hashes;
+    types_table.capacity = capacity;
+}
+
+ASTNode* types_get(const char* type_name, ASTList* args) {
+    type_name = intern(type_name);
+    uint32_t hash = types_hash(type_name, args);
+
+    pthread_mutex_lock(&types_table.lock);
+
+    if ((types_table.count + 1) * 4 > types_table.capacity * 3) {
+        types_grow();
+    }
+
+    uint32_t slot = hash & (types_table.capacity - 1);
+    while (types_table.nodes[slot]) {
+        ASTNode* node = types_table.nodes[slot];
+        if (types_table.hashes[slot] == hash && types_match(node, type_name, args)) {
+            pthread_mutex_unlock(&types_table.lock);
+
+            // The argument nodes are shared; only the list itself is ours
+            if (args) {
+                free(args->nodes);
+                free(args);
+            }
+            return node;
+        }
+        slot = (slot + 1) & (types_table.capacity - 1);
+    }
+
+    ASTNode* node = ast_node_new(AST_TYPE_ANNOTATION);
+    node->type_annotation.type_name = type_name;
+    node->type_annotation.generic_args = args;
+    node->type_annotation.shared = 1;
+
+    types_table.nodes[slot] = node;
+    types_table.hashes[slot] = hash;
+    types_table.count++;
+
+    pthread_mutex_unlock(&types_table.lock);
+    return node;
+}
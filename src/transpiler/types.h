@@ -0,0 +1,17 @@
+#ifndef TYPES_H
+#define TYPES_H
+
+#include "ast.h"
+
+// Hash-consed type annotations
+//
+// Every distinct type (name plus generic arguments) is a single shared
+// AST_TYPE_ANNOTATION node owned by a process-wide table, so two types are
+// equal exactly when their node pointers are. Shared nodes carry no source
+// position and are skipped by ast_node_free.
+
+// Returns the shared node for type_name<args>. Takes ownership of args,
+// whose items must themselves be shared types; NULL means no argument list.
+ASTNode* types_get(const char* type_name, ASTList* args);
+
+#endif
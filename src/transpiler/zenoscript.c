@@ -1,4 +1,11 @@
 #include "zenoscript.h"
+#include "parallel.h"
+#include "astbin.h"
+#include "json.h"
+#include "trace.h"
+#include "match.h"
+#include "tailcall.h"
+#include "lazy.h"
 
 #define ZENOSCRIPT_VERSION "1.0.0"
 
@@ -35,12 +42,84 @@ int zenoscript_write_file(const char* filename, const char* content) {
     return 1;
 }
 
+static ASTNode* zenoscript_parse_source(const char* source, ZenoscriptOptions* options, SymbolTable** symbols);
+static char* zenoscript_generate(ASTNode* ast, SymbolTable* symbols, const char* source_file, ZenoscriptOptions* options, char** declarations);
+
+// Drop top-level declarations that are unreachable from any side-effecting root
+static void zenoscript_eliminate_dead_code(ASTNode* ast, SymbolTable* symbols, ZenoscriptOptions* options) {
+    ASTList* declarations = ast->program.declarations;
+    if (symbols->count != declarations->count) return;
+    
+    symbols_mark_live(symbols);
+    
+    CodeGenerator* scratch = NULL;
+    if (options->verbose) {
+        scratch = codegen_new();
+    }
+    
+    int removed = 0;
+    int kept = 0;
+    for (int i = 0; i < declarations->count; i++) {
+        ASTNode* decl = declarations->nodes[i];
+        
+        if (symbols_is_live(symbols, i)) {
+            declarations->nodes[kept++] = decl;
+            continue;
+        }
+        
+        if (scratch) {
+            codegen_generate_declaration(scratch, decl);
+        }
+        ast_node_free(decl);
+        removed++;
+    }
+    declarations->count = kept;
+    
+    if (scratch) {
+        printf("Dead code elimination: removed %d declaration(s), %d bytes\n", removed, scratch->length);
+        codegen_free(scratch);
+    }
+}
+
 char* zenoscript_transpile_string(const char* source, ZenoscriptOptions* options) {
+    TraceSpan span = trace_begin("transpile");
+    SymbolTable* symbols = NULL;
+    ASTNode* ast = zenoscript_parse_source(source, options, &symbols);
+    if (!ast) {
+        trace_end(span, NULL);
+        return NULL;
+    }
+    
+    char* typescript_code = zenoscript_generate(ast, symbols, NULL, options, NULL);
+    ast_node_free(ast);
+    symbols_free(symbols);
+    trace_end(span, NULL);
+    return typescript_code;
+}
+
+static int zenoscript_thread_count(ZenoscriptOptions* options) {
+    return options && options->threads > 0 ? options->threads : parallel_default_threads();
+}
+
+// Parse source into a program AST and the symbol table dead code elimination needs
+static ASTNode* zenoscript_parse_source(const char* source, ZenoscriptOptions* options, SymbolTable** symbols) {
     if (!source) {
         fprintf(stderr, "Error: No source code provided\n");
         return NULL;
     }
     
+    // Large sources are split across threads first
+    int threads = zenoscript_thread_count(options);
+    if (threads > 1 && strlen(source) >= PARALLEL_PARSE_MIN_SIZE) {
+        ASTNode* ast = parallel_parse_program(source, threads, symbols);
+        if (ast) {
+            if (options && options->verbose) {
+                printf("Parsed in parallel on %d threads\n", threads);
+            }
+            return ast;
+        }
+    }
+    
     // Create lexer
     Lexer* lexer = lexer_new(source);
     if (!lexer) {
@@ -48,52 +127,183 @@ char* zenoscript_transpile_string(const char* source, ZenoscriptOptions* options
         return NULL;
     }
     
+    // Large sources are lexed on a second thread while the parser consumes
+    // tokens; everything else is lexed into one array up front
+    TokenBuffer* buffer = NULL;
+    TokenStream* stream = NULL;
+    if (threads > 1 && strlen(source) >= PARALLEL_PARSE_MIN_SIZE) {
+        stream = token_stream_start(lexer);
+    }
+    if (!stream) {
+        TraceSpan lex_span = trace_begin("lex");
+        buffer = token_buffer_lex(lexer);
+        trace_end(lex_span, NULL);
+    }
+    
     // Create parser
-    Parser* parser = parser_new(lexer);
+    Parser* parser = stream ? parser_new_streamed(stream) : parser_new_buffered(buffer);
     if (!parser) {
         fprintf(stderr, "Error: Failed to create parser\n");
+        token_stream_free(stream);
+        token_buffer_free(buffer);
         lexer_free(lexer);
         return NULL;
     }
     
     // Parse source code
+    TraceSpan parse_span = trace_begin("parse");
     ASTNode* ast = parser_parse(parser);
+    trace_end(parse_span, NULL);
     if (!ast || parser_has_errors(parser)) {
         fprintf(stderr, "Error: Parsing failed\n");
         if (parser_has_errors(parser)) {
             fprintf(stderr, "Parse error: %s\n", parser_get_error(parser));
         }
+        ast_node_free(ast);
         parser_free(parser);
+        token_stream_free(stream);
+        token_buffer_free(buffer);
         lexer_free(lexer);
         return NULL;
     }
     
+    *symbols = parser->symbols;
+    parser->symbols = NULL;
+    
+    parser_free(parser);
+    token_stream_free(stream);
+    token_buffer_free(buffer);
+    lexer_free(lexer);
+    return ast;
+}
+
+// Generate code for a parsed program, optionally producing the .d.ts declaration surface alongside;
+// source_file names the program in traced output and may be NULL
+static char* zenoscript_generate(ASTNode* ast, SymbolTable* symbols, const char* source_file, ZenoscriptOptions* options, char** declarations) {
+    if (options && options->eliminate_dead_code) {
+        if (symbols) {
+            TraceSpan span = trace_begin("dce");
+            zenoscript_eliminate_dead_code(ast, symbols, options);
+            trace_end(span, NULL);
+        } else {
+            fprintf(stderr, "Warning: --dce needs the original source, skipping\n");
+        }
+    }
+    
+    if (options && options->profile_use) {
+        Profile* profile = profile_load(options->profile_use);
+        if (!profile) {
+            return NULL;
+        }
+        
+        int reordered = profile_reorder_matches(ast, profile, source_file ? source_file : "<input>");
+        profile_free(profile);
+        if (options->verbose) {
+            printf("Reordered arms of %d match expression%s\n", reordered, reordered == 1 ? "" : "s");
+        }
+    }
+    
+    TraceSpan match_span = trace_begin("exhaustiveness");
+    match_check_exhaustive(ast);
+    trace_end(match_span, NULL);
+    
+    TraceSpan tail_span = trace_begin("tail calls");
+    int loops = tailcall_mark(ast);
+    trace_end(tail_span, NULL);
+    if (options && options->verbose && loops > 0) {
+        printf("Turned %d self-recursive function%s into loops\n", loops, loops == 1 ? "" : "s");
+    }
+    
+    TraceSpan lazy_span = trace_begin("lazy bindings");
+    int deferred = lazy_mark(ast);
+    trace_end(lazy_span, NULL);
+    if (options && options->verbose && deferred > 0) {
+        printf("Deferred %d lazy binding%s to first use\n", deferred, deferred == 1 ? "" : "s");
+    }
+    
     if (options && options->debug) {
         printf("=== AST ===\n");
         ast_print(ast, 0);
-        printf("\n=== Generated TypeScript ===\n");
+        printf("\n=== Generated %s ===\n", options->emit_js ? "JavaScript" : "TypeScript");
     }
     
-    // Generate TypeScript code
-    char* typescript_code = codegen_generate(ast);
+    // Generate TypeScript (or type-stripped JavaScript) code
+    CodegenOptions codegen_options = {0};
+    if (options) {
+        codegen_options.emit_js = options->emit_js;
+        codegen_options.minify = options->minify;
+        codegen_options.struct_factories = options->struct_factories;
+        codegen_options.static_dispatch = options->static_dispatch;
+        codegen_options.instrument = options->instrument;
+        codegen_options.trace_pipes = options->trace_pipes;
+    }
+    codegen_options.source_file = source_file;
+    codegen_options.threads = zenoscript_thread_count(options);
+    TraceSpan span = trace_begin("codegen");
+    char* typescript_code = codegen_generate_with_options(ast, &codegen_options);
+    trace_end(span, NULL);
     
-    // Cleanup
-    ast_node_free(ast);
-    parser_free(parser);
-    lexer_free(lexer);
+    if (declarations) {
+        span = trace_begin("declarations");
+        *declarations = codegen_generate_declaration_file(ast, &codegen_options);
+        trace_end(span, NULL);
+    }
     
     return typescript_code;
 }
 
-int zenoscript_transpile_file(const char* input_file, const char* output_file, ZenoscriptOptions* options) {
-    if (!input_file) {
-        fprintf(stderr, "Error: No input file specified\n");
+// Load a program previously written with --emit-ast=bin
+static ASTNode* zenoscript_load_binary_ast(const char* input_file) {
+    ASTBinary* bin = astbin_open(input_file);
+    if (!bin) {
+        return NULL;
+    }
+    
+    ASTNode* ast = astbin_to_ast(bin);
+    astbin_close(bin);
+    return ast;
+}
+
+// main.js -> main.d.ts, next to the generated output
+static char* zenoscript_declaration_path(const char* output_file) {
+    const char* slash = strrchr(output_file, '/');
+    const char* dot = strrchr(output_file, '.');
+    size_t base_length = (dot && (!slash || dot > slash)) ? (size_t)(dot - output_file) : strlen(output_file);
+    
+    char* path = malloc(base_length + strlen(".d.ts") + 1);
+    memcpy(path, output_file, base_length);
+    strcpy(path + base_length, ".d.ts");
+    return path;
+}
+
+// Write the token stream of source, or the given AST, as a JSON document
+static int zenoscript_dump_json(const char* output_file, const char* source, ASTNode* ast) {
+    FILE* out = output_file ? fopen(output_file, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "Error: Cannot write to file '%s'\n", output_file);
         return 0;
     }
     
-    // Read input file
-    char* source = zenoscript_read_file(input_file);
-    if (!source) {
+    JsonWriter* writer = json_writer_new(out);
+    if (source) {
+        json_write_tokens(writer, source);
+    } else {
+        json_write_ast(writer, ast);
+    }
+    json_writer_free(writer);
+    fputc('\n', out);
+    
+    int success = !ferror(out);
+    if (output_file) {
+        success = fclose(out) == 0 && success;
+    }
+    return success;
+}
+
+// Everything zenoscript_transpile_file does, inside its trace span
+static int zenoscript_transpile_input(const char* input_file, const char* output_file, ZenoscriptOptions* options) {
+    if (!input_file) {
+        fprintf(stderr, "Error: No input file specified\n");
         return 0;
     }
     
@@ -101,30 +311,105 @@ int zenoscript_transpile_file(const char* input_file, const char* output_file, Z
         printf("Transpiling '%s'...\n", input_file);
     }
     
+    // Parse the source, or skip lexing and parsing entirely for a cached binary AST
+    ASTNode* ast = NULL;
+    SymbolTable* symbols = NULL;
+    if (astbin_is_file(input_file)) {
+        trace_instant("cache hit", input_file);
+        TraceSpan span = trace_begin("load ast");
+        ast = zenoscript_load_binary_ast(input_file);
+        trace_end(span, input_file);
+    } else {
+        TraceSpan span = trace_begin("read");
+        char* source = zenoscript_read_file(input_file);
+        trace_end(span, input_file);
+        if (!source) {
+            return 0;
+        }
+        
+        if (options && options->dump_tokens) {
+            int success = zenoscript_dump_json(output_file, source, NULL);
+            free(source);
+            return success;
+        }
+        
+        ast = zenoscript_parse_source(source, options, &symbols);
+        free(source);
+    }
+    
+    if (!ast) {
+        return 0;
+    }
+    
+    if (options && options->dump_ast) {
+        int success = zenoscript_dump_json(output_file, NULL, ast);
+        ast_node_free(ast);
+        symbols_free(symbols);
+        return success;
+    }
+    
+    if (options && options->emit_ast) {
+        int success = astbin_write_file(output_file, ast);
+        if (success && output_file && options->verbose) {
+            printf("Binary AST written to '%s'\n", output_file);
+        }
+        ast_node_free(ast);
+        symbols_free(symbols);
+        return success;
+    }
+    
     // Transpile source code
-    char* typescript_code = zenoscript_transpile_string(source, options);
-    free(source);
+    char* declarations = NULL;
+    int want_declarations = options && options->emit_declarations;
+    if (want_declarations && !output_file) {
+        fprintf(stderr, "Warning: --declarations requires an output file, skipping .d.ts\n");
+        want_declarations = 0;
+    }
+    
+    char* typescript_code = zenoscript_generate(ast, symbols, input_file, options, want_declarations ? &declarations : NULL);
+    ast_node_free(ast);
+    symbols_free(symbols);
     
     if (!typescript_code) {
         return 0;
     }
     
     // Write output
+    TraceSpan span = trace_begin("write");
     if (output_file) {
         int success = zenoscript_write_file(output_file, typescript_code);
         if (success && options && options->verbose) {
             printf("Output written to '%s'\n", output_file);
         }
         free(typescript_code);
+        
+        if (success && declarations) {
+            char* declaration_file = zenoscript_declaration_path(output_file);
+            success = zenoscript_write_file(declaration_file, declarations);
+            if (success && options->verbose) {
+                printf("Declarations written to '%s'\n", declaration_file);
+            }
+            free(declaration_file);
+        }
+        free(declarations);
+        trace_end(span, output_file);
         return success;
     } else {
         // Print to stdout
         printf("%s", typescript_code);
         free(typescript_code);
+        trace_end(span, NULL);
         return 1;
     }
 }
 
+int zenoscript_transpile_file(const char* input_file, const char* output_file, ZenoscriptOptions* options) {
+    TraceSpan span = trace_begin("transpile");
+    int success = zenoscript_transpile_input(input_file, output_file, options);
+    trace_end(span, input_file);
+    return success;
+}
+
 void zenoscript_print_tokens(const char* source) {
     Lexer* lexer = lexer_new(source);
     Token token;
@@ -204,11 +489,29 @@ void zenoscript_print_help(void) {
     printf("    -h, --help       Show this help message\n");
     printf("    -v, --version    Show version information\n");
     printf("    -V, --verbose    Enable verbose output\n");
-    printf("    -d, --debug      Enable debug output (show AST)\n\n");
+    printf("    -d, --debug      Enable debug output (show AST)\n");
+    printf("    --dce            Drop unreferenced declarations without side effects\n");
+    printf("    --emit <ts|js>   Output language (default: ts); js omits all type syntax\n");
+    printf("    --declarations   Also write a .d.ts file next to the output file\n");
+    printf("    --minify         Emit compact output without insignificant whitespace\n");
+    printf("    --struct-factories  Emit a constructor function for every struct\n");
+    printf("    --static-dispatch   Emit trait methods as top-level functions and call them directly\n");
+    printf("    -j, --threads <n>   Worker threads for large files (default: one per core)\n");
+    printf("    --emit-ast=bin      Write the parsed AST in binary form instead of code;\n");
+    printf("                        binary AST input files are detected and compiled directly\n");
+    printf("    --dump-tokens=json  Write the token stream as JSON instead of code\n");
+    printf("    --dump-ast=json     Write the parsed AST as JSON instead of code\n");
+    printf("    --trace <file>      Write a Chrome/Perfetto trace of the build phases\n");
+    printf("    --instrument <file> Count match arm hits and write them to <file> on exit\n");
+    printf("    --profile-use <file>  Test the most frequent match arms first, using counts\n");
+    printf("                        from an --instrument run\n");
+    printf("    --trace-pipes       Time a sample of pipe stage calls at run time; read the\n");
+    printf("                        results with pipeStats() from zenoscript's pipes module\n\n");
     printf("EXAMPLES:\n");
     printf("    zeno main.zs               # Output to stdout\n");
     printf("    zeno main.zs main.ts       # Output to file\n");
-    printf("    zeno --debug main.zs       # Show AST and output\n\n");
+    printf("    zeno --debug main.zs       # Show AST and output\n");
+    printf("    zeno --emit js --declarations main.zs main.js\n\n");
     printf("NOTE:\n");
     printf("    This is the core transpiler binary. For full CLI features including\n");
     printf("    project management (init, setup, repl), use the main 'zeno' command.\n");
@@ -13,6 +13,19 @@ typedef struct {
     char* source_code;
     int verbose;
     int debug;
+    int eliminate_dead_code;
+    int emit_js;
+    int emit_declarations;
+    int minify;
+    int struct_factories;
+    int static_dispatch;
+    int threads;            // Parser and codegen threads for large inputs (0 = one per core)
+    int emit_ast;           // Write the binary AST instead of generated code
+    int dump_tokens;        // Write the token stream as JSON instead of generated code
+    int dump_ast;           // Write the AST as JSON instead of generated code
+    char* instrument;       // Emit match arm counters that are written to this profile at exit
+    char* profile_use;      // Order match arms by the counts in this profile
+    int trace_pipes;        // Emit sampled timing of every pipe stage
 } ZenoscriptOptions;
 
 // Main functions
@@ -0,0 +1,182 @@
+import { test, expect, beforeAll, afterAll } from "bun:test";
+import { spawn } from "bun";
+import { join } from "path";
+import { mkdtempSync, rmSync } from "fs";
+import { tmpdir } from "os";
+
+// The core transpiler sources, and the binary `make` builds from them
+const TRANSPILER_DIR = join(import.meta.dir, "..", "src", "transpiler");
+const ZENO_BINARY = join(import.meta.dir, "..", "build", "zeno");
+
+let testDir: string;
+
+beforeAll(() => {
+  testDir = mkdtempSync(join(tmpdir(), "zeno-native-"));
+});
+
+afterAll(() => {
+  rmSync(testDir, { recursive: true, force: true });
+});
+
+async function runZeno(args: string[]) {
+  const zeno = spawn({
+    cmd: [ZENO_BINARY, ...args],
+    cwd: testDir,
+    stdout: "pipe",
+    stderr: "pipe",
+  });
+
+  const timeout = setTimeout(() => {
+    zeno.kill();
+  }, 60000);
+
+  const exitCode = await zeno.exited;
+  clearTimeout(timeout);
+
+  const stdout = await new Response(zeno.stdout).text();
+  const stderr = await new Response(zeno.stderr).text();
+
+  return { exitCode, stdout, stderr };
+}
+
+const DEPTH = 100000;
+
+const deepSources: Record<string, string> = {
+  pipes: "let r = 1" + " |> String".repeat(DEPTH),
+  parens: "let r = " + "(".repeat(DEPTH) + "1" + ")".repeat(DEPTH),
+  matches: "let r = " + "match 1 { _ => ".repeat(DEPTH) + "1" + " }".repeat(DEPTH),
+};
+
+for (const [name, source] of Object.entries(deepSources)) {
+  test(`native - ${DEPTH} nested ${name} transpile`, async () => {
+    await Bun.write(join(testDir, `${name}.zs`), source + "\n");
+
+    const result = await runZeno(["--emit", "js", `${name}.zs`, `${name}.js`]);
+    expect(result.stderr).toBe("");
+    expect(result.exitCode).toBe(0);
+
+    const output = await Bun.file(join(testDir, `${name}.js`)).text();
+    expect(output.startsWith("const r = ")).toBe(true);
+  }, 120000);
+}
+
+test("native - string and atom literals are written without allocating", async () => {
+  // `make test` builds and runs src/transpiler/tests/alloc_count.c
+  const make = spawn({
+    cmd: ["make", "-s", "-C", TRANSPILER_DIR, "test"],
+    stdout: "pipe",
+    stderr: "pipe",
+  });
+
+  const exitCode = await make.exited;
+  const stderr = await new Response(make.stderr).text();
+  expect(stderr).toBe("");
+  expect(exitCode).toBe(0);
+}, 120000);
+
+// Large enough to take the parallel parse and codegen paths
+const PARALLEL_GROUPS = 500;
+
+function generateParallelModule(): string {
+  const parts: string[] = [];
+  for (let i = 0; i < PARALLEL_GROUPS; i++) {
+    parts.push(`struct User${i} {
+  name: string;
+}
+trait Show${i} {
+  show(): string;
+}
+impl Show${i} for User${i} {
+  show() {
+    "user ${i}"
+  }
+}
+let message${i} = match :ok {
+  :ok => "Success ${i}"
+  _ => "Unknown"
+}
+let greeting${i} = "  Hello ${i}  " |> trim |> toUpperCase
+let record${i} = { id: ${i}, tags: ["a", :b], nested: { ok: true } }
+`);
+  }
+  return parts.join("\n");
+}
+
+test("native - -j1 and -jN output is byte-identical", async () => {
+  await Bun.write(join(testDir, "parallel.zs"), generateParallelModule());
+
+  const outputs: string[] = [];
+  for (const threads of [1, 2, 4, 16]) {
+    const output = `parallel-${threads}.ts`;
+    const result = await runZeno(["-j", String(threads), "parallel.zs", output]);
+    expect(result.stderr).toBe("");
+    expect(result.exitCode).toBe(0);
+    outputs.push(await Bun.file(join(testDir, output)).text());
+  }
+
+  expect(outputs[0].length).toBeGreaterThan(64 * 1024);
+  for (const output of outputs) {
+    expect(output).toBe(outputs[0]);
+  }
+}, 120000);
+
+test("native - compiling the .zast written by --emit-ast bin matches compiling the source", async () => {
+  await Bun.write(join(testDir, "roundtrip.zs"), generateParallelModule());
+
+  const saved = await runZeno(["--emit-ast", "bin", "roundtrip.zs", "roundtrip.zast"]);
+  expect(saved.stderr).toBe("");
+  expect(saved.exitCode).toBe(0);
+
+  for (const flags of [[], ["--emit", "js"], ["--minify"]]) {
+    const direct = await runZeno([...flags, "roundtrip.zs", "direct.ts"]);
+    const loaded = await runZeno([...flags, "roundtrip.zast", "loaded.ts"]);
+    expect(direct.exitCode).toBe(0);
+    expect(loaded.stderr).toBe("");
+    expect(loaded.exitCode).toBe(0);
+    expect(await Bun.file(join(testDir, "loaded.ts")).text()).toBe(await Bun.file(join(testDir, "direct.ts")).text());
+  }
+}, 120000);
+
+test("native - a corrupted .zast is rejected", async () => {
+  await Bun.write(join(testDir, "corrupt.zs"), 'let greeting = "  hi  " |> trim\n');
+  const saved = await runZeno(["--emit-ast", "bin", "corrupt.zs", "corrupt.zast"]);
+  expect(saved.exitCode).toBe(0);
+
+  // Flip one byte of the payload, past the header
+  const bytes = new Uint8Array(await Bun.file(join(testDir, "corrupt.zast")).arrayBuffer());
+  bytes[bytes.length - 2] ^= 0xff;
+  await Bun.write(join(testDir, "corrupt.zast"), bytes);
+
+  const result = await runZeno(["corrupt.zast", "corrupt.ts"]);
+  expect(result.exitCode).not.toBe(0);
+  expect(result.stderr).toContain("checksum mismatch");
+});
+
+test("native - --dump-ast=json and --dump-tokens=json write parseable JSON", async () => {
+  // Quotes, backslashes, control characters and U+2028 all go through the shared escaper
+  await Bun.write(join(testDir, "dump.zs"), 'let s = "a\\"b\\\\c\\n\ttab \u2028 \u0001" |> trim\nlet k = :ok\n');
+  const text = "a\"b\\c\n\ttab \u2028 \u0001";
+
+  const ast = await runZeno(["--dump-ast=json", "dump.zs"]);
+  expect(ast.exitCode).toBe(0);
+  expect(ast.stdout).toContain("\\u2028");
+  const program = JSON.parse(ast.stdout);
+  expect(program.type).toBe("PROGRAM");
+  expect(program.declarations.map((decl: any) => decl.type)).toEqual(["LET_BINDING", "LET_BINDING"]);
+
+  const [s, k] = program.declarations;
+  expect([s.name, s.line, s.column]).toEqual(["s", 1, 1]);
+  expect(s.value.type).toBe("PIPE_EXPR");
+  expect(s.value.left).toEqual({ type: "STRING_LITERAL", line: 1, column: 9, value: text });
+  expect(s.value.right).toEqual({ type: "IDENTIFIER", line: 1, column: 34, name: "trim" });
+  expect(k.value).toEqual({ type: "ATOM_LITERAL", line: 2, column: 9, value: ":ok" });
+
+  const tokens = await runZeno(["--dump-tokens=json", "dump.zs"]);
+  expect(tokens.exitCode).toBe(0);
+  const list = JSON.parse(tokens.stdout);
+  expect(list[3]).toEqual({ type: "STRING", value: text, line: 1, column: 9 });
+  expect(list.slice(-2)).toEqual([
+    { type: "NEWLINE", value: "\n", line: 2, column: 12 },
+    { type: "EOF", value: null, line: 3, column: 1 },
+  ]);
+});
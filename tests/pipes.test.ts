@@ -0,0 +1,102 @@
+import { test, expect, beforeEach } from "bun:test";
+import { spawn } from "bun";
+import { join } from "path";
+import { mkdtempSync, rmSync } from "fs";
+import { tmpdir } from "os";
+import { pipeStats, resetPipeStats, setPipeSampleRate } from "../src/pipes.ts";
+
+const ZENO_BINARY = join(import.meta.dir, "..", "build", "zeno");
+
+// The shape `zeno --trace-pipes` sets up on globalThis, with a tiny ring
+function installTraceState(capacity: number) {
+  const state = {
+    capacity,
+    rate: 64,
+    countdown: 64,
+    next: 0,
+    files: ["a.zs", "a.zs", "b.zs"],
+    lines: [3, 3, 7],
+    sites: new Uint32Array(capacity),
+    times: new Float64Array(capacity),
+  };
+  (globalThis as any).__zenoPipes = state;
+  return state;
+}
+
+function record(state: ReturnType<typeof installTraceState>, site: number, time: number) {
+  const slot = state.next++ & (state.capacity - 1);
+  state.sites[slot] = site;
+  state.times[slot] = time;
+}
+
+beforeEach(() => {
+  delete (globalThis as any).__zenoPipes;
+});
+
+test("pipes - no traced module loaded", () => {
+  expect(pipeStats()).toEqual([]);
+});
+
+test("pipes - aggregates by file and line, slowest first", () => {
+  const state = installTraceState(8);
+  record(state, 0, 1);
+  record(state, 1, 3);
+  record(state, 2, 10);
+
+  const stats = pipeStats();
+  expect(stats.length).toBe(2);
+  expect(stats[0]).toEqual({ file: "b.zs", line: 7, samples: 1, totalMs: 10, meanMs: 10, maxMs: 10 });
+  expect(stats[1]).toEqual({ file: "a.zs", line: 3, samples: 2, totalMs: 4, meanMs: 2, maxMs: 3 });
+});
+
+test("pipes - only the most recent samples are kept", () => {
+  const state = installTraceState(4);
+  for (let i = 0; i < 10; i++) {
+    record(state, i < 6 ? 2 : 0, 1);
+  }
+
+  const stats = pipeStats();
+  expect(stats.map((entry) => entry.samples).reduce((a, b) => a + b)).toBe(4);
+  expect(stats[0].file).toBe("a.zs");
+});
+
+test("pipes - reset and sample rate", () => {
+  const state = installTraceState(8);
+  record(state, 0, 1);
+  resetPipeStats();
+  expect(pipeStats()).toEqual([]);
+
+  setPipeSampleRate(1);
+  expect(state.rate).toBe(1);
+  expect(state.countdown).toBe(1);
+});
+
+test("pipes - a loop samples every stage", async () => {
+  // Four stage calls per iteration, a divisor of the default rate of 64
+  const dir = mkdtempSync(join(tmpdir(), "zeno-pipes-"));
+  try {
+    await Bun.write(join(dir, "stages.zs"), [
+      "let magnitude = (x) => x |> Math.abs",
+      "let text = (x) => x |> String",
+      "export let run = (x) => x |> magnitude |> text",
+    ].join("\n"));
+
+    const zeno = spawn({
+      cmd: [ZENO_BINARY, "--emit", "js", "--trace-pipes", "stages.zs", "stages.js"],
+      cwd: dir,
+      stdout: "pipe",
+      stderr: "pipe",
+    });
+    expect(await zeno.exited).toBe(0);
+
+    const { run } = await import(join(dir, "stages.js"));
+    for (let i = 0; i < 100000; i++) {
+      run(i);
+    }
+
+    const lines = pipeStats().map((entry) => entry.line).sort();
+    expect(lines).toEqual([1, 2, 3]);
+  } finally {
+    rmSync(dir, { recursive: true, force: true });
+  }
+});
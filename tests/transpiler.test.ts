@@ -1,6 +1,22 @@
-import { test, expect } from "bun:test";
+import { test, expect, beforeAll, afterAll } from "bun:test";
+import { spawn } from "bun";
+import { join } from "path";
+import { mkdirSync, mkdtempSync, rmSync } from "fs";
+import { tmpdir } from "os";
 import { ZenoscriptTranspiler } from "../src/transpiler.ts";
 
+const ZENO_BINARY = join(import.meta.dir, "..", "build", "zeno");
+
+let testDir: string;
+
+beforeAll(() => {
+  testDir = mkdtempSync(join(tmpdir(), "zeno-transpiler-"));
+});
+
+afterAll(() => {
+  rmSync(testDir, { recursive: true, force: true });
+});
+
 async function transpileSource(source: string) {
   const transpiler = new ZenoscriptTranspiler({ verbose: false, debug: false });
   
@@ -316,4 +332,710 @@ test("transpiler - let binding with pipe in same line", async () => {
   const result = await transpileSource(source);
   expect(result.exitCode).toBe(0);
   expect(result.stdout).toContain('const result = data.transform().validate();');
-});
\ No newline at end of file
+});
+// The native transpiler, build/zeno
+
+async function runZeno(args: string[]) {
+  const zeno = spawn({
+    cmd: [ZENO_BINARY, ...args],
+    cwd: testDir,
+    stdout: "pipe",
+    stderr: "pipe",
+  });
+
+  const exitCode = await zeno.exited;
+  const stdout = await new Response(zeno.stdout).text();
+  const stderr = await new Response(zeno.stderr).text();
+
+  return { exitCode, stdout, stderr };
+}
+
+// Compile source as testDir/name.zs into name.js; output is the file written
+async function compileNative(name: string, source: string, flags: string[] = []) {
+  await Bun.write(join(testDir, `${name}.zs`), source);
+  const result = await runZeno([...flags, `${name}.zs`, `${name}.js`]);
+  const output = result.exitCode === 0 ? await Bun.file(join(testDir, `${name}.js`)).text() : "";
+  return { ...result, output };
+}
+
+// Compile source as JavaScript and import the module; name must be unique
+async function importNative(name: string, source: string, flags: string[] = []) {
+  const result = await compileNative(name, source, ["--emit", "js", ...flags]);
+  expect(result.stderr).toBe("");
+  expect(result.exitCode).toBe(0);
+  return { ...result, module: await import(join(testDir, `${name}.js`)) };
+}
+
+test("native - top-level object literal is an expression statement", async () => {
+  const source = `console.log(1)
+{ a: 1, b: 2 }
+{ a: "x", nested: { b: [1, 2] } }`;
+
+  for (const flags of [["--emit", "js"], ["--emit", "js", "--minify"]]) {
+    const result = await compileNative("object-statement", source, flags);
+    expect(result.exitCode).toBe(0);
+    expect(result.output).toContain("({");
+    // A block would reject the property colons
+    expect(() => new Function(result.output)).not.toThrow();
+  }
+});
+
+test("native - match array patterns: exact length, rest and literal elements", async () => {
+  const { module } = await importNative("match-array", `export let shape = (v) => match v {
+  [] => "empty"
+  [x] => ["one", x]
+  [1, y] => ["starts with one", y]
+  [x, y, ...rest] => ["many", x, y, rest]
+  _ => "other"
+}`);
+
+  expect(module.shape([])).toBe("empty");
+  expect(module.shape([7])).toEqual(["one", 7]);
+  expect(module.shape([1, 9])).toEqual(["starts with one", 9]);
+  expect(module.shape([2, 9])).toEqual(["many", 2, 9, []]);
+  expect(module.shape([1, 2, 3, 4])).toEqual(["many", 1, 2, [3, 4]]);
+  expect(module.shape("x")).toBe("other");
+});
+
+test("native - match nested object patterns bind their fields", async () => {
+  const { module } = await importNative("match-object", `export let describe = (shape) => match shape {
+  { kind: "circle", center: { x, y }, r } => ["circle", x, y, r]
+  { kind: "rect", size: [w, h] } => ["rect", w, h]
+  { kind } => ["unknown", kind]
+  _ => "not a shape"
+}`);
+
+  expect(module.describe({ kind: "circle", center: { x: 1, y: 2 }, r: 3 })).toEqual(["circle", 1, 2, 3]);
+  expect(module.describe({ kind: "circle", center: 5, r: 3 })).toEqual(["unknown", "circle"]);
+  expect(module.describe({ kind: "rect", size: [4, 5] })).toEqual(["rect", 4, 5]);
+  expect(module.describe({ kind: "rect", size: [4] })).toEqual(["unknown", "rect"]);
+  expect(module.describe({ kind: "line" })).toEqual(["unknown", "line"]);
+  expect(module.describe(null)).toBe("not a shape");
+});
+
+test("native - match branches reaching the same arms share one node", async () => {
+  const { output, module } = await importNative("match-shared", `export let classify = (v) => match v {
+  [] => "empty"
+  [x] => ["one", x]
+  [1, y] => ["one then", y]
+  [x, y, ...rest] => ["many", rest]
+  { kind: "a", n } => ["a", n]
+  { kind } => ["kind", kind]
+  _ => "other"
+}`);
+
+  // Arrays that fit no array arm and other objects continue after one block
+  expect(output).toMatch(/break __match_case_\d+;/);
+  expect(output.match(/const kind = /g)?.length).toBe(1);
+
+  expect(module.classify([])).toBe("empty");
+  expect(module.classify([5])).toEqual(["one", 5]);
+  expect(module.classify([1, 6])).toEqual(["one then", 6]);
+  expect(module.classify([2, 6, 7])).toEqual(["many", [7]]);
+  expect(module.classify({ kind: "a", n: 3 })).toEqual(["a", 3]);
+  expect(module.classify({ kind: "b" })).toEqual(["kind", "b"]);
+  expect(module.classify(4)).toBe("other");
+});
+
+test("native - match arms past MATCH_TREE_BUDGET are tested one after another", async () => {
+  // Found by search: the arms left differ on nearly every path, so the tree
+  // outgrows its budget of nodes per pattern node
+  const arms = [
+    { k6: 2, k3: 2 }, { k1: 2, k5: 2, k0: 2 }, { k7: 2, k5: 1 }, { k4: 1, k0: 3 }, { k2: 3, k0: 1 },
+    { k4: 3 }, { k5: 3 }, { k1: 2 }, { k2: 1 }, { k1: 1 }, { k4: 2 }, { k7: 3 }, { k3: 3 },
+  ];
+  const patterns = arms.map((arm, i) => `  { ${Object.entries(arm).map(([key, value]) => `${key}: ${value}`).join(", ")} } => ${i}`);
+  const { output, module } = await importNative("match-budget", `export let pick = (v) => match v {
+${patterns.join("\n")}
+  _ => -1
+}`);
+
+  // Each arm makes its own tests
+  expect(output.match(/typeof __match_value === "object"/g)?.length).toBe(arms.length);
+
+  const expected = (input: Record<string, number>) =>
+    arms.findIndex((arm) => Object.entries(arm).every(([key, value]) => input[key] === value));
+  for (let code = 0; code < 3 ** 8; code++) {
+    const input: Record<string, number> = {};
+    for (let key = 0, rest = code; key < 8; key++, rest = Math.floor(rest / 3)) {
+      input[`k${key}`] = 1 + (rest % 3);
+    }
+    expect(module.pick(input)).toBe(expected(input));
+  }
+  expect(module.pick("x")).toBe(-1);
+});
+
+test("native - match arm with a failing guard falls through to the next", async () => {
+  const { module } = await importNative("match-guard", `export let kind = (v) => match v {
+  [x] when Number.isInteger(x) => "integer"
+  [x] => "one"
+  { n } when Number.isInteger(n) => "integer field"
+  _ => "other"
+}`);
+
+  expect(module.kind([3])).toBe("integer");
+  expect(module.kind([3.5])).toBe("one");
+  expect(module.kind({ n: 2 })).toBe("integer field");
+  expect(module.kind({ n: "2" })).toBe("other");
+  expect(module.kind([])).toBe("other");
+});
+
+test("native - match with no arm left throws", async () => {
+  const { module } = await importNative("match-throw", `export let size = (v) => match v {
+  [x] => 1
+  [x, y] => 2
+}`);
+
+  expect(module.size([1, 2])).toBe(2);
+  expect(() => module.size([])).toThrow("Non-exhaustive match");
+  expect(() => module.size("x")).toThrow("Non-exhaustive match");
+});
+
+// Arithmetic for native test programs, which have no binary operators
+async function writeNumbers() {
+  await Bun.write(join(testDir, "numbers.js"), "export const inc = (n) => n + 1;\nexport const dec = (n) => n - 1;\n");
+}
+
+test("native - self tail calls in match arms run as a loop", async () => {
+  await writeNumbers();
+  const { output, module } = await importNative("tail-count", `import { inc, dec } from "./numbers.js"
+export let count = (n, acc) => match n {
+  0 => acc
+  _ => count(n |> dec, acc |> inc)
+}`);
+
+  expect(output).toContain("while (true)");
+  expect(module.count(1000000, 0)).toBe(1000000);
+});
+
+test("native - tail call arguments are evaluated before any parameter is assigned", async () => {
+  await writeNumbers();
+  const { output, module } = await importNative("tail-swap", `import { dec } from "./numbers.js"
+export let swap = (a, b, n) => match n {
+  0 => [a, b]
+  _ => swap(b, a, n |> dec)
+}`);
+
+  expect(output).toContain("const __tail_0 = b;");
+  expect(output).toContain("const __tail_1 = a;");
+  expect(output).toContain("a = __tail_0;");
+  expect(module.swap(1, 2, 3)).toEqual([2, 1]);
+  expect(module.swap(1, 2, 4)).toEqual([1, 2]);
+});
+
+test("native - a self call outside tail position stays recursive", async () => {
+  await writeNumbers();
+  const { output, module } = await importNative("tail-depth", `import { inc, dec } from "./numbers.js"
+export let depth = (n) => match n {
+  0 => 0
+  _ => depth(n |> dec) |> inc
+}`);
+
+  expect(output).not.toContain("while (true)");
+  expect(output).toContain("return inc(depth(dec(n)));");
+  expect(module.depth(100)).toBe(100);
+});
+
+test("native - calls through a name shadowing the function are not tail loops", async () => {
+  const { output, module } = await importNative("tail-shadow", `export let apply = (apply, n) => match n {
+  0 => "done"
+  _ => apply(n)
+}
+export let call = (xs, n) => match xs {
+  [call, ...rest] => call(rest, n)
+  _ => n
+}
+export let last = (xs, acc) => match xs {
+  [] => acc
+  [acc, ...rest] => last(rest, acc)
+}`);
+
+  expect(output).not.toContain("while (true)");
+  expect(module.apply((n: number) => ["called", n], 3)).toEqual(["called", 3]);
+  expect(module.call([(rest: number[], n: number) => ["inner", rest, n], 1, 2], 5)).toEqual(["inner", [1, 2], 5]);
+  expect(module.last([1, 2, 3], 0)).toBe(3);
+});
+
+// Stages that record every value they are called with
+async function writeCounted() {
+  await Bun.write(join(testDir, "counted.js"), `export const seen = [];
+export const double = (n) => (seen.push(n), n * 2);
+export const even = (n) => n % 2 === 0;
+export function* naturals() {
+  for (let n = 0; ; n++) yield n;
+}
+`);
+  return await import(join(testDir, "counted.js"));
+}
+
+test("native - lazy take(0) returns before pulling a value", async () => {
+  const { seen } = await writeCounted();
+  const { output, module } = await importNative("lazy-take-none", `import { double } from "./counted.js"
+export let none = (xs, n) => xs |>> map(double) |>> take(n) |>> toArray
+export let pairs = (xs, n) => xs |>> map(double) |>> flatMap((x) => [x, x]) |>> take(n) |>> count
+export let values = (xs, n) => xs |>> map(double) |>> take(n)`);
+
+  expect(output).toContain("if (__lazy_done_1) return __lazy_result;");
+  seen.length = 0;
+  expect(module.none([1, 2, 3], 0)).toEqual([]);
+  expect(module.none([1, 2, 3], -1)).toEqual([]);
+  expect(module.pairs([1, 2, 3], 0)).toBe(0);
+  expect([...module.values([1, 2, 3], 0)]).toEqual([]);
+  expect(seen).toEqual([]);
+});
+
+test("native - lazy take after filter and map stops at the last taken value", async () => {
+  const { seen } = await writeCounted();
+  const { module } = await importNative("lazy-take-some", `import { double, even } from "./counted.js"
+export let evens = (xs, n) => xs |>> filter(even) |>> map(double) |>> take(n) |>> toArray
+export let pairs = (xs, n) => xs |>> map(double) |>> flatMap((x) => [x, x]) |>> take(n) |>> count`);
+
+  seen.length = 0;
+  expect(module.evens([1, 2, 3, 4, 5, 6], 2)).toEqual([4, 8]);
+  expect(seen).toEqual([2, 4]);
+  seen.length = 0;
+  expect(module.pairs([1, 2, 3], 3)).toBe(3);
+  expect(seen).toEqual([1, 2]);
+});
+
+test("native - lazy take ends a pipe over an infinite generator", async () => {
+  const { seen } = await writeCounted();
+  const { module } = await importNative("lazy-take-infinite", `import { double, even, naturals } from "./counted.js"
+export let firstEvens = (n) => naturals() |>> filter(even) |>> map(double) |>> take(n) |>> toArray
+export let doubled = (n) => naturals() |>> map(double) |>> take(n)`);
+
+  seen.length = 0;
+  expect(module.firstEvens(3)).toEqual([0, 4, 8]);
+  expect(seen).toEqual([0, 2, 4]);
+  expect([...module.doubled(4)]).toEqual([0, 2, 4, 6]);
+  expect(module.firstEvens(0)).toEqual([]);
+});
+
+// Async stages that record how many calls are in flight at once
+async function writeTiming() {
+  await Bun.write(join(testDir, "timing.js"), `export const calls = { active: 0, peak: 0 };
+export const slow = async (n) => {
+  calls.active++;
+  calls.peak = Math.max(calls.peak, calls.active);
+  await new Promise((resolve) => setTimeout(resolve, 10 - n));
+  calls.active--;
+  return n * 10;
+};
+export const label = async (n) => "#" + n;
+`);
+  return await import(join(testDir, "timing.js"));
+}
+
+test("native - match wrappers and lambdas are async only when they await", async () => {
+  await writeTiming();
+  const { output, module } = await importNative("await-match", `import { label } from "./timing.js"
+export let described = (x) => match x {
+  0 => "zero"
+  _ => await label(x)
+}
+export let plain = (x) => match x {
+  0 => "zero"
+  _ => "#" |> String
+}`);
+
+  expect(output).toContain("export const described = async (x) => (await (async () => {");
+  expect(output).toContain("export const plain = (x) => (() => {");
+  expect(await module.described(3)).toBe("#3");
+  expect(await module.described(0)).toBe("zero");
+  expect(module.plain(0)).toBe("zero");
+  expect(module.plain(1)).toBe("#");
+});
+
+test("native - mapAsync keeps at most limit calls in flight and the input order", async () => {
+  const { calls } = await writeTiming();
+  const { output, module } = await importNative("await-map", `import { slow } from "./timing.js"
+export let limited = (ids) => ids |> await mapAsync(slow, 2)
+export let unlimited = (ids) => ids |> await mapAsync(slow)`);
+
+  expect(output).toContain("const __zeno_map_async = async (items, f, limit = Infinity) => {");
+  const ids = [1, 2, 3, 4, 5, 6, 7, 8, 9];
+  const expected = ids.map((n) => n * 10);
+
+  calls.peak = 0;
+  expect(await module.limited(ids)).toEqual(expected);
+  expect(calls.peak).toBe(2);
+
+  calls.peak = 0;
+  expect(await module.unlimited(ids)).toEqual(expected);
+  expect(calls.peak).toBe(ids.length);
+  expect(await module.limited([])).toEqual([]);
+});
+
+test("native - export marks only the declarations it wraps", async () => {
+  const { output, module } = await importNative("export-symbols", `export struct Point {
+  x: number;
+  y: number;
+}
+export let origin = { x: 0, y: 0 }
+let helper = (p) => p.x
+export let xOf = (p) => p |> helper`);
+
+  expect(output).toContain("export const origin = ");
+  expect(output).toContain("const helper = ");
+  expect(output).not.toContain("export const helper");
+  expect(Object.keys(module).sort()).toEqual(["origin", "xOf"]);
+  expect(module.xOf({ x: 3, y: 4 })).toBe(3);
+
+  const { exitCode, output: typed } = await compileNative("export-symbols-ts", `export struct Point {
+  x: number;
+  y: number;
+}`);
+  expect(exitCode).toBe(0);
+  expect(typed).toContain("export type Point = {");
+});
+
+test("native - export default takes any expression", async () => {
+  const { output, module } = await importNative("export-default", `let xOf = (p) => p.x
+export default xOf`);
+
+  expect(output).toContain("export default xOf;");
+  expect(module.default({ x: 7 })).toBe(7);
+
+  const { module: literal } = await importNative("export-default-literal", `export default { name: "zeno" }`);
+  expect(literal.default).toEqual({ name: "zeno" });
+});
+
+test("native - --dce keeps exported declarations nothing references", async () => {
+  const { output, module } = await importNative("export-dce", `export let origin = { x: 0, y: 0 }
+let helper = (p) => p.x
+let dead = (p) => p.y
+export let xOf = (p) => p |> helper
+export default helper`, ["--dce"]);
+
+  expect(output).toContain("export const origin = ");
+  expect(output).toContain("const helper = ");
+  expect(output).not.toContain("const dead = ");
+  expect(module.origin).toEqual({ x: 0, y: 0 });
+  expect(module.default({ x: 2 })).toBe(2);
+});
+
+test("native - a .zs module imports one in a subdirectory through the plugin", async () => {
+  const { zenoscriptPlugin } = await import("../src/plugin.ts");
+  const dir = join(testDir, "plugin");
+  mkdirSync(join(dir, "lib"), { recursive: true });
+  await Bun.write(join(dir, "lib", "names.zs"), `export let greet = (name) => name |> toUpperCase
+export let quiet = (name) => name |> toLowerCase
+`);
+  await Bun.write(join(dir, "main.zs"), `import { greet } from "./lib/names.zs"
+export let shout = greet("ann")
+`);
+
+  const result = await Bun.build({
+    entrypoints: [join(dir, "main.zs")],
+    outdir: join(dir, "out"),
+    plugins: [zenoscriptPlugin],
+  });
+  expect(result.success).toBe(true);
+
+  // The unused export of the imported module is shaken out
+  const bundle = await result.outputs[0].text();
+  expect(bundle).toContain("toUpperCase");
+  expect(bundle).not.toContain("toLowerCase");
+  const module = await import(result.outputs[0].path);
+  expect(module.shout).toBe("ANN");
+});
+
+// Records every initializer that runs, by name
+async function writeBuilds() {
+  await Bun.write(join(testDir, "builds.js"), `export const built = [];
+export const build = (name) => {
+  built.push(name);
+  return [name];
+};
+export const buildLater = async (name) => build(name);
+`);
+  return await import(join(testDir, "builds.js"));
+}
+
+test("native - lazy let runs its initializer on the first read, once", async () => {
+  const { built } = await writeBuilds();
+  const { output, module } = await importNative("lazy-let-once", `import { build } from "./builds.js"
+lazy let table = build("table")
+export let read = () => table.at(0)`);
+
+  expect(output).toContain("let table = () => {");
+  expect(output).toContain("table().at(0)");
+  expect(built).not.toContain("table");
+  expect(module.read()).toBe("table");
+  expect(module.read()).toBe("table");
+  expect(built.filter((name: string) => name === "table")).toEqual(["table"]);
+});
+
+test("native - lazy let falls back to an eager let with a warning", async () => {
+  const { built } = await writeBuilds();
+  const { exitCode, stderr, output } = await compileNative("lazy-let-eager", `import { build, buildLater } from "./builds.js"
+export lazy let shared = build("shared")
+lazy let rebound = build("rebound")
+export let first = (rebound) => rebound.at(0)
+lazy let later = await buildLater("later")
+export let all = () => [shared, rebound, later]`, ["--emit", "js"]);
+
+  expect(exitCode).toBe(0);
+  expect(stderr).toContain("Warning: lazy let 'shared' at line 2 is exported, evaluating it eagerly");
+  expect(stderr).toContain("Warning: lazy let 'rebound' at line 3 is bound again elsewhere, evaluating it eagerly");
+  expect(stderr).toContain("Warning: lazy let 'later' at line 5 awaits, evaluating it eagerly");
+  expect(output).toContain('export const shared = build("shared");');
+  expect(output).toContain('const rebound = build("rebound");');
+  expect(output).toContain('const later = await buildLater("later");');
+  expect(output).not.toContain("__lazy_let");
+
+  // Evaluated on import, in order
+  const module = await import(join(testDir, "lazy-let-eager.js"));
+  expect(built.slice(-3)).toEqual(["shared", "rebound", "later"]);
+  expect(module.all()).toEqual([["shared"], ["rebound"], ["later"]]);
+});
+
+test("native - non-exhaustive atom match warns with the missing atoms", async () => {
+  const { exitCode, stderr, output } = await compileNative("exhaustive-missing", `let level = match 1 {
+  1 => :low
+  2 => :mid
+  _ => :high
+}
+export let partial = match level {
+  :low => "l"
+}`, ["--emit", "js"]);
+
+  expect(exitCode).toBe(0);
+  expect(stderr).toContain("Warning: Non-exhaustive match at line 6, column 22, missing :mid, :high");
+  expect(output).toContain('throw new Error("Non-exhaustive match")');
+});
+
+test("native - exhaustive atom match drops the runtime throw", async () => {
+  const { stderr, output, module } = await importNative("exhaustive-full", `let level = match 2 {
+  1 => :low
+  2 => :mid
+  _ => :high
+}
+export let full = match level {
+  :low => "l"
+  :mid => "m"
+  :high => "h"
+}`);
+
+  expect(stderr).toBe("");
+  expect(output).not.toContain("Non-exhaustive match");
+  expect(module.full).toBe("m");
+});
+
+test("native - a rebound let leaves the match it feeds unknown", async () => {
+  const { output, module } = await importNative("exhaustive-rebound", `let state = :open
+export let shadow = (state) => match state {
+  :open => "o"
+}`);
+
+  expect(output).toContain('throw new Error("Non-exhaustive match")');
+  expect(module.shadow(Symbol.for("open"))).toBe("o");
+  expect(() => module.shadow(Symbol.for("closed"))).toThrow("Non-exhaustive match");
+});
+
+test("native - --dce removes unreferenced pure lets and keeps what effects reach", async () => {
+  await Bun.write(join(testDir, "log.js"), "export const logged = [];\nexport const log = (value) => logged.push(value);\n");
+  const { logged } = await import(join(testDir, "log.js"));
+  const { output } = await importNative("dce", `import { log } from "./log.js"
+let unused = { a: 1 }
+let helper = (x) => x
+let used = "kept"
+let noisy = used |> log
+let caught = match 1 {
+  1 => "one"
+  _ => "other"
+}
+let matched = match 1 {
+  1 => "one"
+}
+struct Box {
+  v: number;
+}
+struct Bag {
+  v: number;
+}
+trait Show {
+  show(): string;
+}
+impl Show for Box {
+  show() {
+    obj.v |> log
+  }
+}
+impl Show for Bag {
+  show() {
+    obj.v |> log
+  }
+}
+let shown = { v: 1 } |> BoxShow.show`, ["--dce"]);
+
+  // Pure and unreferenced
+  expect(output).not.toContain("const unused");
+  expect(output).not.toContain("const helper");
+  expect(output).not.toContain("const caught");
+  expect(output).not.toContain("const BagShow");
+  // Effectful roots, what they reference, and a match that may throw
+  expect(output).toContain('const used = "kept";');
+  expect(output).toContain("const noisy = log(used);");
+  expect(output).toContain("const matched = ");
+  expect(output).toContain("const BoxShow = {");
+  expect(output).toContain("const shown = BoxShow.show({ v: 1 });");
+  expect(logged).toEqual(["kept", 1]);
+});
+
+const TYPED_MODULE = `struct Point {
+  x: number;
+  y: number;
+}
+export struct Pair {
+  left: string;
+  right: string;
+}
+trait Show {
+  show(): string;
+}
+impl Show for Point {
+  show(): string {
+    obj.x |> String
+  }
+}
+export let origin: Point = { x: 0, y: 0 }
+export let label = (p: Point): string => p |> PointShow.show
+let hidden = (n: number) => n
+export default label`;
+
+test("native - --emit js drops every type annotation", async () => {
+  const { output, module } = await importNative("emit-js", TYPED_MODULE);
+
+  expect(output).not.toMatch(/: (number|string|Point)\b/);
+  expect(output).not.toMatch(/^(export )?(type|interface) /m);
+  expect(output).toContain("export const origin = { x: 0, y: 0 };");
+  expect(output).toContain("export const label = (p) => PointShow.show(p);");
+  expect(Object.keys(module).sort()).toEqual(["default", "label", "origin"]);
+});
+
+test("native - --declarations writes a .d.ts declaring the exports", async () => {
+  const { exitCode } = await compileNative("emit-dts", TYPED_MODULE, ["--emit", "js", "--declarations"]);
+  expect(exitCode).toBe(0);
+
+  const declarations = await Bun.file(join(testDir, "emit-dts.d.ts")).text();
+  expect(declarations).toContain("export type Pair = {");
+  expect(declarations).toContain("export declare const origin: Point;");
+  expect(declarations).toContain("export declare const label: (p: Point) => string;");
+  expect(declarations).toContain("export default label;");
+  expect(declarations).toContain("type Point = {");
+  expect(declarations).not.toContain("export type Point");
+  expect(declarations).not.toContain("=>  ");
+  expect(declarations).not.toMatch(/= \{ x: 0/);
+});
+
+test("native - --profile-use moves the hot match arm first without changing results", async () => {
+  await Bun.write(join(testDir, "pgo.zs"), `export let classify = (x) => match x {
+  :rare => "rare"
+  :odd => "odd"
+  :hot => "hot"
+  _ => "other"
+}`);
+  // Mostly :hot, a few of the others
+  const workload = [];
+  for (let i = 0; i < 100; i++) {
+    workload.push(i % 10 === 0 ? "rare" : i % 5 === 0 ? "odd" : i === 99 ? "x" : "hot");
+  }
+
+  // The profile is keyed by the source file, so both builds compile pgo.zs
+  const instrumented = await runZeno(["--emit", "js", "--instrument", "pgo.profile", "pgo.zs", "pgo-instrumented.js"]);
+  expect(instrumented.exitCode).toBe(0);
+  await Bun.write(join(testDir, "pgo-run.mjs"), `import { classify } from "./pgo-instrumented.js";
+for (const name of ${JSON.stringify(workload)}) classify(Symbol.for(name));
+`);
+  const run = spawn({ cmd: [process.execPath, "pgo-run.mjs"], cwd: testDir, stdout: "pipe", stderr: "pipe" });
+  expect(await run.exited).toBe(0);
+
+  const profile = await Bun.file(join(testDir, "pgo.profile")).text();
+  expect(profile).toBe("pgo.zs:2:3 10\npgo.zs:3:3 10\npgo.zs:4:3 79\npgo.zs:5:3 1\n");
+
+  const optimized = await runZeno(["--emit", "js", "--profile-use", "pgo.profile", "pgo.zs", "pgo-optimized.js"]);
+  expect(optimized.stderr).toBe("");
+  expect(optimized.exitCode).toBe(0);
+  const output = await Bun.file(join(testDir, "pgo-optimized.js")).text();
+  expect(output.slice(output.indexOf("if ("))).toStartWith('if (__match_value === Symbol.for("hot"))');
+  expect(output).not.toContain("__zeno_prof");
+
+  // Importing the instrumented build here would write a profile on exit
+  expect((await runZeno(["--emit", "js", "pgo.zs", "pgo-plain.js"])).exitCode).toBe(0);
+  const before = await import(join(testDir, "pgo-plain.js"));
+  const after = await import(join(testDir, "pgo-optimized.js"));
+  for (const name of ["rare", "odd", "hot", "x"]) {
+    expect(after.classify(Symbol.for(name))).toBe(before.classify(Symbol.for(name)));
+  }
+});
+
+const STRUCT_MODULE = `export struct Point {
+  x: number;
+  y: number;
+}
+struct Box<T> {
+  value: T;
+}
+struct Empty {}
+export let origin = Point(3, 4)
+export let boxed = Box("a")
+export let empty = Empty()`;
+
+test("native - --struct-factories builds instances with fields in declaration order", async () => {
+  const { output, module } = await importNative("struct-factory", STRUCT_MODULE, ["--struct-factories"]);
+
+  expect(output).toContain("export const Point = (x, y) => ({ x: x, y: y });");
+  expect(module.origin).toEqual({ x: 3, y: 4 });
+  expect(Object.keys(module.origin)).toEqual(["x", "y"]);
+  expect(module.boxed).toEqual({ value: "a" });
+  expect(module.empty).toEqual({});
+  expect(module.Point(1, 2)).toEqual({ x: 1, y: 2 });
+});
+
+test("native - struct factories are typed with the struct's fields and generics", async () => {
+  const { exitCode, output } = await compileNative("struct-factory-ts", STRUCT_MODULE, ["--struct-factories"]);
+  expect(exitCode).toBe(0);
+  expect(output).toContain("export const Point = (x: number, y: number): Point => ({ x: x, y: y });");
+  expect(output).toContain("const Box = <T>(value: T): Box<T> => ({ value: value });");
+  expect(output).toContain("const Empty = (): Empty => ({});");
+
+  const declared = await compileNative("struct-factory-dts", STRUCT_MODULE, ["--struct-factories", "--emit", "js", "--declarations"]);
+  expect(declared.exitCode).toBe(0);
+  const declarations = await Bun.file(join(testDir, "struct-factory-dts.d.ts")).text();
+  expect(declarations).toContain("export declare const Point: (x: number, y: number) => Point;");
+  expect(declarations).toContain("declare const Box: <T>(value: T) => Box<T>;");
+});
+
+test("native - --minify shortens the runtime helpers it emits", async () => {
+  await writeTiming();
+  const source = `import { slow } from "./timing.js"
+export let limited = (ids) => ids |> await mapAsync(slow, 2)
+export let shout = (s) => s |> trim |> toUpperCase
+export let kind = (x) => match x {
+  0 => "zero"
+  _ => "other"
+}`;
+  const { output, module } = await importNative("minify-helpers", source, ["--minify", "--trace-pipes"]);
+
+  expect(output).not.toContain("\n");
+  expect(output).not.toMatch(/__zeno_|\bworkers\b|\brecord\b/);
+  expect(output).toContain("const $A=async(s,f,l=Infinity)=>{");
+  expect(await module.limited([3, 1, 2])).toEqual([30, 10, 20]);
+  expect(module.shout(" hi ")).toBe("HI");
+
+  // The pipe trace keeps the field names src/pipes.ts reads
+  const pipes = (globalThis as any).__zenoPipes;
+  expect(pipes.lines.slice(-3)).toEqual([2, 3, 3]);
+  expect(pipes.files.slice(-1)).toEqual(["minify-helpers.zs"]);
+
+  // Instrumented modules write their profile on exit, so this one runs in testDir
+  const instrumented = await compileNative("minify-profile", source, ["--emit", "js", "--minify", "--instrument", "minify.profile"]);
+  expect(instrumented.exitCode).toBe(0);
+  expect(instrumented.output).not.toMatch(/__zeno_|\boutputs\b|\bmodules\b/);
+  expect(instrumented.output).toContain('t+=f+":"+s[2*i]+":"+s[2*i+1]+" "+c[i]+"\\n";');
+  await Bun.write(join(testDir, "minify-run.mjs"), 'import { kind } from "./minify-profile.js";\nkind(0);\nkind(1);\nkind(2);\n');
+  const run = spawn({ cmd: [process.execPath, "minify-run.mjs"], cwd: testDir, stdout: "pipe", stderr: "pipe" });
+  expect(await run.exited).toBe(0);
+  expect(await Bun.file(join(testDir, "minify.profile")).text()).toBe("minify-profile.zs:5:3 1\nminify-profile.zs:6:3 2\n");
+});